@@ -0,0 +1,5 @@
+#!/usr/bin/env sh
+HERE="$(dirname ${0})"
+BUILD="${HERE}/builds"
+[ -d "${BUILD}" ] || mkdir -p "${BUILD}"
+"${HERE}"/build.sh release && "${HERE}"/builds/"$(hostname)"/bench "$@"
@@ -0,0 +1,202 @@
+/* throughput of the main.c pipelines, one JSON object per line:
+ *
+ * {"pipeline": ..., "elements": ..., "ns_per_element": ...,
+ *  "elements_per_second": ..., "allocations_per_element": ...,
+ *  "bytes_per_element": ...}
+ *
+ * usage: bench [--max-elements <n>]
+ */
+
+#include "allocator.h"
+#include "allocator_type.h"
+#include "arena_allocator.h"
+#include "float_transducers.h"
+#include "pipeline_stages.h"
+#include "reduce.h"
+#include "tracking_allocator.h"
+#include "transducer_types.h"
+#include "transducers.h"
+#include "value_stream_types.h"
+#include "value_streams.h"
+#include "values.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* measurements */
+
+static double now_ns(void)
+{
+        struct timespec ts;
+        timespec_get(&ts, TIME_UTC);
+        return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+enum PipelineKind {
+        PK_ReduceStream,
+        PK_Transduce,
+};
+
+struct Pipeline
+{
+        char const *name;
+        enum PipelineKind kind;
+        struct Reducer *reducer;
+        struct Transducer *transducer;
+};
+
+/* the sink of the reduction, so that the compiler cannot drop it */
+static volatile float sink;
+
+static void measure(struct Pipeline const *pipeline, float const *values,
+                    size_t const count, struct ArenaAllocator *arena,
+                    struct TrackingAllocator *tracker)
+{
+        size_t const minimumElements = 10 * 1000 * 1000;
+        size_t const runs = count < minimumElements ? minimumElements / count
+                                                    : 1;
+
+        tracking_reset(tracker);
+        struct ArenaMark const mark = arena_mark(arena);
+        double const start = now_ns();
+        for (size_t run = 0; run < runs; run++) {
+                struct Value result;
+                if (pipeline->kind == PK_ReduceStream) {
+                        struct ValueStreamRange range;
+                        floatArrayVSR(&range, values, count);
+                        result = reduceStream(&range, pipeline->reducer,
+                                              &tracker->super);
+                } else {
+                        result = transduceFloatArray(values, count,
+                                                     pipeline->transducer,
+                                                     &tracker->super);
+                }
+                sink = justFloat(result);
+                arena_reset(arena, mark);
+        }
+        double const elapsed = now_ns() - start;
+
+        double const elements = (double)count * (double)runs;
+        printf("{\"pipeline\": \"%s\", \"elements\": %zu, "
+               "\"ns_per_element\": %.3f, \"elements_per_second\": %.0f, "
+               "\"allocations_per_element\": %.3f, "
+               "\"bytes_per_element\": %.3f}\n",
+               pipeline->name, count, elapsed / elements,
+               elements / (elapsed * 1e-9),
+               (double)atomic_load(&tracker->allocations) / elements,
+               (double)atomic_load(&tracker->bytes) / elements);
+        fflush(stdout);
+}
+
+static struct Transducer *compose(struct Transducer **transducers,
+                                  size_t count, struct Allocator *allocator)
+{
+        struct Transducer **steps =
+            allocator_alloc(allocator, count * sizeof *steps);
+        memcpy(steps, transducers, count * sizeof *steps);
+        return composingTransducer(steps, count, allocator);
+}
+
+int main(int argc, char **argv)
+{
+        size_t maxElements = 1000 * 1000;
+        for (int i = 1; i < argc; i++) {
+                if (strcmp(argv[i], "--max-elements") == 0 && i + 1 < argc) {
+                        maxElements = (size_t)strtoull(argv[++i], NULL, 10);
+                } else {
+                        fprintf(stderr, "usage: %s [--max-elements <n>]\n",
+                                argv[0]);
+                        return 1;
+                }
+        }
+
+        struct Allocator heapAllocator = stdlibAllocator();
+        struct ArenaAllocator arena;
+        arena_init(&arena, &heapAllocator, 1 << 20);
+        struct TrackingAllocator tracker;
+        tracking_init(&tracker, &arena.super);
+
+        static struct Reducer accumulator = {
+            .identity = accumulateFloatIdentity,
+            .apply = accumulateFloatApply,
+            .combine = accumulateFloatApply,
+        };
+        struct Allocator *a = &heapAllocator;
+
+        struct Transducer *accumulating = mappingTransducer(&accumulator, a);
+        struct Transducer *positives =
+            filteringTransducer(positiveFloatsOnly, NULL, a);
+        struct Transducer *inverting =
+            mappingFnTransducer(invertFloat, NULL, a);
+        struct Transducer *indexing = mappingTransducer(indexingReducer(a), a);
+        struct Transducer *indexed = filteringTransducer(isIndexed, NULL, a);
+        struct Transducer *unwrapping =
+            mappingFnTransducer(unwrapIndexedValue, NULL, a);
+
+        struct Transducer *oneStage[] = {accumulating};
+        struct Transducer *twoStages[] = {positives, accumulating};
+        struct Transducer *fourStages[] = {inverting, positives, inverting,
+                                           accumulating};
+        struct Transducer *eightStages[] = {
+            inverting, positives, inverting, indexing,
+            indexed,   unwrapping, inverting, accumulating,
+        };
+        struct Transducer *columnStages[] = {
+            inverting,
+            positives,
+            inverting,
+            indexingTransducer(a),
+            indexRangeTransducer(0, SIZE_MAX, a),
+            unwrappingTransducer(a),
+            inverting,
+            accumulating,
+        };
+        struct Transducer *floatStages[] = {
+            floatThresholdTransducer(0.0f, a),
+            mappingTransducer(floatSumReducer(a), a),
+        };
+
+#define COUNT_OF(array) (sizeof array / sizeof array[0])
+        struct Pipeline const pipelines[] = {
+            {"reduceStream/accumulate", PK_ReduceStream, &accumulator, NULL},
+            {"reduceStream/floatSum", PK_ReduceStream, floatSumReducer(a),
+             NULL},
+            {"transduce/1", PK_Transduce, NULL,
+             compose(oneStage, COUNT_OF(oneStage), a)},
+            {"transduce/2", PK_Transduce, NULL,
+             compose(twoStages, COUNT_OF(twoStages), a)},
+            {"transduce/4", PK_Transduce, NULL,
+             compose(fourStages, COUNT_OF(fourStages), a)},
+            {"transduce/8", PK_Transduce, NULL,
+             compose(eightStages, COUNT_OF(eightStages), a)},
+            {"transduce/8-columns", PK_Transduce, NULL,
+             compose(columnStages, COUNT_OF(columnStages), a)},
+            {"transduce/float-threshold-sum", PK_Transduce, NULL,
+             compose(floatStages, COUNT_OF(floatStages), a)},
+        };
+
+        float *values = allocator_alloc(a, maxElements * sizeof *values);
+        if (!values) {
+                fprintf(stderr, "cannot allocate %zu elements\n", maxElements);
+                return 1;
+        }
+        for (size_t i = 0; i < maxElements; i++) {
+                values[i] = (float)((int)(i % 7) - 3);
+        }
+
+        for (size_t p = 0; p < COUNT_OF(pipelines); p++) {
+                for (size_t count = 1000; count <= maxElements; count *= 10) {
+                        measure(&pipelines[p], values, count, &arena,
+                                &tracker);
+                }
+        }
+#undef COUNT_OF
+
+        allocator_free(a, values);
+        arena_release(&arena);
+
+        return 0;
+}
@@ -0,0 +1,299 @@
+/* xfc: transducer expression + C header -> C function
+ *
+ * usage: xfc <pipeline.xf> <output.c> <output.h>
+ *
+ * A pipeline description is a sequence of lines, `#` starts a comment:
+ *
+ *     pipeline <name> <element-type>
+ *     include <header>                      C header declaring the functions
+ *     map <fn> [<output-type>]              value = fn(value)
+ *     filter <fn>                           drops values where !fn(value)
+ *     index                                 pairs values with their position
+ *     take-range <start> <end>              keeps indices in [start, end)
+ *     take <n>                              keeps the first n values
+ *     unwrap                                drops the index
+ *     reduce <fn> <initial> [<result-type>] result = fn(result, value)
+ *
+ * `reduce` ends the pipeline. The output is a function
+ *
+ *     <result-type> <name>(<element-type> const *values, size_t count);
+ *
+ * made of a single loop, with the user functions called directly so that
+ * the compiler can inline them. The loop stops as soon as no further input
+ * can change the result.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum { MAX_TOKENS = 8, MAX_LINE = 512, MAX_NAME = 128 };
+
+struct Generator
+{
+        char const *path;
+        unsigned line;
+        FILE *loop;
+
+        char name[MAX_NAME];
+        char elementType[MAX_NAME];
+        char resultType[MAX_NAME];
+        char initial[MAX_NAME];
+        bool hasPipeline;
+        bool hasReduce;
+
+        /* state of the loop being generated */
+        char valueType[MAX_NAME];
+        unsigned valueCount;
+        bool hasIndex;
+        unsigned indexCount;
+        unsigned counterCount;
+        unsigned stopCount;
+};
+
+static void die(struct Generator const *generator, char const *message,
+                char const *detail)
+{
+        fprintf(stderr, "%s:%u: %s%s%s\n", generator->path, generator->line,
+                message, detail ? ": " : "", detail ? detail : "");
+        exit(1);
+}
+
+static void copyName(struct Generator const *generator, char *name,
+                     char const *token)
+{
+        if (strlen(token) >= MAX_NAME) {
+                die(generator, "name too long", token);
+        }
+        strcpy(name, token);
+}
+
+static size_t tokenize(char *line, char **tokens)
+{
+        char *comment = strchr(line, '#');
+        if (comment) {
+                *comment = '\0';
+        }
+
+        size_t count = 0;
+        for (char *token = strtok(line, " \t\r\n"); token && count < MAX_TOKENS;
+             token = strtok(NULL, " \t\r\n")) {
+                tokens[count++] = token;
+        }
+
+        return count;
+}
+
+static void expectArguments(struct Generator const *generator, size_t count,
+                            size_t minimum, size_t maximum)
+{
+        if (count - 1 < minimum || count - 1 > maximum) {
+                die(generator, "wrong number of arguments", NULL);
+        }
+}
+
+static void expectStage(struct Generator const *generator)
+{
+        if (!generator->hasPipeline) {
+                die(generator, "stage before the pipeline line", NULL);
+        }
+        if (generator->hasReduce) {
+                die(generator, "stage after reduce", NULL);
+        }
+}
+
+static void parseLine(struct Generator *generator, char **tokens,
+                      size_t const count, FILE *includes)
+{
+        FILE *loop = generator->loop;
+        char const *keyword = tokens[0];
+        unsigned const value = generator->valueCount - 1;
+        unsigned const index = generator->indexCount - 1;
+
+        if (strcmp(keyword, "pipeline") == 0) {
+                expectArguments(generator, count, 2, 2);
+                if (generator->hasPipeline) {
+                        die(generator, "only one pipeline per file", NULL);
+                }
+                generator->hasPipeline = true;
+                copyName(generator, generator->name, tokens[1]);
+                copyName(generator, generator->elementType, tokens[2]);
+                copyName(generator, generator->valueType, tokens[2]);
+                generator->valueCount = 1;
+                fprintf(loop, "                %s const v0 = values[i];\n",
+                        generator->valueType);
+        } else if (strcmp(keyword, "include") == 0) {
+                expectArguments(generator, count, 1, 1);
+                fprintf(includes, "#include \"%s\"\n", tokens[1]);
+        } else if (strcmp(keyword, "map") == 0) {
+                expectStage(generator);
+                expectArguments(generator, count, 1, 2);
+                if (count == 3) {
+                        copyName(generator, generator->valueType, tokens[2]);
+                }
+                fprintf(loop, "                %s const v%u = %s(v%u);\n",
+                        generator->valueType, value + 1, tokens[1], value);
+                generator->valueCount++;
+        } else if (strcmp(keyword, "filter") == 0) {
+                expectStage(generator);
+                expectArguments(generator, count, 1, 1);
+                fprintf(loop,
+                        "                if (!%s(v%u)) {\n"
+                        "                        continue;\n"
+                        "                }\n",
+                        tokens[1], value);
+        } else if (strcmp(keyword, "index") == 0) {
+                expectStage(generator);
+                expectArguments(generator, count, 0, 0);
+                fprintf(loop, "                size_t const index%u = next%u++;\n",
+                        generator->indexCount, generator->indexCount);
+                generator->indexCount++;
+                generator->hasIndex = true;
+        } else if (strcmp(keyword, "take-range") == 0) {
+                expectStage(generator);
+                expectArguments(generator, count, 2, 2);
+                if (!generator->hasIndex) {
+                        die(generator, "take-range needs an index", NULL);
+                }
+                fprintf(loop,
+                        "                if (index%u >= (size_t)(%s)) {\n"
+                        "                        break;\n"
+                        "                }\n",
+                        index, tokens[2]);
+                /* comparing an unsigned index with 0 would warn */
+                if (strcmp(tokens[1], "0") != 0) {
+                        fprintf(loop,
+                                "                if (index%u < (size_t)(%s)) {\n"
+                                "                        continue;\n"
+                                "                }\n",
+                                index, tokens[1]);
+                }
+                fprintf(loop,
+                        "                bool const stop%u = index%u + 1 >= "
+                        "(size_t)(%s);\n",
+                        generator->stopCount, index, tokens[2]);
+                generator->stopCount++;
+        } else if (strcmp(keyword, "take") == 0) {
+                expectStage(generator);
+                expectArguments(generator, count, 1, 1);
+                fprintf(loop,
+                        "                if (taken%u >= (size_t)(%s)) {\n"
+                        "                        break;\n"
+                        "                }\n"
+                        "                bool const stop%u = ++taken%u >= "
+                        "(size_t)(%s);\n",
+                        generator->counterCount, tokens[1],
+                        generator->stopCount, generator->counterCount,
+                        tokens[1]);
+                generator->counterCount++;
+                generator->stopCount++;
+        } else if (strcmp(keyword, "unwrap") == 0) {
+                expectStage(generator);
+                expectArguments(generator, count, 0, 0);
+                if (!generator->hasIndex) {
+                        die(generator, "unwrap needs an index", NULL);
+                }
+                generator->hasIndex = false;
+        } else if (strcmp(keyword, "reduce") == 0) {
+                expectStage(generator);
+                expectArguments(generator, count, 2, 3);
+                generator->hasReduce = true;
+                copyName(generator, generator->initial, tokens[2]);
+                copyName(generator, generator->resultType,
+                         count == 4 ? tokens[3] : generator->valueType);
+                fprintf(loop, "                result = %s(result, v%u);\n",
+                        tokens[1], value);
+                for (unsigned n = 0; n < generator->stopCount; n++) {
+                        fprintf(loop,
+                                "                if (stop%u) {\n"
+                                "                        break;\n"
+                                "                }\n",
+                                n);
+                }
+        } else {
+                die(generator, "unknown stage", keyword);
+        }
+}
+
+static void append(FILE *output, FILE *input)
+{
+        rewind(input);
+        int c;
+        while ((c = fgetc(input)) != EOF) {
+                fputc(c, output);
+        }
+}
+
+int main(int argc, char **argv)
+{
+        if (argc != 4) {
+                fprintf(stderr, "usage: %s <pipeline.xf> <output.c> <output.h>\n",
+                        argv[0]);
+                return 1;
+        }
+
+        char const *separator = strrchr(argv[1], '/');
+        char const *source = separator ? separator + 1 : argv[1];
+
+        struct Generator generator = {.path = argv[1], .loop = tmpfile()};
+        FILE *includes = tmpfile();
+        FILE *input = fopen(argv[1], "r");
+        if (!generator.loop || !includes || !input) {
+                die(&generator, "cannot open input", NULL);
+        }
+
+        char line[MAX_LINE];
+        char *tokens[MAX_TOKENS];
+        while (fgets(line, sizeof line, input)) {
+                generator.line++;
+                size_t const count = tokenize(line, tokens);
+                if (count > 0) {
+                        parseLine(&generator, tokens, count, includes);
+                }
+        }
+        fclose(input);
+
+        if (!generator.hasReduce) {
+                die(&generator, "the pipeline must end with reduce", NULL);
+        }
+
+        FILE *header = fopen(argv[3], "w");
+        FILE *body = fopen(argv[2], "w");
+        if (!header || !body) {
+                die(&generator, "cannot open outputs", NULL);
+        }
+
+        char signature[4 * MAX_NAME];
+        snprintf(signature, sizeof signature,
+                 "%s %s(%s const *values, size_t count)", generator.resultType,
+                 generator.name, generator.elementType);
+
+        fprintf(header, "#pragma once\n\n"
+                        "/* generated by xfc from %s, do not edit */\n\n",
+                source);
+        append(header, includes);
+        fprintf(header, "\n#include <stddef.h>\n\n%s;\n", signature);
+
+        fprintf(body, "/* generated by xfc from %s, do not edit */\n\n",
+                source);
+        append(body, includes);
+        fprintf(body, "\n#include <stdbool.h>\n#include <stddef.h>\n\n"
+                      "%s\n{\n"
+                      "        %s result = %s;\n",
+                signature, generator.resultType, generator.initial);
+        for (unsigned n = 0; n < generator.indexCount; n++) {
+                fprintf(body, "        size_t next%u = 0;\n", n);
+        }
+        for (unsigned n = 0; n < generator.counterCount; n++) {
+                fprintf(body, "        size_t taken%u = 0;\n", n);
+        }
+        fprintf(body, "\n        for (size_t i = 0; i < count; i++) {\n");
+        append(body, generator.loop);
+        fprintf(body, "        }\n\n        return result;\n}\n");
+
+        fclose(includes);
+        fclose(generator.loop);
+        fclose(header);
+        return fclose(body) == 0 ? 0 : 1;
+}
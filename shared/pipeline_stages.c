@@ -0,0 +1,146 @@
+#include "pipeline_stages.h"
+
+#include "allocator.h"
+#include "transducer_types.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+static void *stdlib_alloc(struct Allocator *const allocator, size_t size)
+{
+        return malloc(size);
+}
+
+static void *stdlib_alloc_aligned(struct Allocator *const allocator,
+                                  size_t size, size_t alignment)
+{
+        /* aligned_alloc wants a multiple of the alignment */
+        return aligned_alloc(alignment,
+                             (size + alignment - 1) / alignment * alignment);
+}
+
+static void *stdlib_realloc(struct Allocator *const allocator, void *ptr,
+                            size_t size)
+{
+        return realloc(ptr, size);
+}
+
+static void stdlib_free(struct Allocator *const allocator, void *ptr)
+{
+        free(ptr);
+}
+
+struct Allocator stdlibAllocator(void)
+{
+        return (struct Allocator){
+            .alloc = stdlib_alloc,
+            .free = stdlib_free,
+            .alloc_aligned = stdlib_alloc_aligned,
+            .realloc = stdlib_realloc,
+        };
+}
+
+float justFloat(struct Value value)
+{
+        assert(value.type_tag == TTAG_FLOAT);
+        return *((float const *)valuePayload(&value));
+}
+
+size_t justIndex(struct Value value)
+{
+        assert(value.type_tag == TTAG_IndexedValue);
+        return ((struct IndexedValue *)value.address)->index;
+}
+
+struct Value indexValue(struct Value value, size_t index,
+                        struct Allocator *allocator)
+{
+        struct IndexedValue *result =
+            allocator_alloc(allocator, sizeof *result);
+
+        *result = (struct IndexedValue){
+            .value = value, .index = index,
+        };
+
+        return (struct Value){.type_tag = TTAG_IndexedValue,
+                              .element_size = sizeof *result,
+                              .address = result,
+                              .allocator = allocator};
+}
+
+struct Value justValueOfIndexedValue(struct Value indexedValue)
+{
+        assert(indexedValue.type_tag == TTAG_IndexedValue);
+        return ((struct IndexedValue *)indexedValue.address)->value;
+}
+
+/* reducers */
+
+struct Value accumulateFloat(struct Value const input,
+                             struct Value const current,
+                             struct Allocator *const allocator)
+{
+        return floatImmediate(justFloat(input) + justFloat(current));
+}
+
+struct Value accumulateFloatIdentity(struct Reducer const *reducer,
+                                     struct Allocator *allocator)
+{
+        return floatImmediate(0.0f);
+}
+
+struct Value accumulateFloatApply(struct Reducer const *reducer,
+                                  struct Value const input,
+                                  struct Value const current,
+                                  struct Allocator *allocator)
+{
+        return accumulateFloat(input, current, allocator);
+}
+
+static struct Value indexingReducerApply(struct Reducer const *reducer,
+                                         struct Value input,
+                                         struct Value current,
+                                         struct Allocator *allocator)
+{
+        size_t index;
+        if (current.type_tag == 0) {
+                index = 0;
+        } else {
+                index = 1 + justIndex(current);
+        }
+
+        return indexValue(input, index, allocator);
+}
+
+struct Reducer *indexingReducer(struct Allocator *allocator)
+{
+        struct Reducer *result = allocator_alloc(allocator, sizeof *result);
+
+        *result = (struct Reducer){
+            .apply = indexingReducerApply,
+        };
+
+        return result;
+}
+
+/* predicates and mapping functions */
+
+bool positiveFloatsOnly(struct Value value, void *data)
+{
+        return value.type_tag == TTAG_FLOAT && justFloat(value) > 0.0f;
+}
+
+bool isIndexed(struct Value value, void *data)
+{
+        return value.type_tag == TTAG_IndexedValue;
+}
+
+struct Value invertFloat(struct Value value, void *data)
+{
+        return floatImmediate(-justFloat(value));
+}
+
+struct Value unwrapIndexedValue(struct Value value, void *data)
+{
+        return justValueOfIndexedValue(value);
+}
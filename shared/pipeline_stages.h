@@ -0,0 +1,60 @@
+#pragma once
+
+/**
+ * @file
+ * Stages of the pipelines of the test program and the bench, built into
+ * both of them.
+ */
+
+#include "allocator_type.h"
+#include "values.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct Reducer;
+
+/// allocator over the C standard library
+struct Allocator stdlibAllocator(void);
+
+float justFloat(struct Value value);
+
+#define TTAG_IndexedValue (0xd4e1cf8d)
+
+struct IndexedValue
+{
+        struct Value value;
+        size_t index;
+};
+
+size_t justIndex(struct Value value);
+
+struct Value indexValue(struct Value value, size_t index,
+                        struct Allocator *allocator);
+
+struct Value justValueOfIndexedValue(struct Value indexedValue);
+
+/* reducers */
+
+struct Value accumulateFloat(struct Value input, struct Value current,
+                             struct Allocator *allocator);
+
+struct Value accumulateFloatIdentity(struct Reducer const *reducer,
+                                     struct Allocator *allocator);
+
+struct Value accumulateFloatApply(struct Reducer const *reducer,
+                                  struct Value input, struct Value current,
+                                  struct Allocator *allocator);
+
+/// boxes each value into a TTAG_IndexedValue, numbered from 0
+struct Reducer *indexingReducer(struct Allocator *allocator);
+
+/* predicates and mapping functions */
+
+bool positiveFloatsOnly(struct Value value, void *data);
+
+bool isIndexed(struct Value value, void *data);
+
+struct Value invertFloat(struct Value value, void *data);
+
+struct Value unwrapIndexedValue(struct Value value, void *data);
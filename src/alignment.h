@@ -0,0 +1,18 @@
+#pragma once
+
+/**
+ * @file
+ * Rounding of sizes, shared by the allocators and the reducer chains.
+ */
+
+#include <stddef.h>
+
+/// what state written by different threads is kept apart by
+enum { CACHE_LINE_SIZE = 64 };
+
+/// size rounded up to the alignment of max_align_t
+static inline size_t alignUp(size_t const size)
+{
+        size_t const alignment = _Alignof(max_align_t);
+        return (size + alignment - 1) & ~(alignment - 1);
+}
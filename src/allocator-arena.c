@@ -0,0 +1,128 @@
+#include "arena_allocator_type.h"
+#include "arena_allocator.h"
+
+#include "alignment.h"
+#include "allocator.h"
+
+#include <stddef.h>
+
+#define ARENA_ALIGNMENT (_Alignof(max_align_t))
+
+static struct ArenaBlock *newBlock(struct ArenaAllocator *arena,
+                                   size_t const minSize)
+{
+        size_t const headerSize = alignUp(sizeof(struct ArenaBlock));
+        size_t const size =
+            arena->blockSize > minSize ? arena->blockSize : minSize;
+
+        struct ArenaBlock *block =
+            allocator_alloc(arena->parent, headerSize + size);
+        if (!block) {
+                return NULL;
+        }
+
+        block->start = (uint8_t *)block + headerSize;
+        block->end = block->start + size;
+        block->next = NULL;
+
+        return block;
+}
+
+static void *arenaAlloc(struct Allocator *allocator, size_t size)
+{
+        struct ArenaAllocator *self = (struct ArenaAllocator *)allocator;
+
+        size = alignUp(size ? size : 1);
+
+        if (self->current &&
+            size <= (size_t)(self->current->end - self->cursor)) {
+                void *result = self->cursor;
+                self->cursor += size;
+                return result;
+        }
+
+        struct ArenaBlock *block =
+            self->current ? self->current->next : self->first;
+        if (!block || size > (size_t)(block->end - block->start)) {
+                struct ArenaBlock *reused = block;
+                block = newBlock(self, size);
+                if (!block) {
+                        return NULL;
+                }
+
+                block->next = reused;
+                if (self->current) {
+                        self->current->next = block;
+                } else {
+                        self->first = block;
+                }
+        }
+
+        self->current = block;
+        self->cursor = block->start + size;
+
+        return block->start;
+}
+
+static void *arenaAllocAligned(struct Allocator *allocator, size_t size,
+                               size_t alignment)
+{
+        if (alignment <= ARENA_ALIGNMENT) {
+                return arenaAlloc(allocator, size);
+        }
+
+        uint8_t *result = arenaAlloc(allocator, size + alignment);
+        if (!result) {
+                return NULL;
+        }
+
+        return result + (alignment - (uintptr_t)result % alignment) % alignment;
+}
+
+static void arenaFree(struct Allocator *allocator, void *ptr)
+{
+        (void)allocator;
+        (void)ptr;
+}
+
+void arena_init(struct ArenaAllocator *arena, struct Allocator *parent,
+                size_t blockSize)
+{
+        *arena = (struct ArenaAllocator){
+            .super =
+                (struct Allocator){
+                    .alloc = arenaAlloc,
+                    .free = arenaFree,
+                    .alloc_aligned = arenaAllocAligned,
+                },
+            .parent = parent,
+            .blockSize = blockSize,
+        };
+}
+
+void arena_release(struct ArenaAllocator *arena)
+{
+        struct ArenaBlock *block = arena->first;
+        while (block) {
+                struct ArenaBlock *next = block->next;
+                allocator_free(arena->parent, block);
+                block = next;
+        }
+
+        arena->first = NULL;
+        arena->current = NULL;
+        arena->cursor = NULL;
+}
+
+struct ArenaMark arena_mark(struct ArenaAllocator const *arena)
+{
+        return (struct ArenaMark){
+            .block = arena->current, .cursor = arena->cursor,
+        };
+}
+
+void arena_reset(struct ArenaAllocator *arena, struct ArenaMark mark)
+{
+        arena->current = mark.block;
+        arena->cursor = mark.cursor;
+}
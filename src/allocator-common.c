@@ -1,11 +1,43 @@
 #include "allocator_type.h"
 #include "allocator.h"
 
+#include <string.h>
+
 void *allocator_alloc(struct Allocator *allocator, size_t size)
 {
         return allocator->alloc(allocator, size);
 }
 
+void *allocator_realloc(struct Allocator *allocator, void *ptr,
+                        size_t oldSize, size_t size)
+{
+        if (allocator->realloc) {
+                return allocator->realloc(allocator, ptr, size);
+        }
+
+        void *result = allocator->alloc(allocator, size);
+        if (result && ptr) {
+                memcpy(result, ptr, oldSize < size ? oldSize : size);
+                allocator_free(allocator, ptr);
+        }
+
+        return result;
+}
+
+void *allocator_alloc_aligned(struct Allocator *allocator, size_t size,
+                              size_t alignment)
+{
+        if (allocator->alloc_aligned) {
+                return allocator->alloc_aligned(allocator, size, alignment);
+        }
+
+        if (alignment > _Alignof(max_align_t)) {
+                return NULL;
+        }
+
+        return allocator->alloc(allocator, size);
+}
+
 void allocator_free(struct Allocator *allocator, void *ptr)
 {
         if (allocator) {
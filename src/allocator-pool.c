@@ -0,0 +1,297 @@
+#include "pool_allocator_type.h"
+#include "pool_allocator.h"
+
+#include "allocator.h"
+
+#include <assert.h>
+#include <sched.h>
+#include <stdbool.h>
+
+enum {
+        POOL_CACHES = 8,
+        /// pools last released, whose slots threads may take back
+        POOL_RELEASED = 64,
+        POOL_LOCK_SPINS = 64,
+};
+
+static size_t const poolClassSizes[POOL_CLASSES] = {16, 32, 64, 128, 256};
+
+/// objects from the parent, too large for the pool
+#define POOL_LARGE (POOL_CLASSES)
+
+/* every object is preceded by its size class and the thread that
+ * allocated it */
+union PoolHeader
+{
+        struct
+        {
+                uint32_t sizeClass;
+                /// 0 for objects from the shared cache
+                uint64_t thread;
+        } info;
+        max_align_t align;
+};
+
+static _Thread_local struct PoolCache poolCaches[POOL_CACHES];
+static _Thread_local uint64_t poolThread;
+
+static atomic_uint_fast64_t poolLastId;
+static atomic_uint_fast64_t poolLastThread;
+
+/* ids are never reused, so an id found in there is always one of a
+ * released pool, even when read while overwritten */
+static atomic_uint_fast64_t poolReleasedIds[POOL_RELEASED];
+static atomic_uint_fast64_t poolReleasesCount;
+/// releases counted when this thread last looked for stale slots
+static _Thread_local uint64_t poolReleasesSeen;
+
+static uint64_t poolCurrentThread(void)
+{
+        if (!poolThread) {
+                poolThread = atomic_fetch_add(&poolLastThread, 1) + 1;
+        }
+
+        return poolThread;
+}
+
+static bool poolReleased(uint64_t const id)
+{
+        for (size_t i = 0; i < POOL_RELEASED; i++) {
+                if (atomic_load_explicit(&poolReleasedIds[i],
+                                         memory_order_relaxed) == id) {
+                        return true;
+                }
+        }
+
+        return false;
+}
+
+/* frees the slots of this thread taken by pools since released by other
+ * threads. what the slots held went back to the parent with the slabs.
+ *
+ * @return whether a slot was freed */
+static bool poolEvictReleased(void)
+{
+        uint64_t const releases = atomic_load(&poolReleasesCount);
+        if (releases == poolReleasesSeen) {
+                return false;
+        }
+        poolReleasesSeen = releases;
+
+        bool evicted = false;
+        for (size_t i = 0; i < POOL_CACHES; i++) {
+                struct PoolCache *slot = &poolCaches[i];
+                if (slot->poolId && poolReleased(slot->poolId)) {
+                        *slot = (struct PoolCache){0};
+                        evicted = true;
+                }
+        }
+
+        return evicted;
+}
+
+/* the slots of the caches are probed from the one of the pool. a pool
+ * finding them all taken by live pools is not cached, so that no cache is
+ * ever dropped with what it holds.
+ *
+ * @return NULL when the pool is not cached */
+static struct PoolCache *poolCache(struct PoolAllocator const *pool)
+{
+        do {
+                for (size_t i = 0; i < POOL_CACHES; i++) {
+                        struct PoolCache *slot =
+                            &poolCaches[(pool->id + i) % POOL_CACHES];
+                        if (slot->poolId == pool->id) {
+                                return slot;
+                        }
+                        if (slot->poolId == 0) {
+                                *slot = (struct PoolCache){.poolId = pool->id};
+                                return slot;
+                        }
+                }
+        } while (poolEvictReleased());
+
+        return NULL;
+}
+
+static size_t poolSizeClass(size_t const size)
+{
+        size_t sizeClass = 0;
+        while (sizeClass < POOL_CLASSES && poolClassSizes[sizeClass] < size) {
+                sizeClass++;
+        }
+
+        return sizeClass;
+}
+
+static bool poolRefill(struct PoolAllocator *pool, struct PoolCache *cache)
+{
+        struct PoolSlab *slab =
+            allocator_alloc(pool->parent, sizeof(union PoolHeader) +
+                                              pool->slabSize);
+        if (!slab) {
+                return false;
+        }
+
+        struct PoolSlab *head = atomic_load(&pool->slabs);
+        do {
+                slab->next = head;
+        } while (!atomic_compare_exchange_weak(&pool->slabs, &head, slab));
+        atomic_fetch_add(&pool->slabsCount, 1);
+
+        /* the slab link takes the room of one object header */
+        cache->cursor = (uint8_t *)slab + sizeof(union PoolHeader);
+        cache->end = cache->cursor + pool->slabSize;
+        return true;
+}
+
+static union PoolHeader *poolTake(struct PoolAllocator *pool,
+                                  struct PoolCache *cache,
+                                  size_t const sizeClass)
+{
+        struct PoolFreeObject *object = cache->freeLists[sizeClass];
+        if (!object) {
+                /* taking the whole list leaves no room for ABA */
+                object = atomic_exchange(&pool->remote[sizeClass], NULL);
+        }
+        if (object) {
+                cache->freeLists[sizeClass] = object->next;
+                return (union PoolHeader *)object - 1;
+        }
+
+        size_t const objectSize =
+            sizeof(union PoolHeader) + poolClassSizes[sizeClass];
+        if ((size_t)(cache->end - cache->cursor) < objectSize &&
+            !poolRefill(pool, cache)) {
+                return NULL;
+        }
+
+        union PoolHeader *header = (union PoolHeader *)cache->cursor;
+        cache->cursor += objectSize;
+        return header;
+}
+
+static void poolLock(struct PoolAllocator *pool)
+{
+        size_t spins = 0;
+        while (atomic_flag_test_and_set_explicit(&pool->sharedLock,
+                                                 memory_order_acquire)) {
+                if (++spins == POOL_LOCK_SPINS) {
+                        spins = 0;
+                        sched_yield();
+                }
+        }
+}
+
+static void poolUnlock(struct PoolAllocator *pool)
+{
+        atomic_flag_clear_explicit(&pool->sharedLock, memory_order_release);
+}
+
+static void *poolAlloc(struct Allocator *allocator, size_t size)
+{
+        struct PoolAllocator *self = (struct PoolAllocator *)allocator;
+        size_t const sizeClass = poolSizeClass(size);
+
+        union PoolHeader *header;
+        if (sizeClass == POOL_LARGE) {
+                header = allocator_alloc(self->parent, sizeof *header + size);
+                if (!header) {
+                        return NULL;
+                }
+                header->info.sizeClass = POOL_LARGE;
+                return header + 1;
+        }
+
+        struct PoolCache *cache = poolCache(self);
+        if (cache) {
+                header = poolTake(self, cache, sizeClass);
+        } else {
+                poolLock(self);
+                header = poolTake(self, &self->shared, sizeClass);
+                poolUnlock(self);
+        }
+        if (!header) {
+                return NULL;
+        }
+
+        header->info.sizeClass = (uint32_t)sizeClass;
+        header->info.thread = cache ? poolCurrentThread() : 0;
+        return header + 1;
+}
+
+static void poolFree(struct Allocator *allocator, void *ptr)
+{
+        struct PoolAllocator *self = (struct PoolAllocator *)allocator;
+        if (!ptr) {
+                return;
+        }
+
+        union PoolHeader *header = (union PoolHeader *)ptr - 1;
+        size_t const sizeClass = header->info.sizeClass;
+        if (sizeClass == POOL_LARGE) {
+                allocator_free(self->parent, header);
+                return;
+        }
+
+        struct PoolFreeObject *object = ptr;
+        if (header->info.thread == poolThread && poolThread) {
+                /* a thread allocating from the pool has it cached */
+                struct PoolCache *cache = poolCache(self);
+                assert(cache);
+                object->next = cache->freeLists[sizeClass];
+                cache->freeLists[sizeClass] = object;
+                return;
+        }
+
+        object->next = atomic_load(&self->remote[sizeClass]);
+        while (!atomic_compare_exchange_weak(&self->remote[sizeClass],
+                                             &object->next, object)) {
+        }
+}
+
+void pool_init(struct PoolAllocator *pool, struct Allocator *parent,
+               size_t slabSize)
+{
+        assert(slabSize >= sizeof(union PoolHeader) + POOL_MAX_OBJECT_SIZE);
+
+        pool->super = (struct Allocator){
+            .alloc = poolAlloc, .free = poolFree,
+        };
+        pool->parent = parent;
+        pool->slabSize = slabSize;
+        pool->id = atomic_fetch_add(&poolLastId, 1) + 1;
+        atomic_init(&pool->slabs, NULL);
+        atomic_init(&pool->slabsCount, 0);
+        for (size_t i = 0; i < POOL_CLASSES; i++) {
+                atomic_init(&pool->remote[i], NULL);
+        }
+        atomic_flag_clear(&pool->sharedLock);
+        pool->shared = (struct PoolCache){.poolId = pool->id};
+}
+
+void pool_release(struct PoolAllocator *pool)
+{
+        struct PoolSlab *slab = atomic_exchange(&pool->slabs, NULL);
+        while (slab) {
+                struct PoolSlab *next = slab->next;
+                allocator_free(pool->parent, slab);
+                slab = next;
+        }
+        atomic_store(&pool->slabsCount, 0);
+        for (size_t i = 0; i < POOL_CLASSES; i++) {
+                atomic_store(&pool->remote[i], NULL);
+        }
+        pool->shared = (struct PoolCache){.poolId = pool->id};
+
+        /* the slot of this thread is freed for other pools, those of
+         * other threads the next time they run out of slots */
+        for (size_t i = 0; i < POOL_CACHES; i++) {
+                struct PoolCache *slot = &poolCaches[i];
+                if (slot->poolId == pool->id) {
+                        *slot = (struct PoolCache){0};
+                }
+        }
+        uint64_t const release = atomic_fetch_add(&poolReleasesCount, 1);
+        atomic_store(&poolReleasedIds[release % POOL_RELEASED], pool->id);
+}
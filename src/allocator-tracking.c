@@ -0,0 +1,195 @@
+#include "tracking_allocator_type.h"
+#include "tracking_allocator.h"
+
+#include "allocator.h"
+
+#include <stdint.h>
+#include <string.h>
+
+/* every allocation is preceded by its header */
+struct TrackingHeader
+{
+        size_t size;
+        struct AllocationSite *site;
+        /// start of the allocation from the parent
+        void *base;
+        /// bytes from base to the allocation, the alignment of aligned ones
+        size_t offset;
+};
+
+union TrackingHeaderSlot
+{
+        struct TrackingHeader header;
+        max_align_t align;
+};
+
+static _Thread_local struct AllocationSite *currentSite;
+
+static struct TrackingHeader *headerOf(void *ptr)
+{
+        return &((union TrackingHeaderSlot *)ptr - 1)->header;
+}
+
+static size_t histogramBucket(size_t const size)
+{
+        size_t bucket = 0;
+        while (bucket < TRACKING_HISTOGRAM_SIZE - 1 &&
+               ((size_t)1 << bucket) < size) {
+                bucket++;
+        }
+
+        return bucket;
+}
+
+static void addLiveBytes(struct TrackingAllocator *self, size_t const size)
+{
+        size_t const live = atomic_fetch_add(&self->liveBytes, size) + size;
+        size_t peak = atomic_load(&self->peakBytes);
+        while (peak < live &&
+               !atomic_compare_exchange_weak(&self->peakBytes, &peak, live)) {
+        }
+}
+
+static void *track(struct TrackingAllocator *self, uint8_t *base,
+                   size_t const offset, size_t const size)
+{
+        struct AllocationSite *site = currentSite;
+        uint8_t *ptr = base + offset;
+
+        *headerOf(ptr) = (struct TrackingHeader){
+            .size = size, .site = site, .base = base, .offset = offset,
+        };
+
+        atomic_fetch_add(&self->allocations, 1);
+        atomic_fetch_add(&self->bytes, size);
+        atomic_fetch_add(&self->histogram[histogramBucket(size)], 1);
+        addLiveBytes(self, size);
+        if (site) {
+                atomic_fetch_add(&site->allocations, 1);
+                atomic_fetch_add(&site->bytes, size);
+                atomic_fetch_add(&site->liveBytes, size);
+        }
+
+        return ptr;
+}
+
+static void *trackingAlloc(struct Allocator *allocator, size_t size)
+{
+        struct TrackingAllocator *self = (struct TrackingAllocator *)allocator;
+
+        uint8_t *base = allocator_alloc(
+            self->parent, sizeof(union TrackingHeaderSlot) + size);
+        if (!base) {
+                return NULL;
+        }
+
+        return track(self, base, sizeof(union TrackingHeaderSlot), size);
+}
+
+static void *trackingAllocAligned(struct Allocator *allocator, size_t size,
+                                  size_t alignment)
+{
+        struct TrackingAllocator *self = (struct TrackingAllocator *)allocator;
+
+        /* the header takes a whole alignment unit */
+        size_t const offset = alignment > sizeof(union TrackingHeaderSlot)
+                                  ? alignment
+                                  : sizeof(union TrackingHeaderSlot);
+        uint8_t *base =
+            allocator_alloc_aligned(self->parent, offset + size, alignment);
+        if (!base) {
+                return NULL;
+        }
+
+        return track(self, base, offset, size);
+}
+
+static void untrack(struct TrackingAllocator *self,
+                    struct TrackingHeader const *header)
+{
+        atomic_fetch_sub(&self->liveBytes, header->size);
+        if (header->site) {
+                atomic_fetch_sub(&header->site->liveBytes, header->size);
+        }
+}
+
+static void trackingFree(struct Allocator *allocator, void *ptr)
+{
+        struct TrackingAllocator *self = (struct TrackingAllocator *)allocator;
+
+        if (!ptr) {
+                return;
+        }
+
+        struct TrackingHeader const *header = headerOf(ptr);
+        untrack(self, header);
+        atomic_fetch_add(&self->frees, 1);
+        allocator_free(self->parent, header->base);
+}
+
+static void *trackingRealloc(struct Allocator *allocator, void *ptr,
+                             size_t size)
+{
+        struct TrackingAllocator *self = (struct TrackingAllocator *)allocator;
+
+        if (!ptr) {
+                return trackingAlloc(allocator, size);
+        }
+
+        struct TrackingHeader const header = *headerOf(ptr);
+        if (header.offset != sizeof(union TrackingHeaderSlot)) {
+                /* keeps the alignment, which the parent does not know of */
+                void *moved = trackingAllocAligned(allocator, size,
+                                                   header.offset);
+                if (!moved) {
+                        return NULL;
+                }
+                memcpy(moved, ptr, header.size < size ? header.size : size);
+                trackingFree(allocator, ptr);
+                return moved;
+        }
+
+        uint8_t *base = allocator_realloc(self->parent, header.base,
+                                          header.offset + header.size,
+                                          header.offset + size);
+        if (!base) {
+                return NULL;
+        }
+
+        untrack(self, &header);
+        atomic_fetch_add(&self->frees, 1);
+        return track(self, base, header.offset, size);
+}
+
+void tracking_init(struct TrackingAllocator *tracker,
+                   struct Allocator *parent)
+{
+        *tracker = (struct TrackingAllocator){
+            .super =
+                (struct Allocator){
+                    .alloc = trackingAlloc,
+                    .free = trackingFree,
+                    .alloc_aligned = trackingAllocAligned,
+                    .realloc = trackingRealloc,
+                },
+            .parent = parent,
+        };
+}
+
+void tracking_reset(struct TrackingAllocator *tracker)
+{
+        atomic_store(&tracker->allocations, 0);
+        atomic_store(&tracker->frees, 0);
+        atomic_store(&tracker->bytes, 0);
+        atomic_store(&tracker->peakBytes, atomic_load(&tracker->liveBytes));
+        for (size_t i = 0; i < TRACKING_HISTOGRAM_SIZE; i++) {
+                atomic_store(&tracker->histogram[i], 0);
+        }
+}
+
+struct AllocationSite *tracking_set_site(struct AllocationSite *site)
+{
+        struct AllocationSite *previous = currentSite;
+        currentSite = site;
+        return previous;
+}
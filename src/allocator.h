@@ -6,3 +6,18 @@ struct Allocator;
 
 void *allocator_alloc(struct Allocator *allocator, size_t size);
 void allocator_free(struct Allocator *allocator, void *ptr);
+
+/**
+ * resizes ptr, of oldSize bytes, to size bytes.
+ *
+ * allocators without realloc get a new allocation and a copy.
+ *
+ * @return NULL when it fails, ptr is then left untouched
+ */
+void *allocator_realloc(struct Allocator *allocator, void *ptr,
+                        size_t oldSize, size_t size);
+
+/// @return NULL when the allocator cannot provide alignment, which it
+/// always can up to the alignment of max_align_t
+void *allocator_alloc_aligned(struct Allocator *allocator, size_t size,
+                              size_t alignment);
@@ -6,4 +6,13 @@ struct Allocator
 {
         void *(*alloc)(struct Allocator *self, size_t size);
         void (*free)(struct Allocator *self, void *ptr);
+
+        /// optional, allocation aligned to alignment, a power of two. the
+        /// memory is given back with free.
+        void *(*alloc_aligned)(struct Allocator *self, size_t size,
+                               size_t alignment);
+
+        /// optional, resizes an allocation made by alloc, moving it when
+        /// needed. NULL when it fails, ptr is then left untouched.
+        void *(*realloc)(struct Allocator *self, void *ptr, size_t size);
 };
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "arena_allocator_type.h"
+
+#include <stddef.h>
+
+/// initializes an empty arena, which gets its blocks from parent
+void arena_init(struct ArenaAllocator *arena, struct Allocator *parent,
+                size_t blockSize);
+
+/// gives all blocks back to the parent allocator
+void arena_release(struct ArenaAllocator *arena);
+
+/// current allocation position
+struct ArenaMark arena_mark(struct ArenaAllocator const *arena);
+
+/// frees in O(1) everything allocated since mark was taken
+void arena_reset(struct ArenaAllocator *arena, struct ArenaMark mark);
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "allocator_type.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file
+ * Bump-pointer allocation out of blocks obtained from a parent allocator.
+ */
+
+struct ArenaBlock
+{
+        struct ArenaBlock *next;
+        uint8_t *start;
+        uint8_t *end;
+};
+
+/**
+ * Arena allocator.
+ *
+ * Allocations bump a cursor inside the current block, free is a no-op.
+ * Memory is given back all at once by resetting to a previously taken
+ * mark. Blocks past the mark are kept around and reused by later
+ * allocations.
+ */
+struct ArenaAllocator
+{
+        struct Allocator super;
+        struct Allocator *parent;
+        size_t blockSize;
+        struct ArenaBlock *first;
+        struct ArenaBlock *current;
+        uint8_t *cursor;
+};
+
+/**
+ * allocation position of an arena, as returned by arena_mark()
+ */
+struct ArenaMark
+{
+        struct ArenaBlock *block;
+        uint8_t *cursor;
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "value_stream_types.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct Allocator;
+struct StreamRange;
+
+enum BlockEncoding {
+        /// float bit patterns as zigzag varints of their differences
+        BE_FloatDelta,
+        /// Gorilla-style XOR of consecutive float bit patterns
+        BE_FloatXor,
+        /// LZ4 frames
+        BE_LZ4,
+};
+
+/**
+ * Stream of the elements decoded from a stream of encoded blocks, one
+ * block at a time into buffers reused from block to block.
+ *
+ * see floatBlocksVSR() and lz4FrameVSR()
+ */
+struct BlockDecoderStream
+{
+        struct ValueStreamRange range;
+        struct StreamRange *source;
+        enum BlockEncoding encoding;
+        struct Allocator *allocator;
+
+        uint8_t *encoded;
+        size_t encodedCapacity;
+        uint8_t *decoded;
+        size_t decodedCapacity;
+        /// end of the bytes decoded so far
+        uint8_t *written;
+
+        /* LZ4 frames */
+        bool inFrame;
+        bool linkedBlocks;
+        bool blockChecksums;
+        bool contentChecksum;
+        size_t blockMaxSize;
+        /// bytes of the frame decoded in front of the current block
+        size_t history;
+};
@@ -0,0 +1,694 @@
+#include "block_decoder_types.h"
+#include "block_decoders.h"
+#include "stream_types.h"
+#include "value_stream_types.h"
+
+#include "allocator.h"
+#include "failed_streams.h"
+#include "values.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+enum {
+        FLOAT_BLOCK_HEADER_SIZE = 8,
+        /// refuses headers of more values, which must be corrupt
+        FLOAT_BLOCK_MAX_COUNT = 1 << 24,
+        LZ4_MAGIC = 0x184D2204,
+        LZ4_SKIPPABLE_MAGIC = 0x184D2A50,
+        /// bytes of history the matches of linked blocks may refer to
+        LZ4_HISTORY_SIZE = 64 * 1024,
+};
+
+/* reading the source */
+
+enum ReadResult {
+        RR_Read,
+        /// the source ended before the first byte
+        RR_Ended,
+        RR_Failed,
+};
+
+static enum ReadResult readSource(struct StreamRange *source, void *output,
+                                  size_t size)
+{
+        uint8_t *bytes = output;
+        size_t read = 0;
+
+        while (read < size) {
+                if (source->cursor == source->end) {
+                        enum StreamErrorCode const error =
+                            source->next(source);
+                        if (error != S_NoError) {
+                                return read == 0 && error == S_ReadPastEnd
+                                           ? RR_Ended
+                                           : RR_Failed;
+                        }
+                        continue;
+                }
+
+                size_t n = (size_t)(source->end - source->cursor);
+                if (n > size - read) {
+                        n = size - read;
+                }
+                memcpy(bytes + read, source->cursor, n);
+                source->cursor += n;
+                read += n;
+        }
+
+        return RR_Read;
+}
+
+static bool skipSource(struct StreamRange *source, size_t size)
+{
+        uint8_t scratch[256];
+
+        while (size > 0) {
+                size_t const n = size < sizeof scratch ? size : sizeof scratch;
+                if (readSource(source, scratch, n) != RR_Read) {
+                        return false;
+                }
+                size -= n;
+        }
+
+        return true;
+}
+
+static uint32_t load32(uint8_t const *bytes)
+{
+        return (uint32_t)bytes[0] | (uint32_t)bytes[1] << 8 |
+               (uint32_t)bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+}
+
+static void store32(uint8_t *bytes, uint32_t const value)
+{
+        bytes[0] = (uint8_t)value;
+        bytes[1] = (uint8_t)(value >> 8);
+        bytes[2] = (uint8_t)(value >> 16);
+        bytes[3] = (uint8_t)(value >> 24);
+}
+
+/// grows a buffer, without keeping its contents
+static bool reserve(struct Allocator *allocator, uint8_t **buffer,
+                    size_t *capacity, size_t const size)
+{
+        if (size <= *capacity) {
+                return true;
+        }
+
+        uint8_t *grown = allocator_alloc(allocator, size);
+        if (!grown) {
+                return false;
+        }
+        allocator_free(allocator, *buffer);
+        *buffer = grown;
+        *capacity = size;
+
+        return true;
+}
+
+/* float bit patterns */
+
+static uint32_t floatBits(float const value)
+{
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof bits);
+        return bits;
+}
+
+static float bitsFloat(uint32_t const bits)
+{
+        float value;
+        memcpy(&value, &bits, sizeof value);
+        return value;
+}
+
+static unsigned leadingZeros(uint32_t x)
+{
+        unsigned n = 0;
+        for (uint32_t bit = UINT32_C(1) << 31; bit && !(x & bit); bit >>= 1) {
+                n++;
+        }
+        return n;
+}
+
+static unsigned trailingZeros(uint32_t x)
+{
+        unsigned n = 0;
+        for (uint32_t bit = 1; bit && !(x & bit); bit <<= 1) {
+                n++;
+        }
+        return n;
+}
+
+/* delta: zigzag LEB128 varints of the differences of the bit patterns */
+
+static size_t deltaEncode(float const *values, size_t const count,
+                          uint8_t *output)
+{
+        uint8_t *out = output;
+        uint32_t previous = 0;
+
+        for (size_t i = 0; i < count; i++) {
+                uint32_t const bits = floatBits(values[i]);
+                uint32_t const delta = bits - previous;
+                uint32_t const sign = (uint32_t)-(int32_t)(delta >> 31);
+                uint32_t zigzag = delta << 1 ^ sign;
+                previous = bits;
+
+                while (zigzag >= 0x80) {
+                        *out++ = (uint8_t)(zigzag | 0x80);
+                        zigzag >>= 7;
+                }
+                *out++ = (uint8_t)zigzag;
+        }
+
+        return (size_t)(out - output);
+}
+
+static bool deltaDecode(uint8_t const *input, size_t const size,
+                        float *values, size_t const count)
+{
+        uint8_t const *in = input, *const end = input + size;
+        uint32_t previous = 0;
+
+        for (size_t i = 0; i < count; i++) {
+                uint32_t zigzag = 0;
+                for (unsigned shift = 0;; shift += 7) {
+                        if (in == end || shift > 28) {
+                                return false;
+                        }
+                        uint8_t const byte = *in++;
+                        zigzag |= (uint32_t)(byte & 0x7f) << shift;
+                        if (!(byte & 0x80)) {
+                                break;
+                        }
+                }
+
+                previous += zigzag >> 1 ^ (uint32_t)-(int32_t)(zigzag & 1);
+                values[i] = bitsFloat(previous);
+        }
+
+        return in == end;
+}
+
+/* xor: Gorilla's encoding for 32-bit patterns
+ *
+ * - 0: same as the previous value
+ * - 10, then the meaningful bits: they fit in the previous window
+ * - 11, 5 bits of leading zeros, 5 bits of meaningful length - 1, then
+ *   the meaningful bits. */
+
+struct BitWriter
+{
+        uint8_t *out;
+        uint64_t bits;
+        unsigned count;
+};
+
+static void writeBits(struct BitWriter *writer, uint32_t const value,
+                      unsigned const width)
+{
+        for (unsigned i = width; i > 0; i--) {
+                writer->bits = writer->bits << 1 | (value >> (i - 1) & 1);
+                if (++writer->count == 8) {
+                        *writer->out++ = (uint8_t)writer->bits;
+                        writer->bits = 0;
+                        writer->count = 0;
+                }
+        }
+}
+
+static void flushBits(struct BitWriter *writer)
+{
+        if (writer->count > 0) {
+                *writer->out++ = (uint8_t)(writer->bits << (8 - writer->count));
+                writer->bits = 0;
+                writer->count = 0;
+        }
+}
+
+struct BitReader
+{
+        uint8_t const *in;
+        uint8_t const *end;
+        unsigned bit;
+};
+
+static bool readBits(struct BitReader *reader, unsigned const width,
+                     uint32_t *value)
+{
+        uint32_t result = 0;
+        for (unsigned i = 0; i < width; i++) {
+                if (reader->in == reader->end) {
+                        return false;
+                }
+                result = result << 1 | (*reader->in >> (7 - reader->bit) & 1);
+                if (++reader->bit == 8) {
+                        reader->in++;
+                        reader->bit = 0;
+                }
+        }
+        *value = result;
+
+        return true;
+}
+
+static size_t xorEncode(float const *values, size_t const count,
+                        uint8_t *output)
+{
+        struct BitWriter writer = {.out = output};
+        uint32_t previous = 0;
+        unsigned leading = 0, length = 0;
+
+        for (size_t i = 0; i < count; i++) {
+                uint32_t const bits = floatBits(values[i]);
+                uint32_t const x = bits ^ previous;
+                previous = bits;
+
+                if (x == 0) {
+                        writeBits(&writer, 0, 1);
+                        continue;
+                }
+
+                unsigned const lead = leadingZeros(x);
+                unsigned const trail = trailingZeros(x);
+                if (length > 0 && lead >= leading &&
+                    trail >= 32 - leading - length) {
+                        writeBits(&writer, 2, 2);
+                        writeBits(&writer, x >> (32 - leading - length),
+                                  length);
+                        continue;
+                }
+
+                leading = lead;
+                length = 32 - lead - trail;
+                writeBits(&writer, 3, 2);
+                writeBits(&writer, leading, 5);
+                writeBits(&writer, length - 1, 5);
+                writeBits(&writer, x >> trail, length);
+        }
+        flushBits(&writer);
+
+        return (size_t)(writer.out - output);
+}
+
+static bool xorDecode(uint8_t const *input, size_t const size, float *values,
+                      size_t const count)
+{
+        struct BitReader reader = {.in = input, .end = input + size};
+        uint32_t previous = 0;
+        uint32_t leading = 0, length = 0;
+
+        for (size_t i = 0; i < count; i++) {
+                uint32_t control;
+                if (!readBits(&reader, 1, &control)) {
+                        return false;
+                }
+                if (control) {
+                        if (!readBits(&reader, 1, &control)) {
+                                return false;
+                        }
+                        if (control) {
+                                if (!readBits(&reader, 5, &leading) ||
+                                    !readBits(&reader, 5, &length)) {
+                                        return false;
+                                }
+                                length++;
+                                if (leading + length > 32) {
+                                        return false;
+                                }
+                        } else if (length == 0) {
+                                return false;
+                        }
+
+                        uint32_t meaningful;
+                        if (!readBits(&reader, length, &meaningful)) {
+                                return false;
+                        }
+                        previous ^= meaningful << (32 - leading - length);
+                }
+                values[i] = bitsFloat(previous);
+        }
+
+        return true;
+}
+
+/* float blocks */
+
+size_t floatBlockBound(size_t const count)
+{
+        /* at most 5 bytes per varint, and 44 bits per xor'ed value */
+        return FLOAT_BLOCK_HEADER_SIZE + (44 * count + 7) / 8;
+}
+
+size_t floatBlockEncode(enum BlockEncoding const encoding,
+                        float const *values, size_t const count,
+                        uint8_t *output)
+{
+        uint8_t *payload = output + FLOAT_BLOCK_HEADER_SIZE;
+        size_t const size = encoding == BE_FloatXor
+                                ? xorEncode(values, count, payload)
+                                : deltaEncode(values, count, payload);
+
+        store32(output, (uint32_t)count);
+        store32(output + 4, (uint32_t)size);
+
+        return FLOAT_BLOCK_HEADER_SIZE + size;
+}
+
+static enum StreamErrorCode floatBlocksNext(struct ValueStreamRange *range)
+{
+        struct BlockDecoderStream *stream = (struct BlockDecoderStream *)range;
+
+        uint8_t header[FLOAT_BLOCK_HEADER_SIZE];
+        uint32_t count;
+        do {
+                enum ReadResult const read =
+                    readSource(stream->source, header, sizeof header);
+                if (read != RR_Read) {
+                        return value_stream_fail(range, read == RR_Ended
+                                                  ? S_ReadPastEnd
+                                                  : S_IOError);
+                }
+                count = load32(header);
+        } while (count == 0 && load32(header + 4) == 0);
+
+        size_t const size = load32(header + 4);
+        if (count > FLOAT_BLOCK_MAX_COUNT || size > floatBlockBound(count) ||
+            !reserve(stream->allocator, &stream->encoded,
+                     &stream->encodedCapacity, size) ||
+            !reserve(stream->allocator, &stream->decoded,
+                     &stream->decodedCapacity, count * sizeof(float)) ||
+            readSource(stream->source, stream->encoded, size) != RR_Read) {
+                return value_stream_fail(range, S_IOError);
+        }
+
+        float *values = (float *)stream->decoded;
+        bool const decoded =
+            stream->encoding == BE_FloatXor
+                ? xorDecode(stream->encoded, size, values, count)
+                : deltaDecode(stream->encoded, size, values, count);
+        if (!decoded || count == 0) {
+                return value_stream_fail(range, S_IOError);
+        }
+
+        range->start = stream->decoded;
+        range->cursor = stream->decoded;
+        range->end = stream->decoded + count * sizeof(float);
+
+        return range->error;
+}
+
+void floatBlocksVSR(struct BlockDecoderStream *stream,
+                    struct StreamRange *source, enum BlockEncoding encoding,
+                    struct Allocator *allocator)
+{
+        *stream = (struct BlockDecoderStream){
+            .range =
+                {
+                    .type_tag = TTAG_FLOAT,
+                    .element_size = sizeof(float),
+                    .error = S_NoError,
+                    .next = floatBlocksNext,
+                },
+            .source = source,
+            .encoding = encoding,
+            .allocator = allocator,
+        };
+}
+
+/* LZ4 */
+
+static bool lz4Length(uint8_t const **in, uint8_t const *end, size_t *length)
+{
+        if (*length != 15) {
+                return true;
+        }
+
+        uint8_t byte;
+        do {
+                if (*in == end) {
+                        return false;
+                }
+                byte = *(*in)++;
+                *length += byte;
+        } while (byte == 255);
+
+        return true;
+}
+
+/**
+ * decodes an LZ4 block to [output, outputEnd), matches reaching back as
+ * far as history.
+ *
+ * @return the end of the decoded bytes, NULL for corrupt blocks
+ */
+static uint8_t *lz4DecodeBlock(uint8_t const *input, size_t const size,
+                               uint8_t const *history, uint8_t *output,
+                               uint8_t const *outputEnd)
+{
+        uint8_t const *in = input, *const end = input + size;
+        uint8_t *out = output;
+
+        while (in < end) {
+                uint8_t const token = *in++;
+
+                size_t literals = token >> 4;
+                if (!lz4Length(&in, end, &literals) ||
+                    literals > (size_t)(end - in) ||
+                    literals > (size_t)(outputEnd - out)) {
+                        return NULL;
+                }
+                memcpy(out, in, literals);
+                out += literals;
+                in += literals;
+
+                /* the last sequence has no match */
+                if (in == end) {
+                        break;
+                }
+
+                if (end - in < 2) {
+                        return NULL;
+                }
+                size_t const offset = (size_t)in[0] | (size_t)in[1] << 8;
+                in += 2;
+                size_t length = token & 15;
+                if (offset == 0 || offset > (size_t)(out - history) ||
+                    !lz4Length(&in, end, &length)) {
+                        return NULL;
+                }
+                length += 4;
+                if (length > (size_t)(outputEnd - out)) {
+                        return NULL;
+                }
+
+                /* overlapping matches repeat the last offset bytes */
+                while (length > 0) {
+                        size_t const n = length < offset ? length : offset;
+                        memcpy(out, out - offset, n);
+                        out += n;
+                        length -= n;
+                }
+        }
+
+        return out;
+}
+
+static size_t lz4HistorySize(struct BlockDecoderStream const *stream)
+{
+        return stream->linkedBlocks ? LZ4_HISTORY_SIZE : 0;
+}
+
+/// reads a frame header, skipping skippable frames
+static enum ReadResult lz4ReadFrameHeader(struct BlockDecoderStream *stream)
+{
+        for (;;) {
+                uint8_t bytes[4];
+                enum ReadResult const read =
+                    readSource(stream->source, bytes, sizeof bytes);
+                if (read != RR_Read) {
+                        return read;
+                }
+
+                uint32_t const magic = load32(bytes);
+                if ((magic & 0xFFFFFFF0u) == LZ4_SKIPPABLE_MAGIC) {
+                        if (readSource(stream->source, bytes, 4) != RR_Read ||
+                            !skipSource(stream->source, load32(bytes))) {
+                                return RR_Failed;
+                        }
+                        continue;
+                }
+                if (magic != LZ4_MAGIC ||
+                    readSource(stream->source, bytes, 2) != RR_Read) {
+                        return RR_Failed;
+                }
+
+                uint8_t const flags = bytes[0];
+                unsigned const blockMaxId = bytes[1] >> 4 & 7;
+                bool const contentSize = flags & 0x08;
+                bool const dictionary = flags & 0x01;
+                if ((flags >> 6) != 1 || dictionary || blockMaxId < 4) {
+                        return RR_Failed;
+                }
+
+                stream->linkedBlocks = !(flags & 0x20);
+                stream->blockChecksums = flags & 0x10;
+                stream->contentChecksum = flags & 0x04;
+                stream->blockMaxSize = (size_t)1 << (8 + 2 * blockMaxId);
+
+                /* content size, then the header checksum */
+                if (!skipSource(stream->source, (contentSize ? 8 : 0) + 1)) {
+                        return RR_Failed;
+                }
+
+                return RR_Read;
+        }
+}
+
+static enum StreamErrorCode lz4FrameNext(struct ValueStreamRange *range)
+{
+        struct BlockDecoderStream *stream = (struct BlockDecoderStream *)range;
+        size_t const elementSize = range->element_size;
+
+        for (;;) {
+                bool const frameStart = !stream->inFrame;
+                if (frameStart) {
+                        enum ReadResult const read =
+                            lz4ReadFrameHeader(stream);
+                        if (read != RR_Read) {
+                                return value_stream_fail(range, read == RR_Ended
+                                                          ? S_ReadPastEnd
+                                                          : S_IOError);
+                        }
+                        stream->inFrame = true;
+                }
+
+                /* keeps the history and the bytes not consumed yet in
+                 * front of the next block, those landing at the aligned
+                 * offset historySize */
+                size_t const historySize = lz4HistorySize(stream);
+                uint8_t const *consumed = range->cursor;
+                size_t const partial =
+                    stream->written ? (size_t)(stream->written - consumed)
+                                    : 0;
+                size_t const capacity =
+                    historySize + partial + stream->blockMaxSize;
+                /* frames do not refer to each other, and only bytes
+                 * decoded count as history */
+                size_t history = 0;
+                if (stream->written && !frameStart) {
+                        uint8_t const *blockStart =
+                            stream->decoded + historySize;
+                        history = stream->history +
+                                  (size_t)(consumed - blockStart);
+                }
+                if (history > historySize) {
+                        history = historySize;
+                }
+                stream->history = history;
+
+                if (capacity > stream->decodedCapacity) {
+                        uint8_t *grown =
+                            allocator_alloc(stream->allocator, capacity);
+                        if (!grown) {
+                                return value_stream_fail(range, S_IOError);
+                        }
+                        if (stream->written) {
+                                memcpy(grown + historySize - history,
+                                       consumed - history, history + partial);
+                        }
+                        allocator_free(stream->allocator, stream->decoded);
+                        stream->decoded = grown;
+                        stream->decodedCapacity = capacity;
+                } else if (stream->written) {
+                        memmove(stream->decoded + historySize - history,
+                                consumed - history, history + partial);
+                }
+                uint8_t *const start = stream->decoded + historySize;
+                stream->written = start + partial;
+
+                uint8_t bytes[4];
+                if (readSource(stream->source, bytes, 4) != RR_Read) {
+                        return value_stream_fail(range, S_IOError);
+                }
+                uint32_t const blockSize = load32(bytes) & 0x7FFFFFFFu;
+                bool const uncompressed = load32(bytes) & 0x80000000u;
+
+                if (load32(bytes) == 0) {
+                        /* end mark */
+                        stream->inFrame = false;
+                        if (stream->contentChecksum &&
+                            !skipSource(stream->source, 4)) {
+                                return value_stream_fail(range, S_IOError);
+                        }
+                        range->cursor = start;
+                        continue;
+                }
+
+                if (blockSize > stream->blockMaxSize ||
+                    !reserve(stream->allocator, &stream->encoded,
+                             &stream->encodedCapacity, blockSize) ||
+                    readSource(stream->source, stream->encoded, blockSize) !=
+                        RR_Read ||
+                    (stream->blockChecksums &&
+                     !skipSource(stream->source, 4))) {
+                        return value_stream_fail(range, S_IOError);
+                }
+
+                uint8_t *const outputEnd =
+                    stream->written + stream->blockMaxSize;
+                if (uncompressed) {
+                        memcpy(stream->written, stream->encoded, blockSize);
+                        stream->written += blockSize;
+                } else {
+                        uint8_t const *historyStart =
+                            stream->linkedBlocks ? start - history
+                                                 : stream->written;
+                        stream->written = lz4DecodeBlock(
+                            stream->encoded, blockSize, historyStart,
+                            stream->written, outputEnd);
+                        if (!stream->written) {
+                                return value_stream_fail(range, S_IOError);
+                        }
+                }
+
+                size_t const available = (size_t)(stream->written - start);
+                range->start = start;
+                range->cursor = start;
+                range->end = start + available / elementSize * elementSize;
+                if (range->end > range->start) {
+                        return range->error;
+                }
+        }
+}
+
+void lz4FrameVSR(struct BlockDecoderStream *stream,
+                 struct StreamRange *source, int type_tag,
+                 size_t element_size, struct Allocator *allocator)
+{
+        *stream = (struct BlockDecoderStream){
+            .range =
+                {
+                    .type_tag = type_tag,
+                    .element_size = element_size,
+                    .error = S_NoError,
+                    .next = lz4FrameNext,
+                },
+            .source = source,
+            .encoding = BE_LZ4,
+            .allocator = allocator,
+        };
+}
+
+void closeBlockDecoderVSR(struct BlockDecoderStream *stream)
+{
+        allocator_free(stream->allocator, stream->encoded);
+        allocator_free(stream->allocator, stream->decoded);
+        stream->encoded = NULL;
+        stream->decoded = NULL;
+        stream->encodedCapacity = 0;
+        stream->decodedCapacity = 0;
+        stream->written = NULL;
+}
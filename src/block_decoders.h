@@ -0,0 +1,61 @@
+#pragma once
+
+/**
+ * @file
+ * Decoders turning streams of encoded blocks into value streams.
+ *
+ * Blocks are read from a byte stream and decoded one at a time, so that
+ * the memory used stays bounded by the largest block, and decoding
+ * interleaves with the reduction of the decoded values.
+ *
+ * Float blocks are made of a header, the count of values and the size in
+ * bytes of the payload as little-endian uint32, followed by the payload.
+ * Each block starts afresh, its first value being encoded against 0.
+ */
+
+#include "block_decoder_types.h"
+#include "stream_types.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct Allocator;
+struct StreamRange;
+
+/**
+ * floats per block for which a block and its encoding stay in a 256KiB L2
+ * cache
+ */
+enum { FLOAT_BLOCK_COUNT = 16 * 1024 };
+
+/// largest size of the encoding of a block of count floats
+size_t floatBlockBound(size_t count);
+
+/**
+ * encodes values as a single block at output, of at least
+ * floatBlockBound(count) bytes.
+ *
+ * @return bytes written
+ */
+size_t floatBlockEncode(enum BlockEncoding encoding, float const *values,
+                        size_t count, uint8_t *output);
+
+/// stream of the TTAG_FLOAT values of the BE_FloatDelta or BE_FloatXor
+/// blocks read from source
+void floatBlocksVSR(struct BlockDecoderStream *stream,
+                    struct StreamRange *source, enum BlockEncoding encoding,
+                    struct Allocator *allocator);
+
+/**
+ * stream of the elements decompressed from the LZ4 frames read from
+ * source.
+ *
+ * linked and independent blocks are supported, dictionaries are not.
+ * checksums are skipped without being verified.
+ */
+void lz4FrameVSR(struct BlockDecoderStream *stream,
+                 struct StreamRange *source, int type_tag,
+                 size_t element_size, struct Allocator *allocator);
+
+/// gives the buffers back
+void closeBlockDecoderVSR(struct BlockDecoderStream *stream);
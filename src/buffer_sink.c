@@ -0,0 +1,146 @@
+#include "buffer_sink.h"
+#include "buffer_sink_types.h"
+
+#include "allocator.h"
+#include "stream_types.h"
+#include "values.h"
+
+#include <assert.h>
+#include <string.h>
+
+enum { BUFFER_SINK_MIN_CAPACITY = 64 };
+
+static bool bufferSinkReserve(struct BufferSink *self, size_t const size)
+{
+        if (size <= self->capacity) {
+                return true;
+        }
+
+        size_t capacity =
+            self->capacity ? self->capacity : BUFFER_SINK_MIN_CAPACITY;
+        while (capacity < size) {
+                capacity *= 2;
+        }
+
+        size_t const used = self->count * self->element_size;
+        uint8_t *data =
+            allocator_realloc(self->allocator, self->data, used, capacity);
+        if (!data) {
+                return false;
+        }
+
+        self->data = data;
+        self->capacity = capacity;
+        return true;
+}
+
+/// @return the number of bytes written
+static size_t bufferSinkWrite(struct BufferSink *self, uint8_t const *bytes,
+                              size_t const size)
+{
+        struct OutputStreamRange *output = self->output;
+        if (!output) {
+                size_t const used = self->count * self->element_size;
+                if (!bufferSinkReserve(self, used + size)) {
+                        return 0;
+                }
+                memcpy(self->data + used, bytes, size);
+                return size;
+        }
+
+        size_t written = 0;
+        while (written < size) {
+                if (output->cursor == output->end &&
+                    output->next(output) != S_NoError) {
+                        break;
+                }
+
+                size_t const room = (size_t)(output->end - output->cursor);
+                size_t const left = size - written;
+                size_t const n = left < room ? left : room;
+                memcpy(output->cursor, bytes + written, n);
+                output->cursor += n;
+                written += n;
+        }
+
+        return written;
+}
+
+static struct Value bufferSinkAppend(struct BufferSink *self,
+                                     uint32_t const type_tag,
+                                     size_t const element_size,
+                                     uint8_t const *bytes, size_t count)
+{
+        if (self->count == 0) {
+                self->type_tag = type_tag;
+                self->element_size = element_size;
+        }
+        assert(type_tag == self->type_tag &&
+               element_size == self->element_size);
+
+        size_t const size = count * element_size;
+        size_t const written = bufferSinkWrite(self, bytes, size);
+        self->count += written / element_size;
+        if (written < size) {
+                return reduced(indexImmediate(self->count));
+        }
+
+        return indexImmediate(self->count);
+}
+
+static struct Value bufferSinkIdentity(struct Reducer const *reducer,
+                                       struct Allocator *allocator)
+{
+        return indexImmediate(0);
+}
+
+static struct Value bufferSinkApply(struct Reducer const *reducer,
+                                    struct Value input, struct Value current,
+                                    struct Allocator *allocator)
+{
+        struct BufferSink *self = (struct BufferSink *)reducer;
+        return bufferSinkAppend(self, input.type_tag, input.element_size,
+                                valuePayload(&input), 1);
+}
+
+static struct Value bufferSinkApplyBatch(struct Reducer const *reducer,
+                                         struct ValueSpan span,
+                                         struct Value current,
+                                         struct Allocator *allocator)
+{
+        struct BufferSink *self = (struct BufferSink *)reducer;
+        if (span.start == span.end) {
+                return current;
+        }
+
+        return bufferSinkAppend(self, span.type_tag, span.element_size,
+                                span.start, valueSpanCount(&span));
+}
+
+void bufferSinkInit(struct BufferSink *sink, struct Allocator *allocator)
+{
+        *sink = (struct BufferSink){
+            .super =
+                {
+                    .identity = bufferSinkIdentity,
+                    .apply = bufferSinkApply,
+                    .apply_batch = bufferSinkApplyBatch,
+                },
+            .allocator = allocator,
+        };
+}
+
+void bufferSinkOnOutput(struct BufferSink *sink,
+                        struct OutputStreamRange *output)
+{
+        bufferSinkInit(sink, NULL);
+        sink->output = output;
+}
+
+void bufferSinkRelease(struct BufferSink *sink)
+{
+        allocator_free(sink->allocator, sink->data);
+        sink->data = NULL;
+        sink->capacity = 0;
+        sink->count = 0;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+/**
+ * @file
+ * Sinks collecting the results of a reduction.
+ *
+ * The sink is itself the step reducer, `&sink.super`. Its result is the
+ * number of elements appended, as a TTAG_INDEX value.
+ */
+
+#include "buffer_sink_types.h"
+
+#include <stddef.h>
+
+struct Allocator;
+struct OutputStreamRange;
+
+/// collects into a buffer from allocator, grown with allocator_realloc
+void bufferSinkInit(struct BufferSink *sink, struct Allocator *allocator);
+
+/**
+ * writes the payloads straight into the windows of output.
+ *
+ * the reduction is halted when output fails.
+ */
+void bufferSinkOnOutput(struct BufferSink *sink,
+                        struct OutputStreamRange *output);
+
+/// gives the buffer back
+void bufferSinkRelease(struct BufferSink *sink);
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "transducer_types.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct Allocator;
+struct OutputStreamRange;
+
+/**
+ * Reducer appending the payloads of its inputs, all of one size, either to
+ * a contiguous buffer or to an output stream.
+ *
+ * see bufferSinkInit() and bufferSinkOnOutput()
+ */
+struct BufferSink
+{
+        struct Reducer super;
+        uint32_t type_tag;
+        size_t element_size;
+        /// elements appended so far
+        size_t count;
+
+        /// grown geometrically, count elements long
+        uint8_t *data;
+        size_t capacity;
+        struct Allocator *allocator;
+
+        /// when set, elements go there instead of data
+        struct OutputStreamRange *output;
+};
@@ -0,0 +1,127 @@
+#include "chain_builder.h"
+#include "chain_builder_types.h"
+
+#include "alignment.h"
+#include "allocator.h"
+#include "allocator_type.h"
+#include "arena_allocator.h"
+#include "transducers.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define BUILDER_ALIGNMENT (_Alignof(max_align_t))
+
+/// sums the sizes of the allocations it forwards to an arena
+struct MeasuringAllocator
+{
+        struct Allocator super;
+        struct ArenaAllocator arena;
+        size_t size;
+};
+
+static void *measuringAlloc(struct Allocator *allocator, size_t size)
+{
+        struct MeasuringAllocator *self =
+            (struct MeasuringAllocator *)allocator;
+
+        self->size += alignUp(size ? size : 1);
+        return allocator_alloc(&self->arena.super, size);
+}
+
+/* counts the padding of the worst placement */
+static void *measuringAllocAligned(struct Allocator *allocator, size_t size,
+                                   size_t alignment)
+{
+        struct MeasuringAllocator *self =
+            (struct MeasuringAllocator *)allocator;
+
+        self->size += alignUp(size ? size : 1);
+        if (alignment > BUILDER_ALIGNMENT) {
+                self->size += alignment - BUILDER_ALIGNMENT;
+        }
+        return allocator_alloc_aligned(&self->arena.super, size, alignment);
+}
+
+static void measuringFree(struct Allocator *allocator, void *ptr) {}
+
+/* hands out consecutive parts of a block, never freeing them. it lives at
+ * the start of the block it hands out, as the chains it builds may keep
+ * it as their parent allocator. */
+struct BlockAllocator
+{
+        struct Allocator super;
+        uint8_t *cursor;
+        uint8_t *end;
+        /// set once an allocation did not fit
+        bool exhausted;
+};
+
+static void *blockAllocAligned(struct Allocator *allocator, size_t size,
+                               size_t alignment)
+{
+        struct BlockAllocator *self = (struct BlockAllocator *)allocator;
+
+        size = alignUp(size ? size : 1);
+        size_t const padding =
+            (alignment - (uintptr_t)self->cursor % alignment) % alignment;
+        if ((size_t)(self->end - self->cursor) < padding + size) {
+                self->exhausted = true;
+                return NULL;
+        }
+
+        void *result = self->cursor + padding;
+        self->cursor += padding + size;
+        return result;
+}
+
+static void *blockAlloc(struct Allocator *allocator, size_t size)
+{
+        return blockAllocAligned(allocator, size, BUILDER_ALIGNMENT);
+}
+
+static void blockFree(struct Allocator *allocator, void *ptr) {}
+
+struct ChainBuilder chainBuilderMake(struct Transducer *transducer,
+                                     struct Reducer const *step,
+                                     struct Allocator *allocator)
+{
+        struct MeasuringAllocator measuring = {
+            .super = {.alloc = measuringAlloc,
+                      .free = measuringFree,
+                      .alloc_aligned = measuringAllocAligned},
+        };
+        arena_init(&measuring.arena, allocator, 1024);
+        transducer_apply(transducer, step, &measuring.super);
+        arena_release(&measuring.arena);
+
+        return (struct ChainBuilder){
+            .transducer = transducer,
+            .step = step,
+            .chainSize =
+                alignUp(sizeof(struct BlockAllocator)) + measuring.size,
+        };
+}
+
+struct Reducer *chain_builder_build(struct ChainBuilder const *builder,
+                                    void *chain)
+{
+        assert((uintptr_t)chain % BUILDER_ALIGNMENT == 0);
+
+        struct BlockAllocator *block = chain;
+        *block = (struct BlockAllocator){
+            .super = {.alloc = blockAlloc,
+                      .free = blockFree,
+                      .alloc_aligned = blockAllocAligned},
+            .cursor = (uint8_t *)chain + alignUp(sizeof *block),
+            .end = (uint8_t *)chain + builder->chainSize,
+        };
+        struct Reducer *result = transducer_apply(
+            builder->transducer, builder->step, &block->super);
+        if (block->exhausted) {
+                return NULL;
+        }
+
+        return result;
+}
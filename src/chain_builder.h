@@ -0,0 +1,44 @@
+#pragma once
+
+/**
+ * @file
+ * Reducer chains built each into a block of their own.
+ *
+ * Reducers keep their per-run state inside themselves, so a chain
+ * returned by transducer_apply serves one reduction at a time. A builder
+ * measures the chain once, then builds as many instances of it as wanted,
+ * each one inside a block of builder.chainSize bytes, as an arena does.
+ * Building it again into a block resets the instance for a new run.
+ *
+ * Only what transducer_apply allocates is per instance. What transducers
+ * were made with is shared by all instances: step, the reducers given to
+ * mappingTransducer(), predicate data and the like. Instances run side by
+ * side only as long as those keep no state of their own.
+ */
+
+#include "chain_builder_types.h"
+
+#include <stddef.h>
+
+struct Allocator;
+struct Reducer;
+struct Transducer;
+
+/**
+ * builder of the chains reducing into step through transducer.
+ *
+ * the chain is built once with allocator to measure its size.
+ */
+struct ChainBuilder chainBuilderMake(struct Transducer *transducer,
+                                     struct Reducer const *step,
+                                     struct Allocator *allocator);
+
+/**
+ * builds a reducer chain inside chain, a block of builder->chainSize
+ * bytes aligned like max_align_t.
+ *
+ * @return the first reducer of the chain, NULL if it did not fit in
+ * builder->chainSize bytes
+ */
+struct Reducer *chain_builder_build(struct ChainBuilder const *builder,
+                                    void *chain);
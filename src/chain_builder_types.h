@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stddef.h>
+
+struct Reducer;
+struct Transducer;
+
+/**
+ * What building one reducer chain into a block of its own takes.
+ *
+ * see chainBuilderMake()
+ */
+struct ChainBuilder
+{
+        struct Transducer *transducer;
+        struct Reducer const *step;
+        /// bytes of the block holding one chain
+        size_t chainSize;
+};
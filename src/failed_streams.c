@@ -0,0 +1,45 @@
+#include "failed_streams.h"
+#include "stream_types.h"
+#include "value_stream_types.h"
+
+#include <stdint.h>
+
+static uint8_t const zeros[256] = {0};
+
+static enum StreamErrorCode next_zeros(struct StreamRange *range)
+{
+        range->start = zeros;
+        range->cursor = zeros;
+        range->end = zeros + sizeof(zeros);
+
+        return range->error;
+}
+
+enum StreamErrorCode stream_fail(struct StreamRange *range,
+                                 enum StreamErrorCode error)
+{
+        range->error = error;
+        range->next = next_zeros;
+
+        return range->next(range);
+}
+
+static enum StreamErrorCode zerosVSRNext(struct ValueStreamRange *range)
+{
+        range->type_tag = 0;
+        range->element_size = 1;
+        range->start = zeros;
+        range->cursor = zeros;
+        range->end = zeros + sizeof(zeros);
+
+        return range->error;
+}
+
+enum StreamErrorCode value_stream_fail(struct ValueStreamRange *range,
+                                       enum StreamErrorCode error)
+{
+        range->error = error;
+        range->next = zerosVSRNext;
+
+        return range->next(range);
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+/**
+ * @file
+ * Shared by the stream implementations, to end their streams.
+ *
+ * A failed stream records its error and from then on reads as an endless
+ * run of zeros, so that readers may check the error once done reading.
+ */
+
+#include "stream_types.h"
+
+struct ValueStreamRange;
+
+/// ends range with error, S_NoError for a plain stream of zeros
+enum StreamErrorCode stream_fail(struct StreamRange *range,
+                                 enum StreamErrorCode error);
+
+/// ends range with error, its zeros being bytes of type tag 0
+enum StreamErrorCode value_stream_fail(struct ValueStreamRange *range,
+                                       enum StreamErrorCode error);
@@ -0,0 +1,15 @@
+#pragma once
+
+/**
+ * @file
+ * Plain float functions, for pipelines generated by xfc or composed with
+ * static_transducers.h.
+ */
+
+#include <stdbool.h>
+
+static inline float negateFloat(float const f) { return -f; }
+
+static inline bool isPositiveFloat(float const f) { return f > 0.0f; }
+
+static inline float addFloats(float const a, float const b) { return a + b; }
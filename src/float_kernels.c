@@ -0,0 +1,251 @@
+#include "float_kernels.h"
+
+#include <math.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define FLOAT_KERNELS_AVX2
+#define FLOAT_KERNELS_ISA "avx2"
+#define FLOAT_KERNELS_LANES 8
+typedef __m256 FloatVector;
+#elif defined(__SSE2__) || defined(_M_X64) ||                                  \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FLOAT_KERNELS_SSE2
+#define FLOAT_KERNELS_ISA "sse2"
+#define FLOAT_KERNELS_LANES 4
+typedef __m128 FloatVector;
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define FLOAT_KERNELS_NEON
+#define FLOAT_KERNELS_ISA "neon"
+#define FLOAT_KERNELS_LANES 4
+typedef float32x4_t FloatVector;
+#else
+#define FLOAT_KERNELS_ISA "scalar"
+#endif
+
+#if defined(FLOAT_KERNELS_AVX2)
+
+static inline FloatVector vload(float const *p) { return _mm256_loadu_ps(p); }
+static inline void vstore(float *p, FloatVector v) { _mm256_storeu_ps(p, v); }
+static inline FloatVector vset1(float f) { return _mm256_set1_ps(f); }
+static inline FloatVector vadd(FloatVector a, FloatVector b)
+{
+        return _mm256_add_ps(a, b);
+}
+static inline FloatVector vmul(FloatVector a, FloatVector b)
+{
+        return _mm256_mul_ps(a, b);
+}
+static inline FloatVector vmin(FloatVector a, FloatVector b)
+{
+        return _mm256_min_ps(a, b);
+}
+static inline FloatVector vmax(FloatVector a, FloatVector b)
+{
+        return _mm256_max_ps(a, b);
+}
+/// a where a > b, 0 elsewhere
+static inline FloatVector vabove(FloatVector a, FloatVector b)
+{
+        return _mm256_and_ps(a, _mm256_cmp_ps(a, b, _CMP_GT_OQ));
+}
+
+#elif defined(FLOAT_KERNELS_SSE2)
+
+static inline FloatVector vload(float const *p) { return _mm_loadu_ps(p); }
+static inline void vstore(float *p, FloatVector v) { _mm_storeu_ps(p, v); }
+static inline FloatVector vset1(float f) { return _mm_set1_ps(f); }
+static inline FloatVector vadd(FloatVector a, FloatVector b)
+{
+        return _mm_add_ps(a, b);
+}
+static inline FloatVector vmul(FloatVector a, FloatVector b)
+{
+        return _mm_mul_ps(a, b);
+}
+static inline FloatVector vmin(FloatVector a, FloatVector b)
+{
+        return _mm_min_ps(a, b);
+}
+static inline FloatVector vmax(FloatVector a, FloatVector b)
+{
+        return _mm_max_ps(a, b);
+}
+static inline FloatVector vabove(FloatVector a, FloatVector b)
+{
+        return _mm_and_ps(a, _mm_cmpgt_ps(a, b));
+}
+
+#elif defined(FLOAT_KERNELS_NEON)
+
+static inline FloatVector vload(float const *p) { return vld1q_f32(p); }
+static inline void vstore(float *p, FloatVector v) { vst1q_f32(p, v); }
+static inline FloatVector vset1(float f) { return vdupq_n_f32(f); }
+static inline FloatVector vadd(FloatVector a, FloatVector b)
+{
+        return vaddq_f32(a, b);
+}
+static inline FloatVector vmul(FloatVector a, FloatVector b)
+{
+        return vmulq_f32(a, b);
+}
+static inline FloatVector vmin(FloatVector a, FloatVector b)
+{
+        return vminq_f32(a, b);
+}
+static inline FloatVector vmax(FloatVector a, FloatVector b)
+{
+        return vmaxq_f32(a, b);
+}
+static inline FloatVector vabove(FloatVector a, FloatVector b)
+{
+        return vreinterpretq_f32_u32(
+            vandq_u32(vreinterpretq_u32_f32(a), vcgtq_f32(a, b)));
+}
+
+#endif
+
+#if defined(FLOAT_KERNELS_LANES)
+static float vsumLanes(FloatVector v)
+{
+        float lanes[FLOAT_KERNELS_LANES];
+        vstore(lanes, v);
+
+        float sum = 0.0f;
+        for (size_t i = 0; i < FLOAT_KERNELS_LANES; i++) {
+                sum += lanes[i];
+        }
+
+        return sum;
+}
+
+#endif
+
+char const *floatKernelsISA(void) { return FLOAT_KERNELS_ISA; }
+
+float floatKernelSum(float const *values, size_t const count)
+{
+        size_t i = 0;
+        float sum = 0.0f;
+#if defined(FLOAT_KERNELS_LANES)
+        size_t const lanes = FLOAT_KERNELS_LANES;
+        FloatVector a = vset1(0.0f), b = vset1(0.0f);
+        for (; i + 2 * lanes <= count; i += 2 * lanes) {
+                a = vadd(a, vload(values + i));
+                b = vadd(b, vload(values + i + lanes));
+        }
+        sum = vsumLanes(vadd(a, b));
+#endif
+        for (; i < count; i++) {
+                sum += values[i];
+        }
+
+        return sum;
+}
+
+float floatKernelSumAbove(float const *values, size_t const count,
+                          float const threshold)
+{
+        size_t i = 0;
+        float sum = 0.0f;
+#if defined(FLOAT_KERNELS_LANES)
+        size_t const lanes = FLOAT_KERNELS_LANES;
+        FloatVector const t = vset1(threshold);
+        FloatVector a = vset1(0.0f), b = vset1(0.0f);
+        for (; i + 2 * lanes <= count; i += 2 * lanes) {
+                a = vadd(a, vabove(vload(values + i), t));
+                b = vadd(b, vabove(vload(values + i + lanes), t));
+        }
+        sum = vsumLanes(vadd(a, b));
+#endif
+        for (; i < count; i++) {
+                if (values[i] > threshold) {
+                        sum += values[i];
+                }
+        }
+
+        return sum;
+}
+
+float floatKernelMin(float const *values, size_t const count)
+{
+        size_t i = 0;
+        float min = INFINITY;
+#if defined(FLOAT_KERNELS_LANES)
+        size_t const lanes = FLOAT_KERNELS_LANES;
+        if (count >= lanes) {
+                FloatVector m = vload(values);
+                for (i = lanes; i + lanes <= count; i += lanes) {
+                        m = vmin(m, vload(values + i));
+                }
+
+                float lane[FLOAT_KERNELS_LANES];
+                vstore(lane, m);
+                for (size_t j = 0; j < lanes; j++) {
+                        min = lane[j] < min ? lane[j] : min;
+                }
+        }
+#endif
+        for (; i < count; i++) {
+                min = values[i] < min ? values[i] : min;
+        }
+
+        return min;
+}
+
+float floatKernelMax(float const *values, size_t const count)
+{
+        size_t i = 0;
+        float max = -INFINITY;
+#if defined(FLOAT_KERNELS_LANES)
+        size_t const lanes = FLOAT_KERNELS_LANES;
+        if (count >= lanes) {
+                FloatVector m = vload(values);
+                for (i = lanes; i + lanes <= count; i += lanes) {
+                        m = vmax(m, vload(values + i));
+                }
+
+                float lane[FLOAT_KERNELS_LANES];
+                vstore(lane, m);
+                for (size_t j = 0; j < lanes; j++) {
+                        max = lane[j] > max ? lane[j] : max;
+                }
+        }
+#endif
+        for (; i < count; i++) {
+                max = values[i] > max ? values[i] : max;
+        }
+
+        return max;
+}
+
+void floatKernelScale(float *output, float const *values, size_t const count,
+                      float const factor)
+{
+        size_t i = 0;
+#if defined(FLOAT_KERNELS_LANES)
+        size_t const lanes = FLOAT_KERNELS_LANES;
+        FloatVector const f = vset1(factor);
+        for (; i + lanes <= count; i += lanes) {
+                vstore(output + i, vmul(f, vload(values + i)));
+        }
+#endif
+        for (; i < count; i++) {
+                output[i] = factor * values[i];
+        }
+}
+
+size_t floatKernelSelectAbove(float *output, float const *values,
+                              size_t const count, float const threshold)
+{
+        /* branch-free: always store, only advance on a match */
+        size_t selected = 0;
+        for (size_t i = 0; i < count; i++) {
+                output[selected] = values[i];
+                selected += values[i] > threshold;
+        }
+
+        return selected;
+}
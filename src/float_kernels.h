@@ -0,0 +1,36 @@
+#pragma once
+
+/**
+ * @file
+ * Vectorized loops over arrays of floats.
+ *
+ * The instruction set is chosen at compile time: AVX2, SSE2 or NEON when
+ * available, plain C otherwise. Sums are computed in several lanes and may
+ * round differently than a sequential loop.
+ */
+
+#include <stddef.h>
+
+/// name of the instruction set the kernels were compiled for
+char const *floatKernelsISA(void);
+
+float floatKernelSum(float const *values, size_t count);
+
+/// sum of the values greater than threshold
+float floatKernelSumAbove(float const *values, size_t count, float threshold);
+
+/// minimum of values, or +INFINITY when count is 0
+float floatKernelMin(float const *values, size_t count);
+
+/// maximum of values, or -INFINITY when count is 0
+float floatKernelMax(float const *values, size_t count);
+
+/// output[i] = factor * values[i]
+void floatKernelScale(float *output, float const *values, size_t count,
+                      float factor);
+
+/// copies to output the values greater than threshold
+///
+/// @return number of values copied
+size_t floatKernelSelectAbove(float *output, float const *values,
+                              size_t count, float threshold);
@@ -0,0 +1,375 @@
+#include "float_transducers.h"
+#include "transducer_types.h"
+#include "transducers.h"
+
+#include "alignment.h"
+#include "allocator.h"
+#include "float_kernels.h"
+
+#include <math.h>
+
+enum { FLOAT_CHUNK_COUNT = 1024 };
+
+static float floatOf(struct Value const *value)
+{
+        return *(float const *)valuePayload(value);
+}
+
+static bool isFloatSpan(struct ValueSpan const *span)
+{
+        return span->type_tag == TTAG_FLOAT &&
+               span->element_size == sizeof(float) &&
+               (uintptr_t)span->start % _Alignof(float) == 0;
+}
+
+static float const *floatsOf(struct ValueSpan const *span)
+{
+        return (float const *)span->start;
+}
+
+static struct ValueSpan floatSpan(float const *values, size_t const count)
+{
+        return (struct ValueSpan){
+            .type_tag = TTAG_FLOAT,
+            .element_size = sizeof *values,
+            .start = (uint8_t const *)values,
+            .end = (uint8_t const *)(values + count),
+        };
+}
+
+/// per-element path, for spans that are not made of floats
+static struct Value applyEach(struct Reducer const *reducer,
+                              struct ValueSpan const span,
+                              struct Value current,
+                              struct Allocator *allocator)
+{
+        for (uint8_t const *element = span.start;
+             element < span.end && !isReduced(&current);
+             element += span.element_size) {
+                current = reducer->apply(reducer,
+                                         valueSpanElement(&span, element),
+                                         current, allocator);
+        }
+
+        return current;
+}
+
+static struct Reducer *newReducer(struct Reducer const reducer,
+                                  struct Allocator *allocator)
+{
+        struct Reducer *result = allocator_alloc(allocator, sizeof *result);
+        *result = reducer;
+        return result;
+}
+
+/* sum */
+
+static struct Value floatSumIdentity(struct Reducer const *reducer,
+                                     struct Allocator *allocator)
+{
+        return floatImmediate(0.0f);
+}
+
+static struct Value floatSumApply(struct Reducer const *reducer,
+                                  struct Value input, struct Value current,
+                                  struct Allocator *allocator)
+{
+        return floatImmediate(floatOf(&current) + floatOf(&input));
+}
+
+static struct Value floatSumApplyBatch(struct Reducer const *reducer,
+                                       struct ValueSpan span,
+                                       struct Value current,
+                                       struct Allocator *allocator)
+{
+        if (!isFloatSpan(&span)) {
+                return applyEach(reducer, span, current, allocator);
+        }
+
+        return floatImmediate(
+            floatOf(&current) +
+            floatKernelSum(floatsOf(&span), valueSpanCount(&span)));
+}
+
+struct Reducer *floatSumReducer(struct Allocator *allocator)
+{
+        return newReducer(
+            (struct Reducer){
+                .identity = floatSumIdentity,
+                .apply = floatSumApply,
+                .apply_batch = floatSumApplyBatch,
+                .combine = floatSumApply,
+                .properties = RP_ADDITIVE,
+            },
+            allocator);
+}
+
+/* min */
+
+static struct Value floatMinIdentity(struct Reducer const *reducer,
+                                     struct Allocator *allocator)
+{
+        return floatImmediate(INFINITY);
+}
+
+static struct Value floatMinApply(struct Reducer const *reducer,
+                                  struct Value input, struct Value current,
+                                  struct Allocator *allocator)
+{
+        float const a = floatOf(&input), b = floatOf(&current);
+        return floatImmediate(a < b ? a : b);
+}
+
+static struct Value floatMinApplyBatch(struct Reducer const *reducer,
+                                       struct ValueSpan span,
+                                       struct Value current,
+                                       struct Allocator *allocator)
+{
+        if (!isFloatSpan(&span)) {
+                return applyEach(reducer, span, current, allocator);
+        }
+
+        float const a = floatKernelMin(floatsOf(&span), valueSpanCount(&span));
+        float const b = floatOf(&current);
+        return floatImmediate(a < b ? a : b);
+}
+
+struct Reducer *floatMinReducer(struct Allocator *allocator)
+{
+        return newReducer(
+            (struct Reducer){
+                .identity = floatMinIdentity,
+                .apply = floatMinApply,
+                .apply_batch = floatMinApplyBatch,
+                .combine = floatMinApply,
+            },
+            allocator);
+}
+
+/* max */
+
+static struct Value floatMaxIdentity(struct Reducer const *reducer,
+                                     struct Allocator *allocator)
+{
+        return floatImmediate(-INFINITY);
+}
+
+static struct Value floatMaxApply(struct Reducer const *reducer,
+                                  struct Value input, struct Value current,
+                                  struct Allocator *allocator)
+{
+        float const a = floatOf(&input), b = floatOf(&current);
+        return floatImmediate(a > b ? a : b);
+}
+
+static struct Value floatMaxApplyBatch(struct Reducer const *reducer,
+                                       struct ValueSpan span,
+                                       struct Value current,
+                                       struct Allocator *allocator)
+{
+        if (!isFloatSpan(&span)) {
+                return applyEach(reducer, span, current, allocator);
+        }
+
+        float const a = floatKernelMax(floatsOf(&span), valueSpanCount(&span));
+        float const b = floatOf(&current);
+        return floatImmediate(a > b ? a : b);
+}
+
+struct Reducer *floatMaxReducer(struct Allocator *allocator)
+{
+        return newReducer(
+            (struct Reducer){
+                .identity = floatMaxIdentity,
+                .apply = floatMaxApply,
+                .apply_batch = floatMaxApplyBatch,
+                .combine = floatMaxApply,
+            },
+            allocator);
+}
+
+/* scaling */
+
+struct FloatParameterTransducer
+{
+        struct Transducer super;
+        float parameter;
+};
+
+struct FloatParameterReducer
+{
+        struct ChainedReducer super;
+        float parameter;
+};
+
+static size_t floatParameterTransducerSize(struct Transducer const *transducer)
+{
+        return alignUp(sizeof(struct FloatParameterReducer));
+}
+
+static struct Transducer *newFloatParameterTransducer(
+    struct Reducer *(*apply)(struct Transducer *, struct Reducer const *,
+                             struct Allocator *),
+    float const parameter, struct Allocator *allocator)
+{
+        struct FloatParameterTransducer *result =
+            allocator_alloc(allocator, sizeof *result);
+
+        *result = (struct FloatParameterTransducer){
+            .super = (struct Transducer){apply, floatParameterTransducerSize},
+            .parameter = parameter,
+        };
+
+        return &result->super;
+}
+
+static struct Reducer *newFloatParameterReducer(
+    struct Transducer *transducer, struct Reducer const *step,
+    struct Value (*reducingFn)(struct Reducer const *, struct Value,
+                               struct Value, struct Allocator *),
+    struct Value (*batchFn)(struct Reducer const *, struct ValueSpan,
+                            struct Value, struct Allocator *),
+    struct Allocator *allocator)
+{
+        struct FloatParameterTransducer *self =
+            (struct FloatParameterTransducer *)transducer;
+        struct FloatParameterReducer *result =
+            allocator_alloc(allocator, sizeof *result);
+
+        result->super = chainedReducerMake(step, reducingFn);
+        result->super.super.apply_batch = batchFn;
+        result->parameter = self->parameter;
+
+        return &result->super.super;
+}
+
+static struct Value floatScalingApply(struct Reducer const *reducer,
+                                      struct Value input, struct Value current,
+                                      struct Allocator *allocator)
+{
+        struct FloatParameterReducer *self =
+            (struct FloatParameterReducer *)reducer;
+
+        return reducer_apply(self->super.step,
+                             floatImmediate(self->parameter * floatOf(&input)),
+                             current, allocator);
+}
+
+static struct Value floatScalingApplyBatch(struct Reducer const *reducer,
+                                           struct ValueSpan span,
+                                           struct Value current,
+                                           struct Allocator *allocator)
+{
+        struct FloatParameterReducer *self =
+            (struct FloatParameterReducer *)reducer;
+
+        if (!isFloatSpan(&span)) {
+                return applyEach(reducer, span, current, allocator);
+        }
+
+        float scaled[FLOAT_CHUNK_COUNT];
+        float const *values = floatsOf(&span);
+        size_t count = valueSpanCount(&span);
+        while (count > 0 && !isReduced(&current)) {
+                size_t const n =
+                    count < FLOAT_CHUNK_COUNT ? count : FLOAT_CHUNK_COUNT;
+                floatKernelScale(scaled, values, n, self->parameter);
+                current = reducer_apply_batch(
+                    self->super.step, floatSpan(scaled, n), current, allocator);
+                values += n;
+                count -= n;
+        }
+
+        return current;
+}
+
+static struct Reducer *floatScalingTransducerApply(struct Transducer *transducer,
+                                                   struct Reducer const *step,
+                                                   struct Allocator *allocator)
+{
+        return newFloatParameterReducer(transducer, step, floatScalingApply,
+                                        floatScalingApplyBatch, allocator);
+}
+
+struct Transducer *floatScalingTransducer(float const factor,
+                                          struct Allocator *allocator)
+{
+        return newFloatParameterTransducer(floatScalingTransducerApply,
+                                           factor, allocator);
+}
+
+/* threshold */
+
+static struct Value floatThresholdApply(struct Reducer const *reducer,
+                                        struct Value input,
+                                        struct Value current,
+                                        struct Allocator *allocator)
+{
+        struct FloatParameterReducer *self =
+            (struct FloatParameterReducer *)reducer;
+
+        if (input.type_tag != TTAG_FLOAT ||
+            !(floatOf(&input) > self->parameter)) {
+                return current;
+        }
+
+        return reducer_apply(self->super.step, input, current, allocator);
+}
+
+static struct Value floatThresholdApplyBatch(struct Reducer const *reducer,
+                                             struct ValueSpan span,
+                                             struct Value current,
+                                             struct Allocator *allocator)
+{
+        struct FloatParameterReducer *self =
+            (struct FloatParameterReducer *)reducer;
+
+        if (!isFloatSpan(&span)) {
+                return applyEach(reducer, span, current, allocator);
+        }
+
+        float const *values = floatsOf(&span);
+        size_t count = valueSpanCount(&span);
+
+        /* summing what passes needs no intermediate buffer */
+        if (self->super.step->properties & RP_ADDITIVE) {
+                return reducer_apply(
+                    self->super.step,
+                    floatImmediate(
+                        floatKernelSumAbove(values, count, self->parameter)),
+                    current, allocator);
+        }
+
+        float selected[FLOAT_CHUNK_COUNT];
+        while (count > 0 && !isReduced(&current)) {
+                size_t const n =
+                    count < FLOAT_CHUNK_COUNT ? count : FLOAT_CHUNK_COUNT;
+                size_t const selectedCount = floatKernelSelectAbove(
+                    selected, values, n, self->parameter);
+                if (selectedCount > 0) {
+                        current = reducer_apply_batch(
+                            self->super.step, floatSpan(selected, selectedCount),
+                            current, allocator);
+                }
+                values += n;
+                count -= n;
+        }
+
+        return current;
+}
+
+static struct Reducer *
+floatThresholdTransducerApply(struct Transducer *transducer,
+                              struct Reducer const *step,
+                              struct Allocator *allocator)
+{
+        return newFloatParameterReducer(transducer, step, floatThresholdApply,
+                                        floatThresholdApplyBatch, allocator);
+}
+
+struct Transducer *floatThresholdTransducer(float const threshold,
+                                            struct Allocator *allocator)
+{
+        return newFloatParameterTransducer(floatThresholdTransducerApply,
+                                           threshold, allocator);
+}
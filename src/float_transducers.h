@@ -0,0 +1,30 @@
+#pragma once
+
+/**
+ * @file
+ * Built-in stages for streams of TTAG_FLOAT values.
+ *
+ * In batch mode (reducer_apply_batch) these stages process whole spans
+ * of floats with the kernels of float_kernels.h.
+ */
+
+struct Allocator;
+struct Reducer;
+struct Transducer;
+
+/// sum of the inputs, starting from 0
+struct Reducer *floatSumReducer(struct Allocator *allocator);
+
+/// minimum of the inputs, starting from +INFINITY
+struct Reducer *floatMinReducer(struct Allocator *allocator);
+
+/// maximum of the inputs, starting from -INFINITY
+struct Reducer *floatMaxReducer(struct Allocator *allocator);
+
+/// multiplies inputs by factor, use -1 to negate them
+struct Transducer *floatScalingTransducer(float factor,
+                                          struct Allocator *allocator);
+
+/// only keeps inputs greater than threshold
+struct Transducer *floatThresholdTransducer(float threshold,
+                                            struct Allocator *allocator);
@@ -0,0 +1,481 @@
+#include "grouping.h"
+#include "grouping_types.h"
+#include "transducer_types.h"
+#include "transducers.h"
+#include "type_registry.h"
+
+#include "alignment.h"
+#include "allocator.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+enum {
+        GROUP_TABLE_INITIAL_CAPACITY = 16,
+};
+
+/* the table */
+
+static size_t groupSlot(struct GroupTable const *table, uint64_t const key)
+{
+        /* fibonacci hashing, keys are often small consecutive integers */
+        uint64_t const hash = key * UINT64_C(0x9E3779B97F4A7C15);
+        return (size_t)(hash >> 32) & (table->capacity - 1);
+}
+
+/// entry of key, or the free entry where it belongs
+static struct KeyedValue *groupProbe(struct GroupTable const *table,
+                                     uint64_t const key)
+{
+        size_t slot = groupSlot(table, key);
+        while (table->occupied[slot] && table->entries[slot].key != key) {
+                slot = (slot + 1) & (table->capacity - 1);
+        }
+
+        return &table->entries[slot];
+}
+
+static size_t groupPosition(struct GroupTable const *table,
+                            struct KeyedValue const *entry)
+{
+        return (size_t)(entry - table->entries);
+}
+
+static void groupTableFree(struct GroupTable *table)
+{
+        /* occupied shares the allocation of entries */
+        if (table->entries) {
+                allocator_free(table->allocator, table->entries);
+        }
+        table->entries = NULL;
+        table->occupied = NULL;
+        table->capacity = 0;
+        table->count = 0;
+}
+
+static void groupTableRelease(struct GroupTable *table)
+{
+        for (size_t i = 0; i < table->capacity; i++) {
+                if (table->occupied[i]) {
+                        value_release(&table->entries[i].value);
+                }
+        }
+        groupTableFree(table);
+}
+
+static bool groupTableGrow(struct GroupTable *table)
+{
+        size_t const capacity = table->capacity
+                                    ? 2 * table->capacity
+                                    : GROUP_TABLE_INITIAL_CAPACITY;
+        struct KeyedValue *entries = allocator_alloc(
+            table->allocator, capacity * (sizeof *entries + 1));
+        if (!entries) {
+                return false;
+        }
+
+        struct GroupTable grown = {
+            .entries = entries,
+            .occupied = (uint8_t *)(entries + capacity),
+            .capacity = capacity,
+            .count = table->count,
+            .allocator = table->allocator,
+        };
+        memset(grown.occupied, 0, capacity);
+        for (size_t i = 0; i < table->capacity; i++) {
+                if (table->occupied[i]) {
+                        struct KeyedValue *entry =
+                            groupProbe(&grown, table->entries[i].key);
+                        *entry = table->entries[i];
+                        grown.occupied[groupPosition(&grown, entry)] = 1;
+                }
+        }
+
+        groupTableFree(table);
+        *table = grown;
+
+        return true;
+}
+
+/// entry of key, added when key is new, which inserted tells
+///
+/// @return NULL when the table cannot grow
+static struct KeyedValue *groupInsert(struct GroupTable *table,
+                                      uint64_t const key, bool *inserted)
+{
+        *inserted = false;
+        if (table->capacity > 0) {
+                struct KeyedValue *entry = groupProbe(table, key);
+                if (table->occupied[groupPosition(table, entry)]) {
+                        return entry;
+                }
+        }
+
+        /* at most 3/4 full */
+        if (4 * (table->count + 1) > 3 * table->capacity &&
+            !groupTableGrow(table)) {
+                return NULL;
+        }
+
+        struct KeyedValue *entry = groupProbe(table, key);
+        table->occupied[groupPosition(table, entry)] = 1;
+        table->count++;
+        entry->key = key;
+        *inserted = true;
+
+        return entry;
+}
+
+static struct KeyedValue *groupNext(struct GroupTable const *table,
+                                    struct KeyedValue const *entry)
+{
+        size_t i = entry ? groupPosition(table, entry) + 1 : 0;
+        for (; i < table->capacity; i++) {
+                if (table->occupied[i]) {
+                        return &table->entries[i];
+                }
+        }
+
+        return NULL;
+}
+
+struct GroupingParams
+{
+        uint64_t (*keyOf)(struct Value value, void *data);
+        void *keyData;
+        struct Reducer const *reducer;
+};
+
+/// reduces input into the result of its key
+///
+/// @return false when out of memory
+static bool groupValue(struct GroupingParams const *params,
+                       struct GroupTable *table, struct Value const input,
+                       struct Allocator *allocator)
+{
+        bool inserted;
+        struct KeyedValue *entry =
+            groupInsert(table, params->keyOf(input, params->keyData),
+                        &inserted);
+        if (!entry) {
+                return false;
+        }
+        if (inserted) {
+                entry->value = reducer_identity(params->reducer, allocator);
+        }
+
+        /* a reduced result takes no more values of its key */
+        if (!isReduced(&entry->value)) {
+                entry->value = reducer_apply(params->reducer, input,
+                                             entry->value, allocator);
+        }
+
+        return true;
+}
+
+/* the transducer */
+
+struct GroupingTransducer
+{
+        struct Transducer super;
+        struct GroupingParams params;
+};
+
+struct GroupingReducer
+{
+        struct ChainedReducer super;
+        struct GroupingParams const *params;
+        struct GroupTable table;
+};
+
+static struct Value groupingReducerApply(struct Reducer const *reducer,
+                                         struct Value input,
+                                         struct Value current,
+                                         struct Allocator *allocator)
+{
+        struct GroupingReducer *self = (struct GroupingReducer *)reducer;
+
+        if (!self->table.allocator) {
+                self->table.allocator = allocator;
+        }
+        if (!groupValue(self->params, &self->table, input, allocator)) {
+                return reduced(current);
+        }
+
+        return current;
+}
+
+static struct Value groupingReducerComplete(struct Reducer const *reducer,
+                                            struct Value result,
+                                            struct Allocator *allocator)
+{
+        struct GroupingReducer *self = (struct GroupingReducer *)reducer;
+
+        for (struct KeyedValue *entry = groupNext(&self->table, NULL);
+             entry && !isReduced(&result);
+             entry = groupNext(&self->table, entry)) {
+                entry->value = reducer_complete(
+                    self->params->reducer, unreduced(entry->value), allocator);
+                result = reducer_apply(self->super.step, keyedValue(entry),
+                                       result, allocator);
+        }
+        result =
+            reducer_complete(self->super.step, unreduced(result), allocator);
+
+        /* the next run starts afresh */
+        groupTableRelease(&self->table);
+        self->table.allocator = NULL;
+
+        return result;
+}
+
+static size_t groupingTransducerSize(struct Transducer const *transducer)
+{
+        return alignUp(sizeof(struct GroupingReducer));
+}
+
+static struct Reducer *groupingTransducerApply(struct Transducer *transducer,
+                                               struct Reducer const *step,
+                                               struct Allocator *allocator)
+{
+        struct GroupingTransducer *self =
+            (struct GroupingTransducer *)transducer;
+        struct GroupingReducer *result =
+            allocator_alloc(allocator, sizeof *result);
+
+        *result = (struct GroupingReducer){
+            .super = chainedReducerMake(step, groupingReducerApply),
+            .params = &self->params,
+        };
+        result->super.super.complete = groupingReducerComplete;
+        /* keys may span the parts of a split input */
+        result->super.super.combine = NULL;
+
+        return &result->super.super;
+}
+
+struct Transducer *
+groupingTransducer(uint64_t (*keyOf)(struct Value value, void *data),
+                   void *keyData, struct Reducer const *reducer,
+                   struct Allocator *allocator)
+{
+        struct GroupingTransducer *result =
+            allocator_alloc(allocator, sizeof *result);
+
+        *result = (struct GroupingTransducer){
+            .super = {groupingTransducerApply, groupingTransducerSize},
+            .params = {.keyOf = keyOf, .keyData = keyData, .reducer = reducer},
+        };
+
+        return &result->super;
+}
+
+/* the reducer, its result holding the table */
+
+struct GroupsReducer
+{
+        struct Reducer super;
+        struct GroupingParams params;
+};
+
+static struct GroupTable *groupsTable(struct Value const *groups)
+{
+        return (struct GroupTable *)groups->address;
+}
+
+static struct Value groupsReducerIdentity(struct Reducer const *reducer,
+                                          struct Allocator *allocator)
+{
+        struct GroupTable *table = allocator_alloc(allocator, sizeof *table);
+        *table = (struct GroupTable){.allocator = allocator};
+
+        return (struct Value){
+            .type_tag = TTAG_GROUPS,
+            .element_size = sizeof *table,
+            .address = table,
+            .allocator = allocator,
+        };
+}
+
+static struct Value groupsReducerApply(struct Reducer const *reducer,
+                                       struct Value input,
+                                       struct Value current,
+                                       struct Allocator *allocator)
+{
+        struct GroupsReducer const *self =
+            (struct GroupsReducer const *)reducer;
+
+        if (!groupValue(&self->params, groupsTable(&current), input,
+                        allocator)) {
+                return reduced(current);
+        }
+
+        return current;
+}
+
+static struct Value groupsReducerComplete(struct Reducer const *reducer,
+                                          struct Value result,
+                                          struct Allocator *allocator)
+{
+        struct GroupsReducer const *self =
+            (struct GroupsReducer const *)reducer;
+        struct GroupTable *table = groupsTable(&result);
+
+        for (struct KeyedValue *entry = groupNext(table, NULL); entry;
+             entry = groupNext(table, entry)) {
+                entry->value = reducer_complete(
+                    self->params.reducer, unreduced(entry->value), allocator);
+        }
+
+        return result;
+}
+
+/* the keys of right follow those of left, so a reduced left result takes
+ * nothing from right */
+static struct Value groupsReducerCombine(struct Reducer const *reducer,
+                                         struct Value left, struct Value right,
+                                         struct Allocator *allocator)
+{
+        struct GroupsReducer const *self =
+            (struct GroupsReducer const *)reducer;
+        struct GroupTable *table = groupsTable(&left);
+        struct GroupTable const *other = groupsTable(&right);
+
+        bool merged = true;
+        for (struct KeyedValue *entry = groupNext(other, NULL); entry;
+             entry = groupNext(other, entry)) {
+                bool inserted;
+                struct KeyedValue *into =
+                    merged ? groupInsert(table, entry->key, &inserted) : NULL;
+                if (!into) {
+                        /* left cannot grow, the rest of right is dropped */
+                        merged = false;
+                        value_release(&entry->value);
+                } else if (inserted) {
+                        into->value = entry->value;
+                } else if (!isReduced(&into->value)) {
+                        struct Value const combined = reducer_combine(
+                            self->params.reducer, into->value,
+                            unreduced(entry->value), allocator);
+                        into->value = isReduced(&entry->value)
+                                          ? reduced(combined)
+                                          : combined;
+                } else {
+                        value_release(&entry->value);
+                }
+        }
+        /* the results of right now belong to left */
+        groupTableFree(groupsTable(&right));
+        freeValue(&right);
+
+        return merged ? left : reduced(left);
+}
+
+struct Reducer *groupingReducer(uint64_t (*keyOf)(struct Value value,
+                                                  void *data),
+                                void *keyData, struct Reducer const *reducer,
+                                struct Allocator *allocator)
+{
+        struct GroupsReducer *result =
+            allocator_alloc(allocator, sizeof *result);
+
+        *result = (struct GroupsReducer){
+            .super =
+                {
+                    .identity = groupsReducerIdentity,
+                    .apply = groupsReducerApply,
+                    .complete = groupsReducerComplete,
+                    .combine = reducer->combine ? groupsReducerCombine : NULL,
+                },
+            .params = {.keyOf = keyOf, .keyData = keyData, .reducer = reducer},
+        };
+
+        return &result->super;
+}
+
+size_t groups_count(struct Value const *groups)
+{
+        return groupsTable(groups)->count;
+}
+
+struct KeyedValue const *groups_find(struct Value const *groups,
+                                     uint64_t const key)
+{
+        struct GroupTable const *table = groupsTable(groups);
+        if (table->capacity == 0) {
+                return NULL;
+        }
+
+        struct KeyedValue const *entry = groupProbe(table, key);
+        return table->occupied[groupPosition(table, entry)] ? entry : NULL;
+}
+
+struct KeyedValue const *groups_next(struct Value const *groups,
+                                     struct KeyedValue const *entry)
+{
+        return groupNext(groupsTable(groups), entry);
+}
+
+void groups_release(struct Value *groups)
+{
+        groupTableRelease(groupsTable(groups));
+        freeValue(groups);
+}
+
+/* the type */
+
+static struct Value groupsCopy(struct Value const *groups,
+                               struct Allocator *allocator)
+{
+        struct GroupTable const *table = groupsTable(groups);
+        struct Value result = groupsReducerIdentity(NULL, allocator);
+        struct GroupTable *copy = groupsTable(&result);
+        if (table->capacity == 0) {
+                return result;
+        }
+
+        struct KeyedValue *entries = allocator_alloc(
+            allocator, table->capacity * (sizeof *entries + 1));
+        *copy = (struct GroupTable){
+            .entries = entries,
+            .occupied = (uint8_t *)(entries + table->capacity),
+            .capacity = table->capacity,
+            .count = table->count,
+            .allocator = allocator,
+        };
+        memcpy(copy->occupied, table->occupied, table->capacity);
+        for (size_t i = 0; i < table->capacity; i++) {
+                if (table->occupied[i]) {
+                        entries[i] = (struct KeyedValue){
+                            .key = table->entries[i].key,
+                            .value = value_copy(&table->entries[i].value,
+                                                allocator),
+                        };
+                }
+        }
+
+        return result;
+}
+
+static size_t groupsFormat(struct Value const *groups, char *buffer,
+                           size_t size)
+{
+        return (size_t)snprintf(buffer, size, "groups of %zu",
+                                groups_count(groups));
+}
+
+static struct TypeDescriptor const groupsType = {
+    .type_tag = TTAG_GROUPS,
+    .name = "groups",
+    .size = sizeof(struct GroupTable),
+    .alignment = _Alignof(struct GroupTable),
+    .copy = groupsCopy,
+    .release = groups_release,
+    .format = groupsFormat,
+};
+
+bool grouping_register_types(void)
+{
+        return type_register(&groupsType);
+}
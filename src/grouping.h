@@ -0,0 +1,79 @@
+#pragma once
+
+/**
+ * @file
+ * Aggregations by key.
+ *
+ * The values of each key, as given by a key function, are reduced by one
+ * inner reducer, such as a sum, count, min or max. The inner reducer
+ * serves all keys, so as a plan's step it must not keep per-run state.
+ *
+ * Results are kept by key in a flat open-addressing table, from the
+ * allocator of the reduction, which grows as new keys come in.
+ */
+
+#include "grouping_types.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// address is a struct GroupTable, see groupingReducer()
+#define TTAG_GROUPS (0xaf6bcb6d)
+
+struct Allocator;
+struct Reducer;
+struct Transducer;
+
+/**
+ * reduces the values of each key with reducer, then on completion sends
+ * each key and its result down as a TTAG_KEYED value, in no particular
+ * order.
+ *
+ * the table is released once the chain completed, so like spans the keyed
+ * values are valid for the duration of the call they are passed to.
+ */
+struct Transducer *
+groupingTransducer(uint64_t (*keyOf)(struct Value value, void *data),
+                   void *keyData, struct Reducer const *reducer,
+                   struct Allocator *allocator);
+
+/**
+ * reduces values into a TTAG_GROUPS value, the table of the results of
+ * each key, completed with reducer on completion.
+ *
+ * when reducer has a combine function, tables are combined by merging the
+ * results of their common keys with it, so that transduce_parallel()
+ * merges the tables of its workers. release the result with
+ * groups_release(), or value_release() once grouping_register_types() was
+ * called.
+ */
+struct Reducer *groupingReducer(uint64_t (*keyOf)(struct Value value,
+                                                  void *data),
+                                void *keyData, struct Reducer const *reducer,
+                                struct Allocator *allocator);
+
+size_t groups_count(struct Value const *groups);
+
+/// @return NULL when key has no values
+struct KeyedValue const *groups_find(struct Value const *groups,
+                                     uint64_t key);
+
+/**
+ * iterates over the keys of groups, in no particular order.
+ *
+ * @return the key after entry, or the first one when entry is NULL. NULL
+ * past the last key.
+ */
+struct KeyedValue const *groups_next(struct Value const *groups,
+                                     struct KeyedValue const *entry);
+
+/// releases the results of groups and gives back its table
+void groups_release(struct Value *groups);
+
+/**
+ * registers the TTAG_GROUPS type, copied and released with its results.
+ *
+ * @return false when the registry could not take it
+ */
+bool grouping_register_types(void);
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "values.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct Allocator;
+
+/**
+ * Results by key, in an open-addressing table with linear probing.
+ *
+ * see groupingReducer()
+ */
+struct GroupTable
+{
+        /// capacity entries, the free ones having a 0 occupied byte
+        struct KeyedValue *entries;
+        uint8_t *occupied;
+        /// a power of two, or 0 before the first key
+        size_t capacity;
+        size_t count;
+        struct Allocator *allocator;
+};
@@ -0,0 +1,568 @@
+#include "job_pool.h"
+#include "chain_builder.h"
+#include "transducer_types.h"
+#include "transducers.h"
+
+#include "alignment.h"
+#include "allocator.h"
+#include "arena_allocator.h"
+#include "type_registry.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+enum {
+        /// bytes of the blocks workers keep for the arenas of parts
+        WORKER_BLOCK_SIZE = 16 * 1024,
+        /// blocks a worker keeps, those freed past it go back to the pool
+        WORKER_BLOCKS_COUNT = 64,
+        DEQUE_INITIAL_CAPACITY = 16,
+};
+
+/* blocks kept by a worker, preceded by their size */
+union WorkerBlockHeader
+{
+        size_t size;
+        max_align_t align;
+};
+
+struct WorkerBlock
+{
+        struct WorkerBlock *next;
+};
+
+/// parent of the arena of a part, taking blocks from the worker running
+/// it, or completing its job
+struct PartBlocks
+{
+        struct Allocator super;
+        struct JobPool *pool;
+        struct JobWorker *worker;
+};
+
+/// consecutive elements of a job, reduced by a chain instance of their own
+struct JobPart
+{
+        struct JobFuture *job;
+        struct Reducer *reducer;
+        uint8_t const *next;
+        uint8_t const *end;
+        struct Value result;
+        struct PartBlocks blocks;
+        /// what reducing the part allocates, kept until the job completes
+        struct ArenaAllocator arena;
+};
+
+struct JobFuture
+{
+        struct JobPool *pool;
+        uint32_t type_tag;
+        size_t element_size;
+        size_t partsCount;
+        atomic_size_t partsLeft;
+        atomic_bool done;
+        struct Value result;
+        struct JobPart parts[];
+};
+
+/// deque of parts, popped at the bottom by its worker and stolen from the
+/// top by the others
+struct JobWorker
+{
+        struct JobPool *pool;
+        pthread_t thread;
+
+        pthread_mutex_t mutex;
+        /// room for all the live parts of the pool, see reserveDeques()
+        struct JobPart **tasks;
+        size_t capacity;
+        size_t top;
+        size_t count;
+
+        /// only used by the thread of the worker
+        struct WorkerBlock *blocks;
+        size_t blocksCount;
+};
+
+struct JobPool
+{
+        struct Allocator *allocator;
+        size_t chunkSize;
+        size_t workersCount;
+        atomic_size_t nextWorker;
+        /// parts queued in all deques
+        atomic_size_t queued;
+        /// parts of the jobs not completed yet
+        atomic_size_t liveParts;
+        atomic_size_t sleeping;
+
+        pthread_mutex_t mutex;
+        pthread_cond_t workAvailable;
+        pthread_cond_t completed;
+        bool stopping;
+
+        struct JobWorker workers[];
+};
+
+/* blocks of the workers */
+
+static void *partBlocksAlloc(struct Allocator *allocator, size_t size)
+{
+        struct PartBlocks *self = (struct PartBlocks *)allocator;
+        struct JobWorker *worker = self->worker;
+
+        union WorkerBlockHeader *header;
+        if (size <= WORKER_BLOCK_SIZE && worker->blocks) {
+                struct WorkerBlock *block = worker->blocks;
+                worker->blocks = block->next;
+                worker->blocksCount--;
+                header = (union WorkerBlockHeader *)block - 1;
+                return header + 1;
+        }
+
+        /* until the cache of the worker warmed up, or for large blocks */
+        size_t const capacity =
+            size <= WORKER_BLOCK_SIZE ? WORKER_BLOCK_SIZE : size;
+        header = allocator_alloc(self->pool->allocator,
+                                 sizeof *header + capacity);
+        if (!header) {
+                return NULL;
+        }
+        header->size = capacity;
+
+        return header + 1;
+}
+
+static void partBlocksFree(struct Allocator *allocator, void *ptr)
+{
+        struct PartBlocks *self = (struct PartBlocks *)allocator;
+        struct JobWorker *worker = self->worker;
+        if (!ptr) {
+                return;
+        }
+
+        union WorkerBlockHeader *header = (union WorkerBlockHeader *)ptr - 1;
+        if (header->size != WORKER_BLOCK_SIZE ||
+            worker->blocksCount == WORKER_BLOCKS_COUNT) {
+                allocator_free(self->pool->allocator, header);
+                return;
+        }
+
+        struct WorkerBlock *block = ptr;
+        block->next = worker->blocks;
+        worker->blocks = block;
+        worker->blocksCount++;
+}
+
+/* deques */
+
+/// grows all deques to hold count more parts, so that workers never have
+/// to grow them
+static bool reserveDeques(struct JobPool *pool, size_t const count)
+{
+        size_t const live = atomic_fetch_add(&pool->liveParts, count) + count;
+
+        for (size_t i = 0; i < pool->workersCount; i++) {
+                struct JobWorker *worker = &pool->workers[i];
+                pthread_mutex_lock(&worker->mutex);
+                if (worker->capacity < live) {
+                        size_t capacity = worker->capacity
+                                              ? worker->capacity
+                                              : DEQUE_INITIAL_CAPACITY;
+                        while (capacity < live) {
+                                capacity *= 2;
+                        }
+                        struct JobPart **tasks = allocator_alloc(
+                            pool->allocator, capacity * sizeof *tasks);
+                        if (!tasks) {
+                                pthread_mutex_unlock(&worker->mutex);
+                                atomic_fetch_sub(&pool->liveParts, count);
+                                return false;
+                        }
+                        for (size_t j = 0; j < worker->count; j++) {
+                                tasks[j] = worker->tasks[(worker->top + j) %
+                                                         worker->capacity];
+                        }
+                        allocator_free(pool->allocator, worker->tasks);
+                        worker->tasks = tasks;
+                        worker->capacity = capacity;
+                        worker->top = 0;
+                }
+                pthread_mutex_unlock(&worker->mutex);
+        }
+
+        return true;
+}
+
+static void pushBottom(struct JobWorker *worker, struct JobPart *part)
+{
+        pthread_mutex_lock(&worker->mutex);
+        assert(worker->count < worker->capacity);
+        worker->tasks[(worker->top + worker->count) % worker->capacity] =
+            part;
+        worker->count++;
+        pthread_mutex_unlock(&worker->mutex);
+}
+
+static struct JobPart *popBottom(struct JobWorker *worker)
+{
+        struct JobPart *part = NULL;
+
+        pthread_mutex_lock(&worker->mutex);
+        if (worker->count > 0) {
+                worker->count--;
+                part = worker->tasks[(worker->top + worker->count) %
+                                     worker->capacity];
+        }
+        pthread_mutex_unlock(&worker->mutex);
+
+        return part;
+}
+
+static struct JobPart *stealTop(struct JobWorker *worker)
+{
+        struct JobPart *part = NULL;
+
+        pthread_mutex_lock(&worker->mutex);
+        if (worker->count > 0) {
+                part = worker->tasks[worker->top];
+                worker->top = (worker->top + 1) % worker->capacity;
+                worker->count--;
+        }
+        pthread_mutex_unlock(&worker->mutex);
+
+        return part;
+}
+
+/* scheduling */
+
+static void queuePart(struct JobWorker *worker, struct JobPart *part)
+{
+        struct JobPool *pool = worker->pool;
+
+        /* counted first, so that the count never goes below zero */
+        atomic_fetch_add(&pool->queued, 1);
+        pushBottom(worker, part);
+        if (atomic_load(&pool->sleeping) > 0) {
+                pthread_mutex_lock(&pool->mutex);
+                pthread_cond_signal(&pool->workAvailable);
+                pthread_mutex_unlock(&pool->mutex);
+        }
+}
+
+static struct JobPart *nextPart(struct JobWorker *worker)
+{
+        struct JobPool *pool = worker->pool;
+
+        struct JobPart *part = popBottom(worker);
+        size_t const self = (size_t)(worker - pool->workers);
+        for (size_t i = 1; !part && i < pool->workersCount; i++) {
+                part = stealTop(&pool->workers[(self + i) %
+                                               pool->workersCount]);
+        }
+        if (part) {
+                atomic_fetch_sub(&pool->queued, 1);
+        }
+
+        return part;
+}
+
+static void completeJob(struct JobWorker *worker, struct JobFuture *job)
+{
+        struct JobPool *pool = job->pool;
+        struct Allocator *allocator = pool->allocator;
+        struct Reducer const *first = job->parts[0].reducer;
+
+        /* like transduce_parallel, a reduced part hides the parts after it */
+        struct Value result = job->parts[0].result;
+        for (size_t i = 1; i < job->partsCount && !isReduced(&result); i++) {
+                struct Value const right = job->parts[i].result;
+                result = reducer_combine(first, result, unreduced(right),
+                                         allocator);
+                if (isReduced(&right)) {
+                        result = reduced(result);
+                }
+        }
+        result = reducer_complete(first, unreduced(result), allocator);
+
+        /* the result may be boxed in the arena of a part */
+        for (size_t i = 0; i < job->partsCount; i++) {
+                if (result.allocator == &job->parts[i].arena.super) {
+                        result = value_copy(&result, allocator);
+                        break;
+                }
+        }
+        for (size_t i = 0; i < job->partsCount; i++) {
+                job->parts[i].blocks.worker = worker;
+                arena_release(&job->parts[i].arena);
+        }
+        atomic_fetch_sub(&pool->liveParts, job->partsCount);
+        job->result = result;
+
+        pthread_mutex_lock(&pool->mutex);
+        atomic_store(&job->done, true);
+        pthread_cond_broadcast(&pool->completed);
+        pthread_mutex_unlock(&pool->mutex);
+}
+
+static void runChunk(struct JobWorker *worker, struct JobPart *part)
+{
+        struct JobFuture *job = part->job;
+        size_t const elementSize = job->element_size;
+        size_t const chunkSize = job->pool->chunkSize;
+
+        uint8_t const *end = part->end;
+        if ((size_t)(end - part->next) / elementSize > chunkSize) {
+                end = part->next + chunkSize * elementSize;
+        }
+        struct ValueSpan const chunk = {
+            .type_tag = job->type_tag,
+            .element_size = elementSize,
+            .start = part->next,
+            .end = end,
+        };
+        part->next = end;
+
+        part->blocks.worker = worker;
+        part->result = reducer_apply_batch(part->reducer, chunk, part->result,
+                                           &part->arena.super);
+
+        if (part->next < part->end && !isReduced(&part->result)) {
+                queuePart(worker, part);
+                return;
+        }
+        if (atomic_fetch_sub(&job->partsLeft, 1) == 1) {
+                completeJob(worker, job);
+        }
+}
+
+static void *workerRun(void *data)
+{
+        struct JobWorker *worker = data;
+        struct JobPool *pool = worker->pool;
+
+        for (;;) {
+                struct JobPart *part = nextPart(worker);
+                if (part) {
+                        runChunk(worker, part);
+                        continue;
+                }
+
+                pthread_mutex_lock(&pool->mutex);
+                atomic_fetch_add(&pool->sleeping, 1);
+                while (atomic_load(&pool->queued) == 0 && !pool->stopping) {
+                        pthread_cond_wait(&pool->workAvailable, &pool->mutex);
+                }
+                atomic_fetch_sub(&pool->sleeping, 1);
+                bool const stop =
+                    pool->stopping && atomic_load(&pool->queued) == 0;
+                pthread_mutex_unlock(&pool->mutex);
+
+                if (stop) {
+                        break;
+                }
+        }
+
+        return NULL;
+}
+
+/* pool */
+
+/// the workers stop once no part is left queued
+static void stopWorkers(struct JobPool *pool, size_t startedCount)
+{
+        pthread_mutex_lock(&pool->mutex);
+        pool->stopping = true;
+        pthread_cond_broadcast(&pool->workAvailable);
+        pthread_mutex_unlock(&pool->mutex);
+
+        for (size_t i = 0; i < startedCount; i++) {
+                pthread_join(pool->workers[i].thread, NULL);
+        }
+}
+
+static void releasePool(struct JobPool *pool)
+{
+        for (size_t i = 0; i < pool->workersCount; i++) {
+                struct JobWorker *worker = &pool->workers[i];
+                pthread_mutex_destroy(&worker->mutex);
+                allocator_free(pool->allocator, worker->tasks);
+                while (worker->blocks) {
+                        struct WorkerBlock *block = worker->blocks;
+                        worker->blocks = block->next;
+                        allocator_free(pool->allocator,
+                                       (union WorkerBlockHeader *)block - 1);
+                }
+        }
+        pthread_cond_destroy(&pool->completed);
+        pthread_cond_destroy(&pool->workAvailable);
+        pthread_mutex_destroy(&pool->mutex);
+        allocator_free(pool->allocator, pool);
+}
+
+struct JobPool *job_pool_start(size_t workersCount, size_t chunkSize,
+                               struct Allocator *allocator)
+{
+        if (workersCount == 0) {
+                workersCount = 1;
+        }
+
+        struct JobPool *pool = allocator_alloc(
+            allocator, sizeof *pool + workersCount * sizeof pool->workers[0]);
+        if (!pool) {
+                return NULL;
+        }
+
+        *pool = (struct JobPool){
+            .allocator = allocator,
+            .chunkSize = chunkSize > 0 ? chunkSize : 1,
+        };
+        atomic_init(&pool->nextWorker, 0);
+        atomic_init(&pool->queued, 0);
+        atomic_init(&pool->liveParts, 0);
+        atomic_init(&pool->sleeping, 0);
+        pthread_mutex_init(&pool->mutex, NULL);
+        pthread_cond_init(&pool->workAvailable, NULL);
+        pthread_cond_init(&pool->completed, NULL);
+
+        /* workers may steal from each other as soon as they start */
+        for (size_t i = 0; i < workersCount; i++) {
+                struct JobWorker *worker = &pool->workers[i];
+                *worker = (struct JobWorker){
+                    .pool = pool,
+                };
+                pthread_mutex_init(&worker->mutex, NULL);
+        }
+        pool->workersCount = workersCount;
+
+        size_t started = 0;
+        for (; started < workersCount; started++) {
+                struct JobWorker *worker = &pool->workers[started];
+                if (pthread_create(&worker->thread, NULL, workerRun,
+                                   worker) != 0) {
+                        break;
+                }
+        }
+
+        if (started < workersCount) {
+                stopWorkers(pool, started);
+                releasePool(pool);
+                return NULL;
+        }
+
+        return pool;
+}
+
+void job_pool_stop(struct JobPool *pool)
+{
+        stopWorkers(pool, pool->workersCount);
+        releasePool(pool);
+}
+
+struct JobFuture *job_pool_submit(struct JobPool *pool,
+                                  struct ValueSpan input,
+                                  struct Transducer *transducer,
+                                  struct Reducer const *step)
+{
+        struct Allocator *allocator = pool->allocator;
+        struct ChainBuilder const builder =
+            chainBuilderMake(transducer, step, allocator);
+        size_t const count = valueSpanCount(&input);
+
+        /* parts only pay off when they can be combined, and there is no
+         * use in more than one per worker */
+        size_t partsCount = (count + pool->chunkSize - 1) / pool->chunkSize;
+        if (partsCount > pool->workersCount) {
+                partsCount = pool->workersCount;
+        }
+        if (partsCount == 0) {
+                partsCount = 1;
+        }
+
+        size_t const headerSize =
+            alignUp(sizeof(struct JobFuture) +
+                    partsCount * sizeof(struct JobPart));
+        struct JobFuture *job = allocator_alloc(
+            allocator, headerSize + partsCount * builder.chainSize);
+        if (!job) {
+                return NULL;
+        }
+
+        uint8_t *chains = (uint8_t *)job + headerSize;
+        struct Reducer *first = chain_builder_build(&builder, chains);
+        if (!first) {
+                allocator_free(allocator, job);
+                return NULL;
+        }
+        if (!first->combine) {
+                partsCount = 1;
+        }
+        if (!reserveDeques(pool, partsCount)) {
+                allocator_free(allocator, job);
+                return NULL;
+        }
+
+        *job = (struct JobFuture){
+            .pool = pool,
+            .type_tag = input.type_tag,
+            .element_size = input.element_size,
+            .partsCount = partsCount,
+        };
+        atomic_init(&job->partsLeft, partsCount);
+        atomic_init(&job->done, false);
+
+        uint8_t const *partStart = input.start;
+        for (size_t i = 0; i < partsCount; i++) {
+                size_t const partCount =
+                    count / partsCount + (i < count % partsCount);
+                struct Reducer *reducer =
+                    i == 0 ? first
+                           : chain_builder_build(
+                                 &builder, chains + i * builder.chainSize);
+                job->parts[i] = (struct JobPart){
+                    .job = job,
+                    .reducer = reducer,
+                    .next = partStart,
+                    .end = partStart + partCount * input.element_size,
+                    .result = reducer_identity(reducer, allocator),
+                };
+                job->parts[i].blocks = (struct PartBlocks){
+                    .super = {.alloc = partBlocksAlloc, .free = partBlocksFree},
+                    .pool = pool,
+                };
+                arena_init(&job->parts[i].arena, &job->parts[i].blocks.super,
+                           WORKER_BLOCK_SIZE -
+                               alignUp(sizeof(struct ArenaBlock)));
+                partStart = job->parts[i].end;
+        }
+
+        size_t const target =
+            atomic_fetch_add(&pool->nextWorker, 1) % pool->workersCount;
+        for (size_t i = 0; i < partsCount; i++) {
+                queuePart(&pool->workers[target], &job->parts[i]);
+        }
+
+        return job;
+}
+
+bool job_future_done(struct JobFuture *future)
+{
+        return atomic_load(&future->done);
+}
+
+struct Value job_future_wait(struct JobFuture *future)
+{
+        struct JobPool *pool = future->pool;
+
+        pthread_mutex_lock(&pool->mutex);
+        while (!atomic_load(&future->done)) {
+                pthread_cond_wait(&pool->completed, &pool->mutex);
+        }
+        pthread_mutex_unlock(&pool->mutex);
+
+        struct Value const result = future->result;
+        allocator_free(pool->allocator, future);
+
+        return result;
+}
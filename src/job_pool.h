@@ -0,0 +1,59 @@
+#pragma once
+
+/**
+ * @file
+ * Many independent reductions served by a work-stealing pool of threads.
+ *
+ * A job transduces an in-memory input through a transducer into a step,
+ * as transduce_parallel() would, and completes a future. Inputs are
+ * reduced chunkSize elements at a time, a job going back to the deque of
+ * its worker between two chunks, from where idle workers may steal it.
+ * Jobs whose chain can be combined are also cut into parts reduced side
+ * by side by separate chain instances, then combined in input order.
+ *
+ * Each part is reduced with an arena of its own, whichever worker runs
+ * it, released once the job completes: values allocated while reducing
+ * live until then, and a result boxed in an arena is copied out with
+ * value_copy(). Arenas take their blocks from a cache kept by the worker
+ * running the part, filled from the allocator of the pool at first.
+ * Submitting, combining and completing use the allocator of the pool,
+ * which must be safe to use from several threads.
+ */
+
+struct Allocator;
+struct JobFuture;
+struct JobPool;
+struct Reducer;
+struct Transducer;
+
+#include "values.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/// @return NULL when no worker could be started
+struct JobPool *job_pool_start(size_t workersCount, size_t chunkSize,
+                               struct Allocator *allocator);
+
+/// finishes the jobs submitted, then stops all workers. the futures must
+/// all have been waited for.
+void job_pool_stop(struct JobPool *pool);
+
+/**
+ * queues the reduction of input through transducer into step.
+ *
+ * step, and what transducer was made with, are shared by all parts of the
+ * job and must not keep per-run state, see chain_builder.h. input and
+ * transducer must outlive the job.
+ *
+ * @return NULL when the job could not be allocated or its chains built
+ */
+struct JobFuture *job_pool_submit(struct JobPool *pool,
+                                  struct ValueSpan input,
+                                  struct Transducer *transducer,
+                                  struct Reducer const *step);
+
+bool job_future_done(struct JobFuture *future);
+
+/// waits for the job to complete, then releases the future
+struct Value job_future_wait(struct JobFuture *future);
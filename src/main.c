@@ -1,8 +1,34 @@
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include "allocator.h"
 #include "allocator_type.h"
+#include "buffer_sink.h"
+#include "arena_allocator.h"
+#include "block_decoders.h"
+#include "chain_builder.h"
+#include "first_positives_sum.h"
+#include "float_functions.h"
+#include "float_kernels.h"
+#include "float_transducers.h"
+#include "grouping.h"
+#include "job_pool.h"
+#include "parallel_fold.h"
+#include "pipeline_parallel.h"
+#include "pipeline_stages.h"
+#include "pool_allocator.h"
+#include "prefetch_stream.h"
+#include "profiling.h"
+#include "reduce.h"
+#include "static_transducers.h"
+#include "stream.h"
 #include "stream_types.h"
 #include "transducer_types.h"
+#include "tracking_allocator.h"
 #include "transducers.h"
+#include "type_registry.h"
+#include "typed_reducers.h"
 #include "value_stream_types.h"
 #include "value_streams.h"
 #include "values.h"
@@ -10,8 +36,15 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <stdbool.h>
 
+#if defined(__unix__) || defined(__APPLE__)
+#define MAIN_HAS_SOCKETS
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
 /* 1. extensions to values & transducers */
 
 static struct Value floatValue(float const f, struct Allocator *const allocator)
@@ -20,145 +53,70 @@ static struct Value floatValue(float const f, struct Allocator *const allocator)
         *result = f;
         return (struct Value){.type_tag = TTAG_FLOAT,
                               .element_size = sizeof *result,
-                              .address = result};
-}
-
-static float justFloat(struct Value value)
-{
-        assert(value.type_tag == TTAG_FLOAT);
-        return *((float *)value.address);
-}
-
-#define TTAG_IndexedValue (0xd4e1cf8d)
-
-struct IndexedValue
-{
-        struct Value value;
-        size_t index;
-};
-
-static size_t justIndex(struct Value value)
-{
-        assert(value.type_tag == TTAG_IndexedValue);
-        return ((struct IndexedValue *)value.address)->index;
-}
-
-static struct Value indexValue(struct Value value, size_t index,
-                               struct Allocator *allocator)
-{
-        struct IndexedValue *result =
-            allocator_alloc(allocator, sizeof *result);
-
-        *result = (struct IndexedValue){
-            .value = value, .index = index,
-        };
-
-        return (struct Value){TTAG_IndexedValue, sizeof *result, result,
-                              allocator};
+                              .address = result,
+                              .allocator = allocator};
 }
 
-static struct Value justValueOfIndexedValue(struct Value indexedValue)
+static size_t formatIndexedValue(struct Value const *value, char *buffer,
+                                 size_t size)
 {
-        assert(indexedValue.type_tag == TTAG_IndexedValue);
-        return ((struct IndexedValue *)indexedValue.address)->value;
-}
+        struct IndexedValue const *indexed = value->address;
 
-static struct Value transduceFloatArray(float *values, size_t valuesCount,
-                                        struct Transducer *transducer,
-                                        struct Allocator *allocator)
-{
-        struct Reducer *reducer =
-            transducer_apply(transducer, idReducer(allocator), allocator);
-        struct Value result = reducer_identity(reducer, allocator);
-        for (size_t i = 0; i < valuesCount; i++) {
-                struct Value value = {TTAG_FLOAT, sizeof values[i], &values[i],
-                                      0};
-                result = reducer_apply(reducer, value, result, allocator);
-        }
+        size_t length =
+            (size_t)snprintf(buffer, size, "(%zu ", indexed->index);
+        length += value_format(&indexed->value,
+                               length < size ? buffer + length : NULL,
+                               length < size ? size - length : 0);
+        length += (size_t)snprintf(length < size ? buffer + length : NULL,
+                                   length < size ? size - length : 0, ")");
 
-        return reducer_complete(reducer, result, allocator);
+        return length;
 }
 
-/* 2. streams of values */
-
-static struct Value nextValueVSR(struct ValueStreamRange *range)
+static void releaseIndexedValue(struct Value *value)
 {
-        static struct Value zero;
-
-        while (range->error == S_NoError) {
-                if (range->cursor < range->end) {
-                        void const *valueAddress = range->cursor;
-                        range->cursor += range->element_size;
-                        return (struct Value){
-                            .type_tag = range->type_tag,
-                            .element_size = range->element_size,
-                            .address = valueAddress,
-                        };
-                }
-                range->next(range);
-        }
-
-        return zero;
+        struct IndexedValue *indexed = (struct IndexedValue *)value->address;
+        value_release(&indexed->value);
+        freeValue(value);
 }
 
-static struct Value reduceStream(struct ValueStreamRange *range,
-                                 struct Reducer *reducer,
-                                 struct Allocator *allocator)
-{
-        struct Value element;
-        struct Value result = reducer_identity(reducer, allocator);
-        while ((element = nextValueVSR(range), range->error == S_NoError)) {
-                result = reducer_apply(reducer, element, result, allocator);
-        }
-        return reducer_complete(reducer, result, allocator);
-}
-
-/* 3. reducers */
-
-static struct Value accumulateFloat(struct Value const input,
-                                    struct Value const current,
-                                    struct Allocator *const allocator)
-{
-        assert(input.type_tag == TTAG_FLOAT);
-        assert(current.type_tag == TTAG_FLOAT);
-
-        float const *inputFloat = input.address;
-        float const *currentFloat = current.address;
+static struct TypeDescriptor const indexedValueType = {
+    .type_tag = TTAG_IndexedValue,
+    .name = "IndexedValue",
+    .size = sizeof(struct IndexedValue),
+    .alignment = _Alignof(struct IndexedValue),
+    .release = releaseIndexedValue,
+    .format = formatIndexedValue,
+};
 
-        return floatValue(*inputFloat + *currentFloat, allocator);
-}
+/* 2. reducers */
 
-static struct Value accumulateFloatIdentity(struct Reducer const *reducer,
-                                            struct Allocator *allocator)
+/// like accumulateFloatApply, boxing each sum with allocator
+static struct Value boxedAccumulateFloatApply(struct Reducer const *reducer,
+                                              struct Value const input,
+                                              struct Value const current,
+                                              struct Allocator *allocator)
 {
-        static float zero = 0.0f;
-        return (struct Value){
-            .type_tag = TTAG_FLOAT,
-            .element_size = sizeof zero,
-            .address = &zero,
-        };
+        return floatValue(justFloat(input) + justFloat(current), allocator);
 }
 
-static struct Value accumulateFloatApply(struct Reducer const *reducer,
-                                         struct Value const input,
-                                         struct Value const current,
-                                         struct Allocator *allocator)
+/// like boxedAccumulateFloatApply, freeing the previous sum
+static struct Value movingAccumulateFloatApply(struct Reducer const *reducer,
+                                               struct Value const input,
+                                               struct Value current,
+                                               struct Allocator *allocator)
 {
-        return accumulateFloat(input, current, allocator);
+        struct Value const result =
+            floatValue(justFloat(input) + justFloat(current), allocator);
+        freeValue(&current);
+        return result;
 }
 
 static void printValue(struct Value value)
 {
-        if (value.type_tag == TTAG_FLOAT) {
-                printf("%f", *((float *)value.address));
-        } else if (value.type_tag == TTAG_IndexedValue) {
-                printf("(%zu ", justIndex(value));
-                printValue(justValueOfIndexedValue(value));
-                printf(")");
-
-        } else {
-                printf("?");
-        }
+        char buffer[64];
+        value_format(&value, buffer, sizeof buffer);
+        printf("%s", buffer);
 }
 
 static struct Value printReducerApply(struct Reducer const *reducer,
@@ -197,46 +155,12 @@ static struct Reducer *printReducer(struct Allocator *allocator)
         return result;
 }
 
-static bool positiveFloatsOnly(struct Value value, void *data)
-{
-        (void)data;
-        return value.type_tag == TTAG_FLOAT && *((float *)value.address) > 0.0f;
-}
-
-static struct Value indexingReducerApply(struct Reducer const *reducer,
-                                         struct Value input,
-                                         struct Value current,
-                                         struct Allocator *allocator)
-{
-        size_t index;
-        if (current.type_tag == 0) {
-                index = 0;
-        } else {
-                index = 1 + justIndex(current);
-        }
-
-        return indexValue(input, index, allocator);
-}
-
-static struct Value unwrapIndexedValue(struct Value value, void *data)
-{
-        return justValueOfIndexedValue(value);
-}
-
-struct Reducer *indexingReducer(struct Allocator *allocator)
-{
-        struct Reducer *result = allocator_alloc(allocator, sizeof *result);
-
-        *result = (struct Reducer){
-            .apply = indexingReducerApply,
-        };
-
-        return result;
-}
+/* counts the values going through, keeping the count in the reducer of
+ * each run */
 
 struct CountingReducer
 {
-        struct Reducer super;
+        struct ChainedReducer super;
         size_t count;
 };
 
@@ -249,7 +173,7 @@ static struct Value countingReducerApply(struct Reducer const *reducer,
 
         self->count++;
 
-        return input;
+        return reducer_apply(self->super.step, input, current, allocator);
 }
 
 static struct Value countingReducerComplete(struct Reducer const *reducer,
@@ -260,21 +184,33 @@ static struct Value countingReducerComplete(struct Reducer const *reducer,
 
         printf("{counted: %zu}", self->count);
 
-        return result;
+        return reducer_complete(self->super.step, result, allocator);
 }
 
-struct Reducer *countingReducer(struct Allocator *allocator)
+static struct Reducer *countingTransducerApply(struct Transducer *transducer,
+                                               struct Reducer const *step,
+                                               struct Allocator *allocator)
 {
         struct CountingReducer *result =
             allocator_alloc(allocator, sizeof *result);
 
-        *result =
-            (struct CountingReducer){.super = (struct Reducer){
-                                         .apply = countingReducerApply,
-                                         .complete = countingReducerComplete,
-                                     }};
+        *result = (struct CountingReducer){
+            .super = chainedReducerMake(step, countingReducerApply),
+        };
+        result->super.super.complete = countingReducerComplete;
 
-        return &result->super;
+        return &result->super.super;
+}
+
+struct Transducer *countingTransducer(struct Allocator *allocator)
+{
+        struct Transducer *result = allocator_alloc(allocator, sizeof *result);
+
+        *result = (struct Transducer){
+            .apply = countingTransducerApply,
+        };
+
+        return result;
 }
 
 struct Range
@@ -292,34 +228,143 @@ static bool isIndexInRange(struct Value value, void *userData)
         return index >= range->start && index < range->end;
 }
 
-struct Value invertFloat(struct Value value, void *userData)
+struct StopAtIndexReducer
+{
+        struct Reducer super;
+        size_t end;
+};
+
+/// halts the reduction once the element before end went through
+static struct Value stopAtIndexReducerApply(struct Reducer const *reducer,
+                                            struct Value input,
+                                            struct Value current,
+                                            struct Allocator *allocator)
 {
-        struct Allocator *allocator = userData;
-        return floatValue(-justFloat(value), allocator);
+        struct StopAtIndexReducer *self = (struct StopAtIndexReducer *)reducer;
+
+        if (justIndex(input) + 1 >= self->end) {
+                return reduced(input);
+        }
+
+        return input;
+}
+
+struct Reducer *stopAtIndexReducer(size_t end, struct Allocator *allocator)
+{
+        struct StopAtIndexReducer *result =
+            allocator_alloc(allocator, sizeof *result);
+
+        *result = (struct StopAtIndexReducer){
+            .super = (struct Reducer){.apply = stopAtIndexReducerApply},
+            .end = end,
+        };
+
+        return &result->super;
+}
+
+static struct Value boxFloat(struct Value value, void *allocator)
+{
+        return floatValue(justFloat(value), allocator);
+}
+
+static struct Value unboxFloat(struct Value value, void *userData)
+{
+        float const f = justFloat(value);
+        freeValue(&value);
+        return floatImmediate(f);
 }
 
 /* main program */
 
-static void *stdlib_alloc(struct Allocator *const allocator, size_t size)
+/// sum and count of the bytes left in range
+static uint64_t sumBytes(struct StreamRange *range, size_t *count)
 {
-        return malloc(size);
+        uint64_t sum = 0;
+        *count = 0;
+        while (range->error == S_NoError) {
+                for (; range->cursor < range->end; range->cursor++) {
+                        sum += *range->cursor;
+                        ++*count;
+                }
+                range->next(range);
+        }
+
+        return sum;
 }
 
-static void stdlib_free(struct Allocator *const allocator, void *ptr)
+/// stream handing out memory in refills of at most chunkSize bytes
+struct ChunkedStream
 {
-        free(ptr);
+        struct StreamRange range;
+        uint8_t const *mem;
+        uint8_t const *memEnd;
+        size_t chunkSize;
+};
+
+static enum StreamErrorCode chunkedStreamNext(struct StreamRange *range)
+{
+        struct ChunkedStream *stream = (struct ChunkedStream *)range;
+        if (stream->mem == stream->memEnd) {
+                range->error = S_ReadPastEnd;
+                return range->error;
+        }
+
+        size_t const left = (size_t)(stream->memEnd - stream->mem);
+        range->start = stream->mem;
+        range->cursor = stream->mem;
+        stream->mem += left < stream->chunkSize ? left : stream->chunkSize;
+        range->end = stream->mem;
+        return range->error;
 }
 
-int main(int argc, char **argv)
+static void chunkedStream(struct ChunkedStream *stream, uint8_t const *mem,
+                          size_t size, size_t chunkSize)
 {
-        struct Allocator heapAllocator = {
-            .alloc = stdlib_alloc, .free = stdlib_free,
+        *stream = (struct ChunkedStream){
+            .range = {.start = mem,
+                      .end = mem,
+                      .cursor = mem,
+                      .error = S_NoError,
+                      .next = chunkedStreamNext},
+            .mem = mem,
+            .memEnd = mem + size,
+            .chunkSize = chunkSize,
         };
+}
+
+/// seconds, for time windows over floats
+static uint64_t floatAsTime(struct Value value, void *data)
+{
+        return (uint64_t)justFloat(value);
+}
+
+/// keys for grouping floats, their integer part modulo 4
+static uint64_t floatModFour(struct Value value, void *data)
+{
+        return (uint64_t)justFloat(value) % 4;
+}
+
+/* 13. a statically composed chain, negating and keeping positive floats */
+
+XF_SINK(negatePositivesSink)
+XF_FILTER_FLOAT(negatePositivesFilter, isPositiveFloat, negatePositivesSink)
+XF_MAP_FLOAT(negatePositivesMap, negateFloat, negatePositivesFilter)
+XF_REDUCER(negatePositives, negatePositivesMap)
+
+int main(int argc, char **argv)
+{
+        struct Allocator heapAllocator = stdlibAllocator();
 
         static struct Reducer accumulator = {
-            .identity = accumulateFloatIdentity, .apply = accumulateFloatApply,
+            .identity = accumulateFloatIdentity,
+            .apply = accumulateFloatApply,
+            .combine = accumulateFloatApply,
         };
 
+        /* before any of its values gets printed */
+        type_register(&indexedValueType);
+        grouping_register_types();
+
         printf("1. individual test\n");
         {
                 struct Value a = floatValue(1.0f, &heapAllocator);
@@ -396,15 +441,16 @@ int main(int argc, char **argv)
                     .start = 0, .end = 4,
                 };
                 struct Transducer *processSteps[] = {
-                    mappingTransducer(countingReducer(&heapAllocator),
-                                      &heapAllocator),
-                    mappingFnTransducer(invertFloat, &heapAllocator,
-                                        &heapAllocator),
+                    countingTransducer(&heapAllocator),
+                    mappingFnTransducer(invertFloat, NULL, &heapAllocator),
                     filteringTransducer(positiveFloatsOnly, NULL,
                                         &heapAllocator),
                     mappingTransducer(indexingReducer(&heapAllocator),
                                       &heapAllocator),
                     filteringTransducer(isIndexInRange, &range, &heapAllocator),
+                    mappingTransducer(
+                        stopAtIndexReducer(range.end, &heapAllocator),
+                        &heapAllocator),
                     mappingTransducer(printReducer(&heapAllocator),
                                       &heapAllocator),
                     mappingFnTransducer(unwrapIndexedValue, NULL,
@@ -422,7 +468,7 @@ int main(int argc, char **argv)
                             values, sizeof values / sizeof values[0], process,
                             &heapAllocator);
 
-                        printf("expected: {counted: 4}\n");
+                        printf("expected: {counted: 8}\n");
                         if (result.type_tag == TTAG_FLOAT) {
                                 printf("result is: %f ; expected 19.0\n",
                                        justFloat(result));
@@ -430,5 +476,1282 @@ int main(int argc, char **argv)
                 }
         }
 
+        printf("5. release a whole transduction at once with an arena\n");
+        {
+                struct ArenaAllocator arena;
+                arena_init(&arena, &heapAllocator, 4096);
+
+                float values[] = {1.0f, -2.0f, 3.0f, -4.0f, 5.0f};
+                struct Transducer *processSteps[] = {
+                    filteringTransducer(positiveFloatsOnly, NULL,
+                                        &heapAllocator),
+                    mappingTransducer(&accumulator, &heapAllocator),
+                };
+                struct Transducer *process = composingTransducer(
+                    processSteps, sizeof processSteps / sizeof processSteps[0],
+                    &heapAllocator);
+
+                struct ArenaMark const mark = arena_mark(&arena);
+                for (int run = 0; run < 2; run++) {
+                        struct Value result = transduceFloatArray(
+                            values, sizeof values / sizeof values[0], process,
+                            &arena.super);
+                        printf("run %d result is: %f ; expected: 9.0\n", run,
+                               justFloat(result));
+                        arena_reset(&arena, mark);
+                }
+                printf("blocks reused across runs: %s ; expected: yes\n",
+                       arena.first && !arena.first->next ? "yes" : "no");
+
+                arena_release(&arena);
+        }
+
+        printf("6. fuse adjacent mapping and filtering stages\n");
+        {
+                float values[] = {1.0f, -2.0f, 3.0f, -4.0f};
+                struct Transducer *processSteps[] = {
+                    mappingFnTransducer(invertFloat, NULL, &heapAllocator),
+                    filteringTransducer(positiveFloatsOnly, NULL,
+                                        &heapAllocator),
+                    mappingFnTransducer(invertFloat, NULL, &heapAllocator),
+                    mappingTransducer(&accumulator, &heapAllocator),
+                };
+                struct Transducer *process = composingTransducer(
+                    processSteps, sizeof processSteps / sizeof processSteps[0],
+                    &heapAllocator);
+
+                struct Value result = transduceFloatArray(
+                    values, sizeof values / sizeof values[0], process,
+                    &heapAllocator);
+                printf("result is: %f ; expected: -6.0\n", justFloat(result));
+        }
+
+        printf("7. float pipelines on whole buffers (%s)\n", floatKernelsISA());
+        {
+                static float values[10000];
+                size_t const valuesCount = sizeof values / sizeof values[0];
+                float expectedSum = 0.0f, expectedMax = -8.0f,
+                      expectedMin = 8.0f;
+                for (size_t i = 0; i < valuesCount; i++) {
+                        values[i] = (float)((int)(i % 17) - 8);
+                        if (values[i] > 0.0f) {
+                                expectedSum += values[i];
+                        }
+                        if (-values[i] > expectedMax) {
+                                expectedMax = -values[i];
+                        }
+                        if (-values[i] < expectedMin) {
+                                expectedMin = -values[i];
+                        }
+                }
+
+                struct ValueStreamRange valuesRange;
+                floatArrayVSR(&valuesRange, values, valuesCount);
+                struct Reducer *sumOfPositives = transducer_apply(
+                    floatThresholdTransducer(0.0f, &heapAllocator),
+                    floatSumReducer(&heapAllocator), &heapAllocator);
+                struct Value result =
+                    reduceStream(&valuesRange, sumOfPositives, &heapAllocator);
+                printf("sum is: %f ; expected: %f\n", justFloat(result),
+                       expectedSum);
+
+                struct Transducer *processSteps[] = {
+                    floatScalingTransducer(-1.0f, &heapAllocator),
+                    mappingTransducer(floatMaxReducer(&heapAllocator),
+                                      &heapAllocator),
+                };
+                struct Transducer *process = composingTransducer(
+                    processSteps, sizeof processSteps / sizeof processSteps[0],
+                    &heapAllocator);
+                result = transduceFloatArray(values, valuesCount, process,
+                                             &heapAllocator);
+                printf("max is: %f ; expected: %f\n", justFloat(result),
+                       expectedMax);
+
+                struct Transducer *minSteps[] = {
+                    floatScalingTransducer(-1.0f, &heapAllocator),
+                    mappingTransducer(floatMinReducer(&heapAllocator),
+                                      &heapAllocator),
+                };
+                result = transduceFloatArray(
+                    values, valuesCount,
+                    composingTransducer(minSteps,
+                                        sizeof minSteps / sizeof minSteps[0],
+                                        &heapAllocator),
+                    &heapAllocator);
+                printf("min is: %f ; expected: %f\n", justFloat(result),
+                       expectedMin);
+
+                /* the mapped sum still takes the inputs summed */
+                struct Transducer *mappedSum =
+                    mappingTransducer(floatSumReducer(&heapAllocator),
+                                      &heapAllocator);
+                struct Reducer const *mappedSumReducer = transducer_apply(
+                    mappedSum, idReducer(&heapAllocator), &heapAllocator);
+                struct Transducer *thresholdSteps[] = {
+                    floatThresholdTransducer(0.0f, &heapAllocator),
+                    mappedSum,
+                };
+                result = transduceFloatArray(
+                    values, valuesCount,
+                    composingTransducer(thresholdSteps,
+                                        sizeof thresholdSteps /
+                                            sizeof thresholdSteps[0],
+                                        &heapAllocator),
+                    &heapAllocator);
+                printf("mapped sum is: %f, additive: %s ; expected: %f, "
+                       "additive: yes\n",
+                       justFloat(result),
+                       mappedSumReducer->properties & RP_ADDITIVE ? "yes"
+                                                                  : "no",
+                       expectedSum);
+
+                /* stages passing values through keep it additive */
+                struct StageProfile boundaryProfile = {.name = "boundary"};
+                struct Reducer const *passing = transducer_apply(
+                    profilingTransducer(
+                        pipelineBoundaryTransducer(2, 64, &heapAllocator),
+                        &boundaryProfile, &heapAllocator),
+                    mappedSumReducer, &heapAllocator);
+                printf("additive behind a profiled boundary: %s ; expected: "
+                       "yes\n",
+                       passing->properties & RP_ADDITIVE ? "yes" : "no");
+        }
+
+        printf("8. reduce chunks of an array in parallel\n");
+        {
+                static float values[1000000];
+                size_t const valuesCount = sizeof values / sizeof values[0];
+                float expected = 0.0f;
+                for (size_t i = 0; i < valuesCount; i++) {
+                        values[i] = (float)((int)(i % 5) - 2);
+                        if (values[i] > 0.0f) {
+                                expected += values[i];
+                        }
+                }
+
+                struct Transducer *processSteps[] = {
+                    filteringTransducer(positiveFloatsOnly, NULL,
+                                        &heapAllocator),
+                    mappingTransducer(&accumulator, &heapAllocator),
+                };
+                struct Transducer *process = composingTransducer(
+                    processSteps, sizeof processSteps / sizeof processSteps[0],
+                    &heapAllocator);
+
+                struct ValueSpan const input = {
+                    .type_tag = TTAG_FLOAT,
+                    .element_size = sizeof values[0],
+                    .start = (uint8_t const *)values,
+                    .end = (uint8_t const *)(values + valuesCount),
+                };
+                struct Reducer *step = idReducer(&heapAllocator);
+                for (size_t workers = 1; workers <= 4; workers *= 2) {
+                        struct Value result = transduce_parallel(
+                            input, process, step, workers, &heapAllocator);
+                        printf("%zu workers, result is: %f ; expected: %f\n",
+                               workers, justFloat(result), expected);
+                }
+        }
+
+        printf("9. read a file through mapped and buffered streams\n");
+        {
+                enum FileStreamBackend const backends[] = {FSB_Mapped,
+                                                           FSB_Buffered};
+                uint64_t sums[2];
+                size_t counts[2];
+                for (size_t i = 0; i < 2; i++) {
+                        struct FileStream stream;
+                        if (stream_on_file(&stream, argv[0], backends[i], 4096,
+                                           &heapAllocator) != S_NoError) {
+                                printf("could not open %s\n", argv[0]);
+                                sums[i] = i, counts[i] = 0;
+                                continue;
+                        }
+                        sums[i] = sumBytes(&stream.range, &counts[i]);
+                        stream_close_file(&stream);
+                }
+                printf("same contents: %s ; expected: yes\n",
+                       sums[0] == sums[1] && counts[0] == counts[1] &&
+                               counts[0] > 0
+                           ? "yes"
+                           : "no");
+        }
+
+        printf("10. refill streams on a background thread\n");
+        {
+                struct FileStream file;
+                uint64_t expected = 0, sum = 0;
+                size_t expectedCount = 0, count = 0;
+                if (stream_on_file(&file, argv[0], FSB_Mapped, 0,
+                                   &heapAllocator) == S_NoError) {
+                        expected = sumBytes(&file.range, &expectedCount);
+                        stream_close_file(&file);
+                }
+                if (stream_on_file(&file, argv[0], FSB_Buffered, 1000,
+                                   &heapAllocator) == S_NoError) {
+                        struct PrefetchStream prefetched;
+                        stream_prefetch(&prefetched, &file.range, 4, 333,
+                                        &heapAllocator);
+                        sum = sumBytes(&prefetched.range, &count);
+                        stream_close_prefetch(&prefetched);
+                        stream_close_file(&file);
+                }
+                printf("same contents: %s ; expected: yes\n",
+                       sum == expected && count == expectedCount ? "yes"
+                                                                 : "no");
+
+                float values[1000];
+                size_t const valuesCount = sizeof values / sizeof values[0];
+                for (size_t i = 0; i < valuesCount; i++) {
+                        values[i] = (float)(i % 10);
+                }
+                struct ValueStreamRange valuesRange;
+                floatArrayVSR(&valuesRange, values, valuesCount);
+                struct PrefetchValueStream prefetchedValues;
+                prefetchVSR(&prefetchedValues, &valuesRange, 3, 64,
+                            &heapAllocator);
+                struct Value result = reduceStream(
+                    &prefetchedValues.range, floatSumReducer(&heapAllocator),
+                    &heapAllocator);
+                closePrefetchVSR(&prefetchedValues);
+                printf("result is: %f ; expected: 4500.0\n", justFloat(result));
+        }
+
+        printf("11. profile each stage of a pipeline\n");
+        {
+                float values[] = {-1.0f, 1.0f,  -2.0f, 2.0f,
+                                  3.0f,  -3.0f, 4.0f,  -4.0f};
+                struct Transducer *processSteps[] = {
+                    filteringTransducer(positiveFloatsOnly, NULL,
+                                        &heapAllocator),
+                    mappingTransducer(indexingReducer(&heapAllocator),
+                                      &heapAllocator),
+                    mappingFnTransducer(unwrapIndexedValue, NULL,
+                                        &heapAllocator),
+                    mappingTransducer(&accumulator, &heapAllocator),
+                };
+                struct StageProfile profiles[] = {
+                    {.name = "positives"},
+                    {.name = "index"},
+                    {.name = "unwrap"},
+                    {.name = "accumulate", .samplingPeriod = 2},
+                };
+                struct Transducer *process = profilingComposingTransducer(
+                    processSteps, sizeof processSteps / sizeof processSteps[0],
+                    profiles, &heapAllocator);
+
+                struct Value result = transduceFloatArray(
+                    values, sizeof values / sizeof values[0], process,
+                    &heapAllocator);
+                printf("result is: %f ; expected: 10.0\n", justFloat(result));
+                for (size_t i = 0; i < sizeof profiles / sizeof profiles[0];
+                     i++) {
+                        struct StageProfile const *profile = &profiles[i];
+                        printf("%s: in %llu, dropped %llu, allocations %llu\n",
+                               profile->name,
+                               (unsigned long long)profile->inputs,
+                               (unsigned long long)stage_profile_dropped(
+                                   profile),
+                               (unsigned long long)profile->allocations);
+                }
+                printf("expected: in 8, dropped 4, allocations 0\n"
+                       "expected: in 4, dropped 0, allocations 4\n"
+                       "expected: in 4, dropped 0, allocations 0\n"
+                       "expected: in 4, dropped 0, allocations 0\n");
+        }
+
+        printf("12. run a pipeline compiled by xfc\n");
+        {
+                float const values[] = {
+                    -3.0f, -5.0f, 1.0f, 2.0f, 3.0f, 4.0f, -5.0f, -6.0f, -7.0f,
+                };
+                float const result = firstPositivesSum(
+                    values, sizeof values / sizeof values[0]);
+                printf("result is: %f ; expected: 19.0\n", result);
+        }
+
+        printf("13. run a statically composed chain\n");
+        {
+                float const values[] = {
+                    -3.0f, -5.0f, 1.0f, 2.0f, 3.0f, 4.0f, -5.0f, -6.0f, -7.0f,
+                };
+                struct ValueSpan const input = {
+                    .type_tag = TTAG_FLOAT,
+                    .element_size = sizeof values[0],
+                    .start = (uint8_t const *)values,
+                    .end = (uint8_t const *)(values + sizeof values /
+                                                          sizeof values[0]),
+                };
+
+                struct Value result = negatePositivesSpan(
+                    input, floatImmediate(0.0f), &accumulator, &heapAllocator);
+                printf("result is: %f ; expected: 26.0\n", justFloat(result));
+
+                struct ChainedReducer reducer =
+                    negatePositivesReducer(printReducer(&heapAllocator));
+                struct ValueStreamRange valuesRange;
+                floatArrayVSR(&valuesRange, values,
+                              sizeof values / sizeof values[0]);
+                reduceStream(&valuesRange, &reducer.super, &heapAllocator);
+                printf("expected: [3.0, 5.0, 5.0, 6.0, 7.0]\n");
+        }
+
+        printf("14. view a byte stream as floats\n");
+        {
+                static float values[1000];
+                size_t const valuesCount = sizeof values / sizeof values[0];
+                for (size_t i = 0; i < valuesCount; i++) {
+                        values[i] = (float)(i % 7);
+                }
+
+                struct StreamRange bytes;
+                stream_on_memory(&bytes, (uint8_t const *)values,
+                                 sizeof values);
+                struct ByteValueStream view;
+                byteStreamVSR(&view, &bytes, TTAG_FLOAT, sizeof(float),
+                              _Alignof(float));
+                struct Value result =
+                    reduceStream(&view.range, &accumulator, &heapAllocator);
+                printf("aligned: result is: %f, copied %zu bytes ; expected: "
+                       "2997.0, copied 0 bytes\n",
+                       justFloat(result), view.copiedBytes);
+
+                struct ChunkedStream chunks;
+                chunkedStream(&chunks, (uint8_t const *)values, sizeof values,
+                              10);
+                byteStreamVSR(&view, &chunks.range, TTAG_FLOAT, sizeof(float),
+                              _Alignof(float));
+                result =
+                    reduceStream(&view.range, &accumulator, &heapAllocator);
+                printf("straddling: result is: %f, copied %zu bytes ; "
+                       "expected: 2997.0, copied 800 bytes\n",
+                       justFloat(result), view.copiedBytes);
+        }
+
+        printf("15. reduce a list of chunks without concatenating them\n");
+        {
+                float const first[] = {1.0f, 2.0f, 3.0f};
+                float const second[] = {4.0f};
+                float const third[] = {5.0f, 6.0f};
+                struct ValueChunk const chunks[] = {
+                    {first, 3}, {NULL, 0}, {second, 1}, {third, 2},
+                };
+
+                struct ChunkedValueStream stream;
+                chunksVSR(&stream, TTAG_FLOAT, sizeof(float), chunks,
+                          sizeof chunks / sizeof chunks[0]);
+                struct Value result =
+                    reduceStream(&stream.range, &accumulator, &heapAllocator);
+                printf("result is: %f ; expected: 21.0\n", justFloat(result));
+        }
+
+        printf("16. build chains for interleaved runs in blocks\n");
+        {
+                struct Transducer *processSteps[] = {
+                    filteringTransducer(positiveFloatsOnly, NULL,
+                                        &heapAllocator),
+                    mappingTransducer(&accumulator, &heapAllocator),
+                };
+                struct Transducer *process = composingTransducer(
+                    processSteps, sizeof processSteps / sizeof processSteps[0],
+                    &heapAllocator);
+                struct ChainBuilder const builder = chainBuilderMake(
+                    process, idReducer(&heapAllocator), &heapAllocator);
+
+                float const first[] = {1.0f, -2.0f, 3.0f, 4.0f};
+                float const second[] = {10.0f, 20.0f, -30.0f};
+                struct ValueSpan const firstHalves[] = {
+                    {TTAG_FLOAT, sizeof(float), (uint8_t const *)first,
+                     (uint8_t const *)(first + 2)},
+                    {TTAG_FLOAT, sizeof(float), (uint8_t const *)(first + 2),
+                     (uint8_t const *)(first + 4)},
+                };
+                struct ValueSpan const secondSpan = {
+                    TTAG_FLOAT, sizeof(float), (uint8_t const *)second,
+                    (uint8_t const *)(second + 3),
+                };
+
+                uint8_t *chains =
+                    allocator_alloc(&heapAllocator, 2 * builder.chainSize);
+                struct Reducer *a = chain_builder_build(&builder, chains);
+                struct Reducer *b =
+                    chain_builder_build(&builder, chains + builder.chainSize);
+
+                struct Value resultA = reducer_identity(a, &heapAllocator);
+                struct Value resultB = reducer_identity(b, &heapAllocator);
+                resultA = reducer_apply_batch(a, firstHalves[0], resultA,
+                                              &heapAllocator);
+                resultB = reducer_apply_batch(b, secondSpan, resultB,
+                                              &heapAllocator);
+                resultA = reducer_apply_batch(a, firstHalves[1], resultA,
+                                              &heapAllocator);
+                printf("a: %f, b: %f ; expected a: 8.0, b: 30.0\n",
+                       justFloat(reducer_complete(a, resultA, &heapAllocator)),
+                       justFloat(reducer_complete(b, resultB, &heapAllocator)));
+
+                a = chain_builder_build(&builder, chains);
+                resultA = reducer_apply_batch(
+                    a, secondSpan, reducer_identity(a, &heapAllocator),
+                    &heapAllocator);
+                printf("a reused: %f ; expected: 30.0\n",
+                       justFloat(reducer_complete(a, resultA, &heapAllocator)));
+                allocator_free(&heapAllocator, chains);
+        }
+
+        printf("17. lay out a composed chain in one block\n");
+        {
+                struct Transducer *processSteps[] = {
+                    filteringTransducer(positiveFloatsOnly, NULL,
+                                        &heapAllocator),
+                    mappingTransducer(indexingReducer(&heapAllocator),
+                                      &heapAllocator),
+                    mappingFnTransducer(unwrapIndexedValue, NULL,
+                                        &heapAllocator),
+                    mappingTransducer(&accumulator, &heapAllocator),
+                };
+                size_t const stagesCount =
+                    sizeof processSteps / sizeof processSteps[0];
+                struct Transducer *process = composingTransducer(
+                    processSteps, stagesCount, &heapAllocator);
+
+                struct Reducer const *step = idReducer(&heapAllocator);
+                struct Reducer *chain =
+                    transducer_apply(process, step, &heapAllocator);
+                bool inOrder = true;
+                struct Reducer const *stage = chain;
+                for (size_t i = 0; i < stagesCount; i++) {
+                        struct Reducer const *next =
+                            ((struct ChainedReducer const *)stage)->step;
+                        uint8_t const *stageEnd = (uint8_t const *)stage +
+                                                  transducer_size(
+                                                      processSteps[i]);
+                        if (i + 1 < stagesCount &&
+                            (uint8_t const *)next != stageEnd) {
+                                inOrder = false;
+                        }
+                        stage = next;
+                }
+                printf("stages in order: %s, step last: %s ; expected: yes, "
+                       "yes\n",
+                       inOrder ? "yes" : "no", stage == step ? "yes" : "no");
+
+                float const values[] = {1.0f, -2.0f, 3.0f, 4.0f};
+                struct Value result = transduceFloatArray(
+                    values, sizeof values / sizeof values[0], process,
+                    &heapAllocator);
+                printf("result is: %f ; expected: 8.0\n", justFloat(result));
+        }
+
+        printf("18. sum windows of values\n");
+        {
+                float const values[] = {1.0f, 2.0f, 3.0f, 4.0f, 5.0f,
+                                        6.0f, 7.0f, 8.0f, 9.0f, 10.0f};
+                size_t const valuesCount = sizeof values / sizeof values[0];
+                struct Transducer *windows[] = {
+                    partitioningTransducer(4, sizeof(float), &heapAllocator),
+                    slidingWindowTransducer(3, 2, sizeof(float),
+                                            &heapAllocator),
+                    timeWindowTransducer(3, floatAsTime, NULL, 2,
+                                         sizeof(float), &heapAllocator),
+                };
+                char const *expectations[] = {
+                    "[10.0, 26.0, 19.0]",
+                    "[6.0, 12.0, 18.0, 24.0]",
+                    "[3.0, 7.0, 5.0, 13.0, 8.0, 19.0]",
+                };
+
+                for (size_t i = 0; i < sizeof windows / sizeof windows[0];
+                     i++) {
+                        struct Transducer *processSteps[] = {
+                            windows[i],
+                            spanReducingTransducer(
+                                floatSumReducer(&heapAllocator),
+                                &heapAllocator),
+                        };
+                        struct Transducer *process = composingTransducer(
+                            processSteps,
+                            sizeof processSteps / sizeof processSteps[0],
+                            &heapAllocator);
+                        struct Reducer *reducer = transducer_apply(
+                            process, printReducer(&heapAllocator),
+                            &heapAllocator);
+
+                        struct ValueStreamRange valuesRange;
+                        floatArrayVSR(&valuesRange, values, valuesCount);
+                        reduceStream(&valuesRange, reducer, &heapAllocator);
+                        printf("expected: %s\n", expectations[i]);
+                }
+
+                /* values that do not fit the window are left out */
+                struct Transducer *pairsSteps[] = {
+                    partitioningTransducer(2, sizeof(float), &heapAllocator),
+                    spanReducingTransducer(floatSumReducer(&heapAllocator),
+                                           &heapAllocator),
+                };
+                struct Reducer *pairs = transducer_apply(
+                    composingTransducer(pairsSteps,
+                                        sizeof pairsSteps /
+                                            sizeof pairsSteps[0],
+                                        &heapAllocator),
+                    printReducer(&heapAllocator), &heapAllocator);
+                struct Value untyped = floatImmediate(100.0f);
+                untyped.type_tag = TTAG_NULL;
+                struct Value const inputs[] = {
+                    floatImmediate(1.0f), intImmediate(100), untyped,
+                    floatImmediate(2.0f), floatImmediate(3.0f),
+                };
+                struct Value result = reducer_identity(pairs, &heapAllocator);
+                for (size_t i = 0; i < sizeof inputs / sizeof inputs[0];
+                     i++) {
+                        result = reducer_apply(pairs, inputs[i], result,
+                                               &heapAllocator);
+                }
+                reducer_complete(pairs, result, &heapAllocator);
+                printf("expected: [3.0, 3.0]\n");
+        }
+
+        printf("19. take, drop, take while and dedupe\n");
+        {
+                float const values[] = {-3.0, -5.0, 1.0,  2.0, 3.0,
+                                        4.0,  -5.0, -6.0, -7.0};
+                struct Transducer *takeSteps[] = {
+                    countingTransducer(&heapAllocator),
+                    mappingFnTransducer(invertFloat, NULL, &heapAllocator),
+                    filteringTransducer(positiveFloatsOnly, NULL,
+                                        &heapAllocator),
+                    takingTransducer(4, &heapAllocator),
+                    mappingTransducer(&accumulator, &heapAllocator),
+                };
+                struct Value result = transduceFloatArray(
+                    values, sizeof values / sizeof values[0],
+                    composingTransducer(takeSteps, sizeof takeSteps /
+                                                       sizeof takeSteps[0],
+                                        &heapAllocator),
+                    &heapAllocator);
+                printf("\ntake: result is: %f ; expected: {counted: 8} "
+                       "19.0\n",
+                       justFloat(result));
+
+                float const repeats[] = {1.0f, 1.0f, 2.0f, 2.0f,
+                                         2.0f, 3.0f, 1.0f, 1.0f};
+                struct Transducer *dedupeSteps[] = {
+                    dedupingTransducer(sizeof(float), &heapAllocator),
+                    droppingTransducer(1, &heapAllocator),
+                    mappingTransducer(&accumulator, &heapAllocator),
+                };
+                result = transduceFloatArray(
+                    repeats, sizeof repeats / sizeof repeats[0],
+                    composingTransducer(dedupeSteps, sizeof dedupeSteps /
+                                                         sizeof dedupeSteps[0],
+                                        &heapAllocator),
+                    &heapAllocator);
+                printf("dedupe and drop: result is: %f ; expected: 6.0\n",
+                       justFloat(result));
+
+                struct Transducer *whileSteps[] = {
+                    takingWhileTransducer(positiveFloatsOnly, NULL,
+                                          &heapAllocator),
+                    mappingTransducer(&accumulator, &heapAllocator),
+                };
+                result = transduceFloatArray(
+                    values + 2, 7,
+                    composingTransducer(whileSteps, sizeof whileSteps /
+                                                        sizeof whileSteps[0],
+                                        &heapAllocator),
+                    &heapAllocator);
+                printf("take while: result is: %f ; expected: 10.0\n",
+                       justFloat(result));
+        }
+
+        printf("20. collect results into a buffer\n");
+        {
+                static float values[1000];
+                size_t const valuesCount = sizeof values / sizeof values[0];
+                for (size_t i = 0; i < valuesCount; i++) {
+                        values[i] = (float)((int)(i % 4) - 1);
+                }
+                struct Transducer *process = filteringTransducer(
+                    positiveFloatsOnly, NULL, &heapAllocator);
+
+                struct BufferSink sink;
+                bufferSinkInit(&sink, &heapAllocator);
+                struct ValueStreamRange valuesRange;
+                floatArrayVSR(&valuesRange, values, valuesCount);
+                reduceStream(&valuesRange,
+                             transducer_apply(process, &sink.super,
+                                              &heapAllocator),
+                             &heapAllocator);
+                float const *collected = (float const *)sink.data;
+                printf("collected %zu, first %f and last %f ; expected: 500, "
+                       "1.0 and 2.0\n",
+                       sink.count, collected[0], collected[sink.count - 1]);
+                bufferSinkRelease(&sink);
+
+                float window[3];
+                struct OutputStreamRange output;
+                stream_to_memory(&output, (uint8_t *)window, sizeof window);
+                bufferSinkOnOutput(&sink, &output);
+                floatArrayVSR(&valuesRange, values, valuesCount);
+                struct Value written = reduceStream(
+                    &valuesRange,
+                    transducer_apply(process, &sink.super, &heapAllocator),
+                    &heapAllocator);
+                printf("written %zu: %f %f %f ; expected 3: 1.0 2.0 1.0\n",
+                       written.immediate.index, window[0], window[1],
+                       window[2]);
+        }
+
+        printf("21. recycle boxed values through a pool\n");
+        {
+                struct PoolAllocator pool;
+                pool_init(&pool, &heapAllocator, 64 * 1024);
+
+                static struct Value boxes[1000];
+                size_t const boxesCount = sizeof boxes / sizeof boxes[0];
+                size_t slabsCount = 0;
+                for (int round = 0; round < 3; round++) {
+                        for (size_t i = 0; i < boxesCount; i++) {
+                                boxes[i] = floatValue((float)i, &pool.super);
+                        }
+                        for (size_t i = 0; i < boxesCount; i++) {
+                                freeValue(&boxes[i]);
+                        }
+                        if (round == 0) {
+                                slabsCount = atomic_load(&pool.slabsCount);
+                        }
+                }
+                printf("slabs grew: %s ; expected: no\n",
+                       atomic_load(&pool.slabsCount) != slabsCount ? "yes"
+                                                                   : "no");
+
+                /* pools sharing the cache slots of this thread */
+                enum { POOLS_COUNT = 12 };
+                static struct PoolAllocator pools[POOLS_COUNT];
+                for (size_t i = 0; i < POOLS_COUNT; i++) {
+                        pool_init(&pools[i], &heapAllocator, 4 * 1024);
+                }
+                for (int round = 0; round < 100; round++) {
+                        for (size_t i = 0; i < POOLS_COUNT; i++) {
+                                struct Value box =
+                                    floatValue(1.0f, &pools[i].super);
+                                freeValue(&box);
+                        }
+                }
+                slabsCount = 0;
+                for (size_t i = 0; i < POOLS_COUNT; i++) {
+                        slabsCount += atomic_load(&pools[i].slabsCount);
+                        pool_release(&pools[i]);
+                }
+                printf("slabs of %d pools: %zu ; expected: %d\n",
+                       POOLS_COUNT, slabsCount, POOLS_COUNT);
+
+                /* boxed by the producer, freed by the consumer */
+                enum { BOXED_COUNT = 10000 };
+                static float boxedValues[BOXED_COUNT];
+                for (size_t i = 0; i < BOXED_COUNT; i++) {
+                        boxedValues[i] = 1.0f;
+                }
+                struct Transducer *boxingSteps[] = {
+                    mappingFnTransducer(boxFloat, &pool.super, &heapAllocator),
+                    pipelineBoundaryTransducer(2, 64, &heapAllocator),
+                    mappingFnTransducer(unboxFloat, NULL, &heapAllocator),
+                    mappingTransducer(&accumulator, &heapAllocator),
+                };
+                size_t const slabsBefore = atomic_load(&pool.slabsCount);
+                struct Value boxedSum = transduceFloatArray(
+                    boxedValues, BOXED_COUNT,
+                    composingTransducer(boxingSteps,
+                                        sizeof boxingSteps /
+                                            sizeof boxingSteps[0],
+                                        &heapAllocator),
+                    &heapAllocator);
+                printf("across threads: %f, slabs grew by %zu ; expected: "
+                       "10000.0, at most 2\n",
+                       justFloat(boxedSum),
+                       atomic_load(&pool.slabsCount) - slabsBefore);
+
+                struct Range range = {
+                    .start = 0, .end = 4,
+                };
+                struct Transducer *processSteps[] = {
+                    mappingFnTransducer(invertFloat, NULL, &heapAllocator),
+                    filteringTransducer(positiveFloatsOnly, NULL,
+                                        &heapAllocator),
+                    mappingTransducer(indexingReducer(&heapAllocator),
+                                      &heapAllocator),
+                    filteringTransducer(isIndexInRange, &range, &heapAllocator),
+                    mappingFnTransducer(unwrapIndexedValue, NULL,
+                                        &heapAllocator),
+                    mappingTransducer(&accumulator, &heapAllocator),
+                };
+                struct Transducer *process = composingTransducer(
+                    processSteps, sizeof processSteps / sizeof processSteps[0],
+                    &heapAllocator);
+                float const values[] = {-3.0, -5.0, 1.0,  2.0, 3.0,
+                                        4.0,  -5.0, -6.0, -7.0};
+                struct Value result = transduceFloatArray(
+                    values, sizeof values / sizeof values[0], process,
+                    &pool.super);
+                printf("result is: %f ; expected: 19.0\n", justFloat(result));
+
+                pool_release(&pool);
+        }
+
+        printf("22. index values by column\n");
+        {
+                float values[] = {-1.0f, 1.0f,  -2.0f, 2.0f,
+                                  3.0f,  -3.0f, 4.0f,  -4.0f};
+                struct Transducer *processSteps[] = {
+                    filteringTransducer(positiveFloatsOnly, NULL,
+                                        &heapAllocator),
+                    indexingTransducer(&heapAllocator),
+                    indexRangeTransducer(0, 3, &heapAllocator),
+                    unwrappingTransducer(&heapAllocator),
+                    mappingTransducer(&accumulator, &heapAllocator),
+                };
+                struct StageProfile profiles[] = {
+                    {.name = "positives"}, {.name = "index"},
+                    {.name = "range"},     {.name = "unwrap"},
+                    {.name = "accumulate"},
+                };
+                size_t const stagesCount =
+                    sizeof processSteps / sizeof processSteps[0];
+                struct Transducer *process = profilingComposingTransducer(
+                    processSteps, stagesCount, profiles, &heapAllocator);
+
+                struct Value result = transduceFloatArray(
+                    values, sizeof values / sizeof values[0], process,
+                    &heapAllocator);
+                uint64_t allocations = 0;
+                for (size_t i = 0; i < stagesCount; i++) {
+                        allocations += profiles[i].allocations;
+                }
+                printf("result is: %f, allocations %llu ; expected: 6.0, "
+                       "allocations 0\n",
+                       justFloat(result), (unsigned long long)allocations);
+        }
+
+        printf("23. run segments of a chain on their own threads\n");
+        {
+                enum { VALUES_COUNT = 1000 };
+                float values[VALUES_COUNT];
+                for (size_t i = 0; i < VALUES_COUNT; i++) {
+                        values[i] = (i % 2 ? -1.0f : 1.0f) * (float)i;
+                }
+
+                /* slots of 16 floats, to go around the rings many times */
+                struct Transducer *processSteps[] = {
+                    filteringTransducer(positiveFloatsOnly, NULL,
+                                        &heapAllocator),
+                    pipelineBoundaryTransducer(2, 64, &heapAllocator),
+                    indexingTransducer(&heapAllocator),
+                    indexRangeTransducer(0, 100, &heapAllocator),
+                    unwrappingTransducer(&heapAllocator),
+                    pipelineBoundaryTransducer(4, 64, &heapAllocator),
+                    mappingTransducer(&accumulator, &heapAllocator),
+                };
+                struct Transducer *process = composingTransducer(
+                    processSteps, sizeof processSteps / sizeof processSteps[0],
+                    &heapAllocator);
+
+                for (int run = 0; run < 2; run++) {
+                        struct Value result = transduceFloatArray(
+                            values, VALUES_COUNT, process, &heapAllocator);
+                        printf("result is: %f ; expected: 10100.0\n",
+                               justFloat(result));
+                }
+
+                /* windows of 32 floats do not fit in slots of 64 bytes */
+                struct Transducer *windowSteps[] = {
+                    partitioningTransducer(32, sizeof(float), &heapAllocator),
+                    pipelineBoundaryTransducer(2, 64, &heapAllocator),
+                    spanReducingTransducer(&accumulator, &heapAllocator),
+                    mappingTransducer(&accumulator, &heapAllocator),
+                };
+                struct Value result = transduceFloatArray(
+                    values, VALUES_COUNT,
+                    composingTransducer(windowSteps,
+                                        sizeof windowSteps /
+                                            sizeof windowSteps[0],
+                                        &heapAllocator),
+                    &heapAllocator);
+                printf("windows: result is: %f ; expected: -500.0\n",
+                       justFloat(result));
+        }
+
+        printf("24. serve many jobs from a work-stealing pool\n");
+        {
+                enum { VALUES_COUNT = 1000, JOBS_COUNT = 66 };
+                float values[VALUES_COUNT];
+                for (size_t i = 0; i < VALUES_COUNT; i++) {
+                        values[i] = (i % 2 ? -1.0f : 1.0f) * (float)i;
+                }
+                struct ValueSpan const input = {
+                    .type_tag = TTAG_FLOAT,
+                    .element_size = sizeof values[0],
+                    .start = (uint8_t const *)values,
+                    .end = (uint8_t const *)(values + VALUES_COUNT),
+                };
+
+                /* combined from parts, and order-dependent */
+                struct Transducer *sumSteps[] = {
+                    filteringTransducer(positiveFloatsOnly, NULL,
+                                        &heapAllocator),
+                    mappingTransducer(&accumulator, &heapAllocator),
+                };
+                struct Transducer *indexSteps[] = {
+                    filteringTransducer(positiveFloatsOnly, NULL,
+                                        &heapAllocator),
+                    indexingTransducer(&heapAllocator),
+                    indexRangeTransducer(0, 100, &heapAllocator),
+                    unwrappingTransducer(&heapAllocator),
+                    mappingTransducer(&accumulator, &heapAllocator),
+                };
+                struct Transducer *processes[3] = {
+                    composingTransducer(sumSteps,
+                                        sizeof sumSteps / sizeof sumSteps[0],
+                                        &heapAllocator),
+                    composingTransducer(
+                        indexSteps, sizeof indexSteps / sizeof indexSteps[0],
+                        &heapAllocator),
+                };
+                /* sums boxed while reducing must last until completion */
+                static struct Reducer boxedAccumulator = {
+                    .identity = accumulateFloatIdentity,
+                    .apply = boxedAccumulateFloatApply,
+                    .combine = boxedAccumulateFloatApply,
+                };
+                struct Transducer *boxedSteps[] = {
+                    filteringTransducer(positiveFloatsOnly, NULL,
+                                        &heapAllocator),
+                    mappingTransducer(&boxedAccumulator, &heapAllocator),
+                };
+                processes[2] = composingTransducer(
+                    boxedSteps, sizeof boxedSteps / sizeof boxedSteps[0],
+                    &heapAllocator);
+                float const expected[] = {249500.0f, 10100.0f, 249500.0f};
+
+                struct Reducer const *sink = idReducer(&heapAllocator);
+
+                struct JobPool *pool = job_pool_start(4, 64, &heapAllocator);
+                struct JobFuture *futures[JOBS_COUNT];
+                for (size_t i = 0; i < JOBS_COUNT; i++) {
+                        futures[i] = job_pool_submit(pool, input,
+                                                     processes[i % 3], sink);
+                }
+                size_t matching = 0;
+                for (size_t i = 0; i < JOBS_COUNT; i++) {
+                        struct Value result = job_future_wait(futures[i]);
+                        matching += justFloat(result) == expected[i % 3];
+                }
+                job_pool_stop(pool);
+
+                printf("jobs matching: %zu ; expected: %d\n", matching,
+                       JOBS_COUNT);
+        }
+
+        printf("25. describe types in a registry\n");
+        {
+                struct TypeDescriptor const impostor = {
+                    .type_tag = TTAG_IndexedValue, .name = "impostor",
+                };
+                bool const again = type_register(&indexedValueType);
+                bool const replaced = type_register(&impostor);
+                printf("registered again: %s, replaced: %s ; expected: yes, "
+                       "no\n",
+                       again ? "yes" : "no", replaced ? "yes" : "no");
+
+                char buffer[64];
+                struct Value indexed = indexValue(
+                    floatValue(3.0f, &heapAllocator), 2, &heapAllocator);
+                value_format(&indexed, buffer, sizeof buffer);
+                printf("formatted: %s ; expected: (2 3.000000)\n", buffer);
+                value_release(&indexed);
+
+                int64_t const ints[] = {4, -7, 12, 3, 9};
+                struct ValueSpan const span = {
+                    .type_tag = TTAG_INT,
+                    .element_size = sizeof ints[0],
+                    .start = (uint8_t const *)ints,
+                    .end = (uint8_t const *)(ints + 5),
+                };
+                struct Reducer *reducers[] = {
+                    typedSumReducer(TTAG_INT, &heapAllocator),
+                    typedMinReducer(TTAG_INT, &heapAllocator),
+                    typedMaxReducer(TTAG_INT, &heapAllocator),
+                };
+                printf("result is:");
+                for (size_t i = 0; i < 3; i++) {
+                        struct Value result =
+                            reducer_identity(reducers[i], &heapAllocator);
+                        result = reducer_apply_batch(reducers[i], span, result,
+                                                     &heapAllocator);
+                        value_format(&result, buffer, sizeof buffer);
+                        printf(" %s", buffer);
+                }
+                printf(" ; expected: 21 -7 12\n");
+
+                static uint8_t bytes[sizeof ints + 1];
+                memcpy(bytes + 1, ints, sizeof ints);
+                struct ValueSpan const misaligned = {
+                    .type_tag = TTAG_INT,
+                    .element_size = sizeof ints[0],
+                    .start = bytes + 1,
+                    .end = bytes + 1 + sizeof ints,
+                };
+                struct Value misalignedSum = reducer_apply_batch(
+                    reducers[0], misaligned,
+                    reducer_identity(reducers[0], &heapAllocator),
+                    &heapAllocator);
+                misalignedSum = reducer_apply(reducers[0], floatImmediate(2.0f),
+                                              misalignedSum, &heapAllocator);
+                value_format(&misalignedSum, buffer, sizeof buffer);
+                printf("misaligned, then a float: %s ; expected: 21\n",
+                       buffer);
+                printf("sum of spans: %s ; expected: none\n",
+                       typedSumReducer(TTAG_SPAN, &heapAllocator) ? "some"
+                                                                  : "none");
+        }
+
+        printf("26. track the memory used by a pipeline\n");
+        {
+                struct TrackingAllocator tracker;
+                tracking_init(&tracker, &heapAllocator);
+                struct AllocationSite building = {.name = "building"};
+                struct AllocationSite running = {.name = "running"};
+
+                tracking_set_site(&building);
+                struct Transducer *processSteps[] = {
+                    filteringTransducer(positiveFloatsOnly, NULL,
+                                        &tracker.super),
+                    mappingTransducer(indexingReducer(&tracker.super),
+                                      &tracker.super),
+                    mappingFnTransducer(unwrapIndexedValue, NULL,
+                                        &tracker.super),
+                    mappingTransducer(&accumulator, &tracker.super),
+                };
+                struct Transducer *process = composingTransducer(
+                    processSteps, sizeof processSteps / sizeof processSteps[0],
+                    &tracker.super);
+
+                /* the indexed values boxed on the way are never freed */
+                tracking_set_site(&running);
+                float const values[] = {-1.0f, 1.0f,  -2.0f, 2.0f,
+                                        3.0f,  -3.0f, 4.0f,  -4.0f};
+                struct Value result = transduceFloatArray(
+                    values, sizeof values / sizeof values[0], process,
+                    &tracker.super);
+                tracking_set_site(NULL);
+
+                printf("result is: %f ; expected: 10.0\n", justFloat(result));
+                printf("%s: %zu allocations, %s: %zu allocations ; "
+                       "expected: building: 6 allocations, running: 6 "
+                       "allocations\n",
+                       building.name, atomic_load(&building.allocations),
+                       running.name, atomic_load(&running.allocations));
+                printf("running leaked all: %s ; expected: yes\n",
+                       atomic_load(&running.liveBytes) ==
+                               atomic_load(&running.bytes)
+                           ? "yes"
+                           : "no");
+                printf("peak covers live: %s ; expected: yes\n",
+                       atomic_load(&tracker.peakBytes) >=
+                               atomic_load(&tracker.liveBytes)
+                           ? "yes"
+                           : "no");
+
+                /* sinks grow by reallocation, from nothing */
+                struct BufferSink sink;
+                bufferSinkInit(&sink, &tracker.super);
+                struct Reducer *collect = transducer_apply(
+                    processSteps[0], &sink.super, &tracker.super);
+                struct AllocationSite collecting = {.name = "collecting"};
+                tracking_set_site(&collecting);
+                struct ValueStreamRange valuesRange;
+                floatArrayVSR(&valuesRange, values,
+                              sizeof values / sizeof values[0]);
+                reduceStream(&valuesRange, collect, &tracker.super);
+                size_t const collected = sink.count;
+                bufferSinkRelease(&sink);
+
+                uint8_t *aligned = allocator_alloc_aligned(&tracker.super, 16,
+                                                           64);
+                memset(aligned, 7, 16);
+                aligned = allocator_realloc(&tracker.super, aligned, 16, 256);
+                bool const keptAlignment =
+                    (uintptr_t)aligned % 64 == 0 && aligned[15] == 7;
+                allocator_free(&tracker.super, aligned);
+                tracking_set_site(NULL);
+
+                printf("collected %zu, aligned: %s, %zu live bytes ; "
+                       "expected: collected 4, aligned: yes, 0 live "
+                       "bytes\n",
+                       collected, keptAlignment ? "yes" : "no",
+                       atomic_load(&collecting.liveBytes));
+        }
+
+        printf("27. decode streams of encoded blocks\n");
+        {
+                enum { VALUES_COUNT = 1000, BLOCK_COUNT = 256 };
+                float values[VALUES_COUNT];
+                for (size_t i = 0; i < VALUES_COUNT; i++) {
+                        values[i] = (float)(i % 7) - 3.0f;
+                }
+
+                enum BlockEncoding const encodings[] = {BE_FloatDelta,
+                                                        BE_FloatXor};
+                char const *names[] = {"delta", "xor"};
+                for (size_t e = 0; e < 2; e++) {
+                        uint8_t *encoded = allocator_alloc(
+                            &heapAllocator,
+                            (VALUES_COUNT / BLOCK_COUNT + 1) *
+                                floatBlockBound(BLOCK_COUNT));
+                        size_t size = 0;
+                        for (size_t i = 0; i < VALUES_COUNT;
+                             i += BLOCK_COUNT) {
+                                size_t const n = VALUES_COUNT - i < BLOCK_COUNT
+                                                     ? VALUES_COUNT - i
+                                                     : BLOCK_COUNT;
+                                size += floatBlockEncode(encodings[e],
+                                                         values + i, n,
+                                                         encoded + size);
+                        }
+
+                        struct ChunkedStream chunks;
+                        chunkedStream(&chunks, encoded, size, 7);
+                        struct BlockDecoderStream stream;
+                        floatBlocksVSR(&stream, &chunks.range, encodings[e],
+                                       &heapAllocator);
+                        struct Value result = reduceStream(
+                            &stream.range, &accumulator, &heapAllocator);
+                        printf("%s: result is: %f, decoded in %zu bytes ; "
+                               "expected: -3.0, decoded in 1024 bytes\n",
+                               names[e], justFloat(result),
+                               stream.decodedCapacity);
+                        closeBlockDecoderVSR(&stream);
+                        allocator_free(&heapAllocator, encoded);
+                }
+
+                /* a frame of linked blocks, the second one repeating the
+                 * floats of the first */
+                uint8_t frame[128];
+                size_t size = 0;
+                uint8_t const header[] = {0x04, 0x22, 0x4D, 0x18,
+                                          0x40, 0x40, 0x00};
+                memcpy(frame, header, sizeof header);
+                size += sizeof header;
+                float const floats[] = {1.0f, 2.0f, 3.0f, 4.0f};
+                size_t const literalsSize = sizeof floats;
+
+                uint8_t const uncompressed[] = {literalsSize, 0, 0, 0x80};
+                memcpy(frame + size, uncompressed, sizeof uncompressed);
+                size += sizeof uncompressed;
+                memcpy(frame + size, floats, literalsSize);
+                size += literalsSize;
+
+                /* a match of 15 + 15 * 255 + 220 + 4 bytes at offset 16,
+                 * then the literals */
+                uint8_t block[64];
+                size_t blockSize = 0;
+                block[blockSize++] = 0x0F;
+                block[blockSize++] = literalsSize;
+                block[blockSize++] = 0;
+                for (size_t i = 0; i < 15; i++) {
+                        block[blockSize++] = 255;
+                }
+                block[blockSize++] = 220;
+                block[blockSize++] = 0xF0;
+                block[blockSize++] = literalsSize - 15;
+                memcpy(block + blockSize, floats, literalsSize);
+                blockSize += literalsSize;
+
+                uint8_t const compressed[] = {(uint8_t)blockSize, 0, 0, 0};
+                memcpy(frame + size, compressed, sizeof compressed);
+                size += sizeof compressed;
+                memcpy(frame + size, block, blockSize);
+                size += blockSize;
+                uint8_t const endMark[] = {0, 0, 0, 0};
+                memcpy(frame + size, endMark, sizeof endMark);
+                size += sizeof endMark;
+
+                struct ChunkedStream chunks;
+                chunkedStream(&chunks, frame, size, 5);
+                struct BlockDecoderStream stream;
+                lz4FrameVSR(&stream, &chunks.range, TTAG_FLOAT, sizeof(float),
+                            &heapAllocator);
+                struct Value result =
+                    reduceStream(&stream.range, &accumulator, &heapAllocator);
+                printf("lz4: result is: %f, error: %s ; expected: 2560.0, "
+                       "error: read past end\n",
+                       justFloat(result),
+                       stream.range.error == S_ReadPastEnd ? "read past end"
+                                                           : "other");
+                closeBlockDecoderVSR(&stream);
+
+                /* the match reaching before the first block */
+                size_t const offsetAt = sizeof header + sizeof uncompressed +
+                                        literalsSize + sizeof compressed + 1;
+                frame[offsetAt] = 2 * literalsSize;
+                chunkedStream(&chunks, frame, size, 5);
+                lz4FrameVSR(&stream, &chunks.range, TTAG_FLOAT, sizeof(float),
+                            &heapAllocator);
+                result =
+                    reduceStream(&stream.range, &accumulator, &heapAllocator);
+                printf("lz4 reaching past the frame: %f, error: %s ; "
+                       "expected: 10.0, error: io\n",
+                       justFloat(result),
+                       stream.range.error == S_IOError ? "io" : "other");
+                closeBlockDecoderVSR(&stream);
+        }
+
+#if defined(MAIN_HAS_SOCKETS)
+        printf("28. receive values from a socket\n");
+        {
+                float values[1000];
+                size_t const valuesCount = sizeof values / sizeof values[0];
+                for (size_t i = 0; i < valuesCount; i++) {
+                        values[i] = (float)(i % 7);
+                }
+
+                /* everything is sent before receiving, which fits the
+                 * socket buffers */
+                int fds[2];
+                if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0 ||
+                    write(fds[0], values, sizeof values) !=
+                        (ssize_t)sizeof values) {
+                        printf("could not send values\n");
+                        return 1;
+                }
+                shutdown(fds[0], SHUT_WR);
+
+                struct SocketStream socket;
+                stream_on_socket(&socket, fds[1], 4, 256, &heapAllocator);
+                struct ByteValueStream view;
+                byteStreamVSR(&view, &socket.range, TTAG_FLOAT, sizeof(float),
+                              _Alignof(float));
+                struct Value result =
+                    reduceStream(&view.range, &accumulator, &heapAllocator);
+                printf("result is: %f, copied %zu bytes, %zu receives ; "
+                       "expected: 2997.0, copied 0 bytes, 5 receives\n",
+                       justFloat(result), view.copiedBytes,
+                       socket.receiveCalls);
+
+                stream_close_socket(&socket);
+                close(fds[0]);
+                close(fds[1]);
+        }
+#endif
+
+        printf("29. push values into a reduction as they arrive\n");
+        {
+                struct Transducer *processSteps[] = {
+                    filteringTransducer(positiveFloatsOnly, NULL,
+                                        &heapAllocator),
+                    mappingTransducer(&accumulator, &heapAllocator),
+                };
+                struct Transducer *process = composingTransducer(
+                    processSteps, sizeof processSteps / sizeof processSteps[0],
+                    &heapAllocator);
+                struct Reducer *reducer = transducer_apply(
+                    process, idReducer(&heapAllocator), &heapAllocator);
+
+                /* the running total carries over from chunk to chunk */
+                float const chunks[][4] = {{-1.0f, 1.0f, -2.0f, 2.0f},
+                                           {3.0f, -3.0f, 4.0f, -4.0f}};
+                struct ReductionSession session;
+                reduction_start(&session, reducer, &heapAllocator);
+                printf("results are:");
+                for (size_t i = 0; i < 2; i++) {
+                        reduction_push_span(
+                            &session,
+                            (struct ValueSpan){
+                                .type_tag = TTAG_FLOAT,
+                                .element_size = sizeof(float),
+                                .start = (uint8_t const *)chunks[i],
+                                .end = (uint8_t const *)(chunks[i] + 4),
+                            });
+                        printf(" %f", justFloat(reduction_current(&session)));
+                }
+                reduction_push(&session, floatValue(5.0f, &heapAllocator));
+                struct Value result = reduction_complete(&session);
+                printf(" %f ; expected: 3.0 10.0 15.0\n", justFloat(result));
+        }
+
+        printf("30. aggregate values by key\n");
+        {
+                float values[1000];
+                size_t const valuesCount = sizeof values / sizeof values[0];
+                for (size_t i = 0; i < valuesCount; i++) {
+                        values[i] = (float)(i % 100);
+                }
+
+                struct Transducer *byKey = groupingTransducer(
+                    floatModFour, NULL, &accumulator, &heapAllocator);
+                float const firstValues[] = {1.0f, 2.0f, 5.0f, 6.0f, 9.0f};
+                printf("groups: ");
+                {
+                        struct Reducer *reducer = transducer_apply(
+                            byKey, printReducer(&heapAllocator),
+                            &heapAllocator);
+                        struct ValueStreamRange valuesRange;
+                        floatArrayVSR(&valuesRange, firstValues,
+                                      sizeof firstValues /
+                                          sizeof firstValues[0]);
+                        reduceStream(&valuesRange, reducer, &heapAllocator);
+                }
+                printf("expected: [1: 15.000000, 2: 8.000000] in any "
+                       "order\n");
+
+                /* the tables of the workers are merged */
+                struct Transducer *all = filteringTransducer(
+                    positiveFloatsOnly, NULL, &heapAllocator);
+                struct Reducer *sums = groupingReducer(
+                    floatModFour, NULL, &accumulator, &heapAllocator);
+                struct ValueSpan const input = {
+                    .type_tag = TTAG_FLOAT,
+                    .element_size = sizeof values[0],
+                    .start = (uint8_t const *)values,
+                    .end = (uint8_t const *)(values + valuesCount),
+                };
+                for (size_t workers = 1; workers <= 4; workers *= 3) {
+                        struct Value groups = transduce_parallel(
+                            input, all, sums, workers, &heapAllocator);
+                        printf("%zu workers, %zu keys:", workers,
+                               groups_count(&groups));
+                        for (uint64_t key = 0; key < 4; key++) {
+                                struct KeyedValue const *sum =
+                                    groups_find(&groups, key);
+                                printf(" %f", sum ? justFloat(sum->value)
+                                                  : 0.0f);
+                        }
+                        printf(" ; expected: 4 keys: 12000.0 12250.0 "
+                               "12500.0 12750.0\n");
+                        value_release(&groups);
+                }
+
+                /* boxed results are released with their table */
+                struct TrackingAllocator tracker;
+                tracking_init(&tracker, &heapAllocator);
+                static struct Reducer boxedSum = {
+                    .identity = accumulateFloatIdentity,
+                    .apply = movingAccumulateFloatApply,
+                };
+                struct Reducer *boxedSums = groupingReducer(
+                    floatModFour, NULL, &boxedSum, &heapAllocator);
+                struct Value groups =
+                    reducer_identity(boxedSums, &tracker.super);
+                groups = reducer_apply_batch(boxedSums, input, groups,
+                                             &tracker.super);
+                groups = reducer_complete(boxedSums, groups, &tracker.super);
+                struct Value copy = value_copy(&groups, &tracker.super);
+                value_release(&groups);
+                struct KeyedValue const *copied = groups_find(&copy, 3);
+                printf("boxed: %f", copied ? justFloat(copied->value) : 0.0f);
+                value_release(&copy);
+                printf(", %zu live bytes ; expected: 12750.0, 0 live bytes\n",
+                       atomic_load(&tracker.liveBytes));
+        }
+
         return 0;
 }
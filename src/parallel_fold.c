@@ -0,0 +1,133 @@
+#include "parallel_fold.h"
+#include "chain_builder.h"
+#include "transducer_types.h"
+#include "transducers.h"
+
+#include "allocator.h"
+
+#include <pthread.h>
+
+struct FoldTask
+{
+        struct Reducer *reducer;
+        struct ValueSpan chunk;
+        struct Allocator *allocator;
+        struct Value result;
+};
+
+static void *foldTaskRun(void *data)
+{
+        struct FoldTask *task = data;
+
+        struct Value const identity =
+            reducer_identity(task->reducer, task->allocator);
+        task->result = reducer_apply_batch(task->reducer, task->chunk,
+                                           identity, task->allocator);
+
+        return NULL;
+}
+
+static struct Value transduceSequentially(struct ValueSpan const input,
+                                          struct Reducer *reducer,
+                                          struct Allocator *allocator)
+{
+        struct Value result = reducer_identity(reducer, allocator);
+        result = reducer_apply_batch(reducer, input, result, allocator);
+        return reducer_complete(reducer, unreduced(result), allocator);
+}
+
+struct Value transduce_parallel(struct ValueSpan const input,
+                                struct Transducer *transducer,
+                                struct Reducer const *step,
+                                size_t workersCount,
+                                struct Allocator *allocator)
+{
+        struct ChainBuilder const builder =
+            chainBuilderMake(transducer, step, allocator);
+        size_t const count = valueSpanCount(&input);
+        if (workersCount > count) {
+                workersCount = count > 0 ? count : 1;
+        }
+
+        /* the chains of all workers, in one block */
+        uint8_t *chains =
+            allocator_alloc(allocator, workersCount * builder.chainSize);
+        struct Reducer *first = chain_builder_build(&builder, chains);
+        if (!first) {
+                /* the chain did not fit its block, built outside of it */
+                allocator_free(allocator, chains);
+                return transduceSequentially(
+                    input, transducer_apply(transducer, step, allocator),
+                    allocator);
+        }
+        if (!first->combine || workersCount < 2) {
+                struct Value const result =
+                    transduceSequentially(input, first, allocator);
+                allocator_free(allocator, chains);
+                return result;
+        }
+
+        struct FoldTask *tasks =
+            allocator_alloc(allocator, workersCount * sizeof *tasks);
+        pthread_t *threads =
+            allocator_alloc(allocator, workersCount * sizeof *threads);
+
+        uint8_t const *chunkStart = input.start;
+        for (size_t i = 0; i < workersCount; i++) {
+                size_t const chunkCount =
+                    count / workersCount + (i < count % workersCount);
+                uint8_t const *chunkEnd =
+                    chunkStart + chunkCount * input.element_size;
+
+                struct Reducer *reducer =
+                    i == 0 ? first
+                           : chain_builder_build(
+                                 &builder, chains + i * builder.chainSize);
+                tasks[i] = (struct FoldTask){
+                    .reducer = reducer,
+                    .chunk =
+                        (struct ValueSpan){
+                            .type_tag = input.type_tag,
+                            .element_size = input.element_size,
+                            .start = chunkStart,
+                            .end = chunkEnd,
+                        },
+                    .allocator = allocator,
+                };
+                chunkStart = chunkEnd;
+        }
+
+        size_t started = 1;
+        for (; started < workersCount; started++) {
+                if (pthread_create(&threads[started], NULL, foldTaskRun,
+                                   &tasks[started]) != 0) {
+                        break;
+                }
+        }
+        /* chunks that could not get a thread run here */
+        for (size_t i = started; i < workersCount; i++) {
+                foldTaskRun(&tasks[i]);
+        }
+        foldTaskRun(&tasks[0]);
+        for (size_t i = 1; i < started; i++) {
+                pthread_join(threads[i], NULL);
+        }
+
+        struct Value result = tasks[0].result;
+        for (size_t i = 1; i < workersCount && !isReduced(&result); i++) {
+                struct Value const right = tasks[i].result;
+                result = reducer_combine(first, result, unreduced(right),
+                                         allocator);
+                if (isReduced(&right)) {
+                        result = reduced(result);
+                }
+        }
+
+        result = reducer_complete(first, unreduced(result), allocator);
+
+        allocator_free(allocator, threads);
+        allocator_free(allocator, tasks);
+        allocator_free(allocator, chains);
+
+        return result;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+/**
+ * @file
+ * Data-parallel reduction of in-memory inputs.
+ */
+
+struct Allocator;
+struct Reducer;
+struct Transducer;
+struct ValueSpan;
+
+#include "values.h"
+
+#include <stddef.h>
+
+/**
+ * transduces input with transducer into step, using up to workersCount
+ * threads.
+ *
+ * The input is cut into one chunk per worker, and each worker runs its own
+ * instance of the chain (see chain_builder.h), all instances sharing one
+ * allocation. Partial results are merged in input order with
+ * reducer_combine, then completed once.
+ *
+ * The chains are released before returning, so the result must not borrow
+ * memory from them, as a boxed identity value would.
+ *
+ * A chunk that ends reduced hides the results of the chunks after it.
+ *
+ * Chains without a combine function are reduced sequentially. The
+ * allocator must be safe to use from several threads if the chain
+ * allocates while reducing.
+ */
+struct Value transduce_parallel(struct ValueSpan input,
+                                struct Transducer *transducer,
+                                struct Reducer const *step,
+                                size_t workersCount,
+                                struct Allocator *allocator);
@@ -0,0 +1,629 @@
+#include "pipeline_parallel.h"
+#include "transducer_types.h"
+#include "transducers.h"
+
+#include "alignment.h"
+#include "allocator.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <string.h>
+
+/// times a side checks the ring before going to sleep
+enum { BOUNDARY_SPINS = 1024 };
+
+enum HandoffKind {
+        /// count elements gathered into a span sent down as one batch
+        HK_Elements,
+        /// count values handed over as they came
+        HK_Values,
+        /// one TTAG_SPAN value
+        HK_Span,
+        /// one TTAG_BATCH value
+        HK_Batch,
+        /// no more values
+        HK_End,
+};
+
+struct HandoffSlot
+{
+        enum HandoffKind kind;
+        uint32_t type_tag;
+        size_t element_size;
+        size_t count;
+        struct ValueSpan span;
+        struct ValueBatch batch;
+        uint8_t *storage;
+        /// block from the allocator for contents larger than a slot, given
+        /// back once consumed
+        uint8_t *external;
+};
+
+struct PipelineBoundaryTransducer
+{
+        struct Transducer super;
+        size_t slotsCount;
+        size_t slotSize;
+};
+
+struct PipelineBoundaryReducer
+{
+        struct ChainedReducer super;
+        struct PipelineBoundaryTransducer const *params;
+
+        /* set when the segment starts, then only touched by the consumer
+         * until it is joined */
+        struct Allocator *allocator;
+        struct Value current;
+
+        pthread_t thread;
+        bool started;
+        /// no thread could be started, slots are consumed as published
+        bool inlined;
+
+        /* producer side */
+        size_t produced;
+        struct HandoffSlot *filling;
+
+        /* the indices are kept on cache lines of their own */
+        char padding0[CACHE_LINE_SIZE];
+        atomic_size_t published;
+        char padding1[CACHE_LINE_SIZE - sizeof(atomic_size_t)];
+        atomic_size_t consumed;
+        atomic_bool halted;
+        char padding2[CACHE_LINE_SIZE];
+
+        /* a side finding the ring full or empty for long sleeps until the
+         * other moves its index */
+        atomic_size_t sleeping;
+        pthread_mutex_t mutex;
+        pthread_cond_t moved;
+
+        struct HandoffSlot slots[];
+};
+
+static size_t boundaryHeaderSize(struct PipelineBoundaryTransducer const *p)
+{
+        return alignUp(sizeof(struct PipelineBoundaryReducer) +
+                       p->slotsCount * sizeof(struct HandoffSlot));
+}
+
+/* waiting */
+
+/// @return index once it differs from value
+static size_t boundaryWait(struct PipelineBoundaryReducer *self,
+                           atomic_size_t *index, size_t const value)
+{
+        for (size_t i = 0; i < BOUNDARY_SPINS; i++) {
+                size_t const current =
+                    atomic_load_explicit(index, memory_order_acquire);
+                if (current != value) {
+                        return current;
+                }
+        }
+
+        pthread_mutex_lock(&self->mutex);
+        atomic_fetch_add(&self->sleeping, 1);
+        size_t current;
+        while ((current = atomic_load(index)) == value) {
+                pthread_cond_wait(&self->moved, &self->mutex);
+        }
+        atomic_fetch_sub(&self->sleeping, 1);
+        pthread_mutex_unlock(&self->mutex);
+
+        return current;
+}
+
+/// to call after moving an index
+static void boundaryWake(struct PipelineBoundaryReducer *self)
+{
+        /* orders the index before sleeping, as boundaryWait() does */
+        atomic_thread_fence(memory_order_seq_cst);
+        if (atomic_load_explicit(&self->sleeping, memory_order_relaxed)) {
+                pthread_mutex_lock(&self->mutex);
+                pthread_cond_broadcast(&self->moved);
+                pthread_mutex_unlock(&self->mutex);
+        }
+}
+
+/* consumer side */
+
+static uint8_t *slotData(struct HandoffSlot const *slot)
+{
+        return slot->external ? slot->external : slot->storage;
+}
+
+static bool applySlot(struct PipelineBoundaryReducer *self,
+                      struct HandoffSlot *slot)
+{
+        if (slot->kind == HK_End) {
+                return true;
+        }
+        if (atomic_load_explicit(&self->halted, memory_order_relaxed)) {
+                return false;
+        }
+
+        struct Reducer const *step = self->super.step;
+        struct Value current = self->current;
+
+        switch (slot->kind) {
+        case HK_Elements: {
+                struct ValueSpan const span = {
+                    .type_tag = slot->type_tag,
+                    .element_size = slot->element_size,
+                    .start = slotData(slot),
+                    .end = slotData(slot) + slot->count * slot->element_size,
+                };
+                current = reducer_apply_batch(step, span, current,
+                                              self->allocator);
+                break;
+        }
+        case HK_Values: {
+                struct Value const *values = (void const *)slot->storage;
+                for (size_t i = 0; i < slot->count && !isReduced(&current);
+                     i++) {
+                        current = reducer_apply(step, values[i], current,
+                                                self->allocator);
+                }
+                break;
+        }
+        case HK_Span:
+                current = reducer_apply(step, spanValue(&slot->span), current,
+                                        self->allocator);
+                break;
+        case HK_Batch:
+                current = reducer_apply(step, batchValue(&slot->batch),
+                                        current, self->allocator);
+                break;
+        case HK_End:
+                break;
+        }
+
+        self->current = current;
+        if (isReduced(&current)) {
+                atomic_store_explicit(&self->halted, true,
+                                      memory_order_relaxed);
+        }
+
+        return false;
+}
+
+/// @return true for the end slot
+static bool consumeSlot(struct PipelineBoundaryReducer *self,
+                        struct HandoffSlot *slot)
+{
+        bool const end = applySlot(self, slot);
+        if (slot->external) {
+                allocator_free(self->allocator, slot->external);
+                slot->external = NULL;
+        }
+
+        return end;
+}
+
+static void *boundaryRun(void *data)
+{
+        struct PipelineBoundaryReducer *self = data;
+        size_t const slotsCount = self->params->slotsCount;
+
+        for (size_t consumed = 0;; consumed++) {
+                boundaryWait(self, &self->published, consumed);
+
+                bool const end =
+                    consumeSlot(self, &self->slots[consumed % slotsCount]);
+                atomic_store_explicit(&self->consumed, consumed + 1,
+                                      memory_order_release);
+                boundaryWake(self);
+                if (end) {
+                        break;
+                }
+        }
+
+        return NULL;
+}
+
+/* producer side */
+
+static void boundaryStart(struct PipelineBoundaryReducer *self,
+                          struct Value current, struct Allocator *allocator)
+{
+        self->started = true;
+        self->allocator = allocator;
+        self->current = current;
+        self->inlined =
+            pthread_create(&self->thread, NULL, boundaryRun, self) != 0;
+}
+
+/// waits for the consumer to free a slot when all are published
+static void boundaryWaitRoom(struct PipelineBoundaryReducer *self)
+{
+        size_t const slotsCount = self->params->slotsCount;
+        if (self->produced >= slotsCount) {
+                boundaryWait(self, &self->consumed,
+                             self->produced - slotsCount);
+        }
+}
+
+/// slot being filled, NULL once the stages after the boundary halted
+static struct HandoffSlot *fillingSlot(struct PipelineBoundaryReducer *self)
+{
+        if (self->filling) {
+                return self->filling;
+        }
+
+        size_t const slotsCount = self->params->slotsCount;
+        boundaryWaitRoom(self);
+        if (atomic_load_explicit(&self->halted, memory_order_relaxed)) {
+                return NULL;
+        }
+
+        struct HandoffSlot *slot =
+            &self->slots[self->produced % slotsCount];
+        slot->count = 0;
+        slot->external = NULL;
+        self->filling = slot;
+
+        return slot;
+}
+
+/**
+ * storage for size bytes of slot, the block of the slot or when too small
+ * one from the allocator.
+ *
+ * @return NULL when out of memory
+ */
+static uint8_t *reserveSlot(struct PipelineBoundaryReducer *self,
+                            struct HandoffSlot *slot, size_t const size)
+{
+        if (size <= self->params->slotSize) {
+                return slot->storage;
+        }
+
+        slot->external = allocator_alloc(self->allocator, size);
+        return slot->external;
+}
+
+static void publishSlot(struct PipelineBoundaryReducer *self)
+{
+        struct HandoffSlot *slot = self->filling;
+
+        self->filling = NULL;
+        self->produced++;
+        atomic_store_explicit(&self->published, self->produced,
+                              memory_order_release);
+
+        if (self->inlined) {
+                consumeSlot(self, slot);
+                atomic_store_explicit(&self->consumed, self->produced,
+                                      memory_order_relaxed);
+        } else {
+                boundaryWake(self);
+        }
+}
+
+/// slot holding nothing yet, publishing the slot being filled if needed
+static struct HandoffSlot *emptySlot(struct PipelineBoundaryReducer *self)
+{
+        if (self->filling && self->filling->count > 0) {
+                publishSlot(self);
+        }
+
+        return fillingSlot(self);
+}
+
+static bool handOverElements(struct PipelineBoundaryReducer *self,
+                             struct ValueSpan span)
+{
+        size_t const elementSize = span.element_size;
+        size_t const capacity = self->params->slotSize / elementSize;
+        if (capacity == 0) {
+                /* elements larger than a slot go together outside of it */
+                struct HandoffSlot *slot = emptySlot(self);
+                size_t const size = (size_t)(span.end - span.start);
+                uint8_t *storage = slot ? reserveSlot(self, slot, size) : NULL;
+                if (!storage) {
+                        return false;
+                }
+
+                memcpy(storage, span.start, size);
+                slot->kind = HK_Elements;
+                slot->type_tag = span.type_tag;
+                slot->element_size = elementSize;
+                slot->count = size / elementSize;
+                publishSlot(self);
+                return true;
+        }
+
+        for (uint8_t const *element = span.start; element < span.end;) {
+                struct HandoffSlot *slot = fillingSlot(self);
+                if (slot && slot->count > 0 &&
+                    (slot->kind != HK_Elements ||
+                     slot->type_tag != span.type_tag ||
+                     slot->element_size != elementSize)) {
+                        slot = emptySlot(self);
+                }
+                if (!slot) {
+                        return false;
+                }
+                if (slot->count == 0) {
+                        slot->kind = HK_Elements;
+                        slot->type_tag = span.type_tag;
+                        slot->element_size = elementSize;
+                }
+
+                size_t n = (size_t)(span.end - element) / elementSize;
+                if (n > capacity - slot->count) {
+                        n = capacity - slot->count;
+                }
+                memcpy(slot->storage + slot->count * elementSize, element,
+                       n * elementSize);
+                slot->count += n;
+                element += n * elementSize;
+
+                if (slot->count == capacity) {
+                        publishSlot(self);
+                }
+        }
+
+        return true;
+}
+
+static bool handOverValue(struct PipelineBoundaryReducer *self,
+                          struct Value input)
+{
+        size_t const capacity =
+            self->params->slotSize / sizeof(struct Value);
+
+        struct HandoffSlot *slot = fillingSlot(self);
+        if (slot && slot->count > 0 && slot->kind != HK_Values) {
+                slot = emptySlot(self);
+        }
+        if (!slot) {
+                return false;
+        }
+
+        slot->kind = HK_Values;
+        ((struct Value *)slot->storage)[slot->count++] = input;
+        if (slot->count == capacity) {
+                publishSlot(self);
+        }
+
+        return true;
+}
+
+static bool handOverSpan(struct PipelineBoundaryReducer *self,
+                         struct ValueSpan span)
+{
+        size_t const size = (size_t)(span.end - span.start);
+
+        /* spans, windows for instance, are not split */
+        struct HandoffSlot *slot = emptySlot(self);
+        uint8_t *storage = slot ? reserveSlot(self, slot, size) : NULL;
+        if (!storage) {
+                return false;
+        }
+
+        memcpy(storage, span.start, size);
+        slot->kind = HK_Span;
+        slot->span = span;
+        slot->span.start = storage;
+        slot->span.end = storage + size;
+        slot->count = 1;
+        publishSlot(self);
+
+        return true;
+}
+
+static bool handOverBatch(struct PipelineBoundaryReducer *self,
+                          struct ValueBatch batch)
+{
+        size_t const elementSize = batch.values.element_size;
+        size_t const count = valueBatchCount(&batch);
+        size_t capacity = (self->params->slotSize - _Alignof(max_align_t)) /
+                          (elementSize + sizeof(size_t) + 1);
+        if (capacity == 0) {
+                /* elements larger than a slot go together outside of it */
+                capacity = count;
+        }
+
+        for (size_t start = 0; start < count;) {
+                size_t const n =
+                    count - start < capacity ? count - start : capacity;
+                struct HandoffSlot *slot = emptySlot(self);
+                uint8_t *values =
+                    slot ? reserveSlot(self, slot,
+                                       alignUp(n * elementSize) +
+                                           n * (sizeof(size_t) + 1))
+                         : NULL;
+                if (!values) {
+                        return false;
+                }
+
+                size_t *indices = (size_t *)(values + alignUp(n * elementSize));
+                uint8_t *validity = (uint8_t *)(indices + n);
+
+                memcpy(values, batch.values.start + start * elementSize,
+                       n * elementSize);
+                slot->batch = (struct ValueBatch){
+                    .values =
+                        {
+                            .type_tag = batch.values.type_tag,
+                            .element_size = elementSize,
+                            .start = values,
+                            .end = values + n * elementSize,
+                        },
+                };
+                if (batch.indices) {
+                        memcpy(indices, batch.indices + start,
+                               n * sizeof *indices);
+                        slot->batch.indices = indices;
+                }
+                if (batch.validity) {
+                        memcpy(validity, batch.validity + start, n);
+                        slot->batch.validity = validity;
+                }
+                slot->kind = HK_Batch;
+                slot->count = n;
+                publishSlot(self);
+                start += n;
+        }
+
+        return true;
+}
+
+static struct Value boundaryReducerApply(struct Reducer const *reducer,
+                                         struct Value input,
+                                         struct Value current,
+                                         struct Allocator *allocator)
+{
+        struct PipelineBoundaryReducer *self =
+            (struct PipelineBoundaryReducer *)reducer;
+
+        if (!self->started) {
+                boundaryStart(self, current, allocator);
+        }
+
+        bool handedOver;
+        if (isImmediate(&input)) {
+                struct ValueSpan const span = {
+                    .type_tag = input.type_tag,
+                    .element_size = input.element_size,
+                    .start = (uint8_t const *)&input.immediate,
+                    .end = (uint8_t const *)&input.immediate +
+                           input.element_size,
+                };
+                handedOver = handOverElements(self, span);
+        } else if (input.type_tag == TTAG_SPAN) {
+                handedOver = handOverSpan(self, valueSpan(&input));
+        } else if (input.type_tag == TTAG_BATCH) {
+                handedOver = handOverBatch(self, valueBatch(&input));
+        } else {
+                handedOver = handOverValue(self, input);
+        }
+
+        return handedOver ? current : reduced(current);
+}
+
+static struct Value boundaryReducerApplyBatch(struct Reducer const *reducer,
+                                              struct ValueSpan span,
+                                              struct Value current,
+                                              struct Allocator *allocator)
+{
+        struct PipelineBoundaryReducer *self =
+            (struct PipelineBoundaryReducer *)reducer;
+
+        if (!self->started) {
+                boundaryStart(self, current, allocator);
+        }
+
+        return handOverElements(self, span) ? current : reduced(current);
+}
+
+static struct Value boundaryReducerComplete(struct Reducer const *reducer,
+                                            struct Value result,
+                                            struct Allocator *allocator)
+{
+        struct PipelineBoundaryReducer *self =
+            (struct PipelineBoundaryReducer *)reducer;
+
+        if (self->started) {
+                /* the end slot is handed over even past a halt, for the
+                 * consumer to stop */
+                if (self->filling && self->filling->count > 0) {
+                        publishSlot(self);
+                }
+                size_t const slotsCount = self->params->slotsCount;
+                boundaryWaitRoom(self);
+                self->filling = &self->slots[self->produced % slotsCount];
+                self->filling->kind = HK_End;
+                self->filling->external = NULL;
+                publishSlot(self);
+
+                if (!self->inlined) {
+                        pthread_join(self->thread, NULL);
+                }
+                result = unreduced(self->current);
+
+                /* ready for another run */
+                self->started = false;
+                self->produced = 0;
+                atomic_store(&self->published, 0);
+                atomic_store(&self->consumed, 0);
+                atomic_store(&self->halted, false);
+        }
+
+        return reducer_complete(self->super.step, result, allocator);
+}
+
+static size_t boundaryTransducerSize(struct Transducer const *transducer)
+{
+        struct PipelineBoundaryTransducer const *self =
+            (struct PipelineBoundaryTransducer const *)transducer;
+
+        return boundaryHeaderSize(self) + self->slotsCount * self->slotSize;
+}
+
+static struct Reducer *boundaryTransducerApply(struct Transducer *transducer,
+                                               struct Reducer const *step,
+                                               struct Allocator *allocator)
+{
+        struct PipelineBoundaryTransducer *self =
+            (struct PipelineBoundaryTransducer *)transducer;
+        struct PipelineBoundaryReducer *result =
+            allocator_alloc(allocator, boundaryTransducerSize(transducer));
+
+        *result = (struct PipelineBoundaryReducer){
+            .super = chainedReducerMake(step, boundaryReducerApply),
+            .params = self,
+        };
+        result->super.super.complete = boundaryReducerComplete;
+        result->super.super.apply_batch = boundaryReducerApplyBatch;
+        /* values are handed over untouched */
+        result->super.super.properties = step->properties;
+        /* each run owns a thread and its ring */
+        result->super.super.combine = NULL;
+        atomic_init(&result->published, 0);
+        atomic_init(&result->consumed, 0);
+        atomic_init(&result->halted, false);
+        atomic_init(&result->sleeping, 0);
+        pthread_mutex_init(&result->mutex, NULL);
+        pthread_cond_init(&result->moved, NULL);
+
+        uint8_t *storage = (uint8_t *)result + boundaryHeaderSize(self);
+        for (size_t i = 0; i < self->slotsCount; i++) {
+                result->slots[i] = (struct HandoffSlot){
+                    .storage = storage + i * self->slotSize,
+                };
+        }
+
+        return &result->super.super;
+}
+
+struct Transducer *pipelineBoundaryTransducer(size_t slotsCount,
+                                              size_t slotSize,
+                                              struct Allocator *allocator)
+{
+        struct PipelineBoundaryTransducer *result =
+            allocator_alloc(allocator, sizeof *result);
+
+        if (slotsCount < 2) {
+                slotsCount = 2;
+        }
+        /* keep every slot aligned for any element type */
+        slotSize = alignUp(slotSize);
+        if (slotSize < 2 * sizeof(struct Value)) {
+                slotSize = alignUp(2 * sizeof(struct Value));
+        }
+
+        *result = (struct PipelineBoundaryTransducer){
+            .super =
+                {
+                    boundaryTransducerApply, boundaryTransducerSize,
+                },
+            .slotsCount = slotsCount,
+            .slotSize = slotSize,
+        };
+
+        return &result->super;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+/**
+ * @file
+ * Pipeline-parallel reduction of composed chains.
+ *
+ * A chain is cut into segments by placing pipelineBoundaryTransducer()
+ * stages in a composition. The stages after a boundary run on a thread of
+ * their own, fed through a single-producer/single-consumer ring of
+ * slotsCount slots of slotSize bytes. Values are handed over in order, so
+ * that order-dependent stages such as indexingTransducer() may run on
+ * either side.
+ *
+ * Each segment only ever runs on one thread, the allocator must however be
+ * safe to use from several threads if stages on both sides allocate.
+ */
+
+struct Allocator;
+struct Transducer;
+
+#include <stddef.h>
+
+/**
+ * hands the values over to the stages after it, running on a thread
+ * started on the first value and joined on completion.
+ *
+ * immediates are copied, gathered by type into spans sent down with
+ * reducer_apply_batch. TTAG_SPAN and TTAG_BATCH values are copied too,
+ * batches being split over several slots when larger than slotSize. spans
+ * and elements larger than a slot are copied into a block from the
+ * allocator instead. other values are handed over by reference and must
+ * outlive the reduction, as allocated values do.
+ *
+ * when the stages after the boundary halt, the boundary halts at the
+ * next value it receives.
+ */
+struct Transducer *pipelineBoundaryTransducer(size_t slotsCount,
+                                              size_t slotSize,
+                                              struct Allocator *allocator);
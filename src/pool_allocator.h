@@ -0,0 +1,19 @@
+#pragma once
+
+#include "pool_allocator_type.h"
+
+#include <stddef.h>
+
+/// initializes an empty pool, which gets its slabs from parent
+void pool_init(struct PoolAllocator *pool, struct Allocator *parent,
+               size_t slabSize);
+
+/**
+ * gives all slabs back to the parent allocator.
+ *
+ * no thread may be using the pool anymore. the cache slot the pool took in
+ * the calling thread is freed, those it took in other threads are freed
+ * once those threads run out of slots, as long as the pool is among the
+ * last 64 released.
+ */
+void pool_release(struct PoolAllocator *pool);
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "allocator_type.h"
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file
+ * Size-class pools of small objects with per-thread free lists.
+ */
+
+enum { POOL_MAX_OBJECT_SIZE = 256, POOL_CLASSES = 5 };
+
+/// memory obtained from the parent, carved into objects by one thread
+struct PoolSlab
+{
+        struct PoolSlab *next;
+};
+
+struct PoolFreeObject
+{
+        struct PoolFreeObject *next;
+};
+
+/// what one thread holds of one pool
+struct PoolCache
+{
+        uint64_t poolId;
+        struct PoolFreeObject *freeLists[POOL_CLASSES];
+        uint8_t *cursor;
+        uint8_t *end;
+};
+
+/**
+ * Pool allocator.
+ *
+ * Objects up to POOL_MAX_OBJECT_SIZE bytes are taken from per-thread free
+ * lists, one per size class, refilled from slabs of slabSize bytes.
+ * Freeing an object allocated by the calling thread pushes it onto the
+ * free list of that thread, in O(1) and without locking. Objects freed by
+ * other threads go onto a remote list shared by all threads, which
+ * allocating threads drain once their own list is empty. Larger objects
+ * go to the parent.
+ *
+ * Threads caching too many pools at once use the shared cache of the pool,
+ * under a lock.
+ *
+ * parent must be safe to use from all the threads using the pool.
+ */
+struct PoolAllocator
+{
+        struct Allocator super;
+        struct Allocator *parent;
+        size_t slabSize;
+        /// tells apart the per-thread caches of each pool
+        uint64_t id;
+        _Atomic(struct PoolSlab *) slabs;
+        atomic_size_t slabsCount;
+        /// freed by threads other than the one that allocated them
+        _Atomic(struct PoolFreeObject *) remote[POOL_CLASSES];
+
+        atomic_flag sharedLock;
+        struct PoolCache shared;
+};
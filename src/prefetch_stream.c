@@ -0,0 +1,328 @@
+#include "prefetch_stream_types.h"
+#include "prefetch_stream.h"
+
+#include "alignment.h"
+#include "allocator.h"
+#include "failed_streams.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <string.h>
+
+struct PrefetchSlot
+{
+        uint8_t *data;
+        size_t size;
+        enum StreamErrorCode error;
+        int type_tag;
+        size_t element_size;
+};
+
+struct PrefetchRing
+{
+        /* source, only accessed by the background thread */
+        void *source;
+        enum StreamErrorCode (*refill)(void *source);
+        uint8_t const **sourceCursor;
+        uint8_t const *const *sourceEnd;
+        enum StreamErrorCode const *sourceError;
+        /* only for value streams */
+        int const *sourceTypeTag;
+        size_t const *sourceElementSize;
+
+        struct Allocator *allocator;
+        pthread_mutex_t mutex;
+        /// signaled when a slot was filled
+        pthread_cond_t filled;
+        /// signaled when a slot was given back by the consumer
+        pthread_cond_t emptied;
+        pthread_t thread;
+        bool closing;
+        /// the consumer is reading slots[readIndex]
+        bool reading;
+        size_t readIndex;
+        size_t filledCount;
+        size_t bufferSize;
+        size_t slotsCount;
+        struct PrefetchSlot slots[];
+};
+
+/* background thread */
+
+/// @return false once the source is exhausted or in error
+static bool fillSlot(struct PrefetchRing *ring, struct PrefetchSlot *slot)
+{
+        while (*ring->sourceError == S_NoError &&
+               *ring->sourceCursor == *ring->sourceEnd) {
+                ring->refill(ring->source);
+        }
+
+        if (*ring->sourceError != S_NoError) {
+                slot->size = 0;
+                slot->error = *ring->sourceError;
+                return false;
+        }
+
+        size_t const granule =
+            ring->sourceElementSize ? *ring->sourceElementSize : 1;
+        size_t const available =
+            (size_t)(*ring->sourceEnd - *ring->sourceCursor);
+        size_t const capacity = ring->bufferSize / granule * granule;
+        size_t const size = available < capacity ? available : capacity;
+
+        memcpy(slot->data, *ring->sourceCursor, size);
+        *ring->sourceCursor += size;
+
+        slot->size = size;
+        slot->error = S_NoError;
+        slot->type_tag = ring->sourceTypeTag ? *ring->sourceTypeTag : 0;
+        slot->element_size = granule;
+
+        return true;
+}
+
+static void *prefetchRun(void *data)
+{
+        struct PrefetchRing *ring = data;
+        size_t writeIndex = 0;
+        bool more = true;
+
+        while (more) {
+                pthread_mutex_lock(&ring->mutex);
+                while (ring->filledCount == ring->slotsCount &&
+                       !ring->closing) {
+                        pthread_cond_wait(&ring->emptied, &ring->mutex);
+                }
+                bool const closing = ring->closing;
+                pthread_mutex_unlock(&ring->mutex);
+                if (closing) {
+                        break;
+                }
+
+                more = fillSlot(ring, &ring->slots[writeIndex]);
+                writeIndex = (writeIndex + 1) % ring->slotsCount;
+
+                pthread_mutex_lock(&ring->mutex);
+                ring->filledCount++;
+                pthread_cond_signal(&ring->filled);
+                pthread_mutex_unlock(&ring->mutex);
+        }
+
+        return NULL;
+}
+
+/* consumer */
+
+/// waits for the next filled slot, after giving back the current one
+static struct PrefetchSlot const *nextSlot(struct PrefetchRing *ring)
+{
+        pthread_mutex_lock(&ring->mutex);
+        if (ring->reading) {
+                ring->readIndex = (ring->readIndex + 1) % ring->slotsCount;
+                ring->filledCount--;
+                pthread_cond_signal(&ring->emptied);
+        }
+        while (ring->filledCount == 0) {
+                pthread_cond_wait(&ring->filled, &ring->mutex);
+        }
+        ring->reading = true;
+        struct PrefetchSlot const *slot = &ring->slots[ring->readIndex];
+        pthread_mutex_unlock(&ring->mutex);
+
+        return slot;
+}
+
+static struct PrefetchRing *newRing(size_t buffersCount, size_t bufferSize,
+                                    struct Allocator *allocator)
+{
+        if (buffersCount < 2) {
+                buffersCount = 2;
+        }
+        /* keep every buffer aligned for any element type */
+        bufferSize = alignUp(bufferSize);
+
+        size_t const headerSize = alignUp(
+            sizeof(struct PrefetchRing) +
+            buffersCount * sizeof(struct PrefetchSlot));
+        struct PrefetchRing *ring = allocator_alloc(
+            allocator, headerSize + buffersCount * bufferSize);
+        if (!ring) {
+                return NULL;
+        }
+
+        *ring = (struct PrefetchRing){
+            .allocator = allocator,
+            .bufferSize = bufferSize,
+            .slotsCount = buffersCount,
+        };
+
+        uint8_t *buffers = (uint8_t *)ring + headerSize;
+        for (size_t i = 0; i < buffersCount; i++) {
+                ring->slots[i] = (struct PrefetchSlot){
+                    .data = buffers + i * bufferSize,
+                };
+        }
+
+        return ring;
+}
+
+static bool startRing(struct PrefetchRing *ring)
+{
+        pthread_mutex_init(&ring->mutex, NULL);
+        pthread_cond_init(&ring->filled, NULL);
+        pthread_cond_init(&ring->emptied, NULL);
+
+        if (pthread_create(&ring->thread, NULL, prefetchRun, ring) != 0) {
+                pthread_cond_destroy(&ring->emptied);
+                pthread_cond_destroy(&ring->filled);
+                pthread_mutex_destroy(&ring->mutex);
+                allocator_free(ring->allocator, ring);
+                return false;
+        }
+
+        return true;
+}
+
+static void closeRing(struct PrefetchRing *ring)
+{
+        if (!ring) {
+                return;
+        }
+
+        pthread_mutex_lock(&ring->mutex);
+        ring->closing = true;
+        pthread_cond_signal(&ring->emptied);
+        pthread_mutex_unlock(&ring->mutex);
+
+        pthread_join(ring->thread, NULL);
+
+        pthread_cond_destroy(&ring->emptied);
+        pthread_cond_destroy(&ring->filled);
+        pthread_mutex_destroy(&ring->mutex);
+        allocator_free(ring->allocator, ring);
+}
+
+/* byte streams */
+
+static enum StreamErrorCode next_prefetched(struct StreamRange *range)
+{
+        struct PrefetchStream *stream = (struct PrefetchStream *)range;
+        struct PrefetchSlot const *slot = nextSlot(stream->ring);
+
+        if (slot->error != S_NoError) {
+                return stream_fail(range, slot->error);
+        }
+
+        range->start = slot->data;
+        range->cursor = slot->data;
+        range->end = slot->data + slot->size;
+
+        return range->error;
+}
+
+static enum StreamErrorCode refillStream(void *source)
+{
+        struct StreamRange *range = source;
+        return range->next(range);
+}
+
+enum StreamErrorCode stream_prefetch(struct PrefetchStream *stream,
+                                     struct StreamRange *source,
+                                     size_t buffersCount, size_t bufferSize,
+                                     struct Allocator *allocator)
+{
+        stream->ring = newRing(buffersCount, bufferSize, allocator);
+        if (!stream->ring) {
+                return stream_fail(&stream->range, S_IOError);
+        }
+
+        struct PrefetchRing *ring = stream->ring;
+        ring->source = source;
+        ring->refill = refillStream;
+        ring->sourceCursor = &source->cursor;
+        ring->sourceEnd = &source->end;
+        ring->sourceError = &source->error;
+
+        if (!startRing(ring)) {
+                stream->ring = NULL;
+                return stream_fail(&stream->range, S_IOError);
+        }
+
+        stream->range.error = S_NoError;
+        stream->range.next = next_prefetched;
+
+        return stream->range.next(&stream->range);
+}
+
+void stream_close_prefetch(struct PrefetchStream *stream)
+{
+        closeRing(stream->ring);
+        stream->ring = NULL;
+}
+
+/* value streams */
+
+static enum StreamErrorCode prefetchedVSRNext(struct ValueStreamRange *range)
+{
+        struct PrefetchValueStream *stream =
+            (struct PrefetchValueStream *)range;
+        struct PrefetchSlot const *slot = nextSlot(stream->ring);
+
+        if (slot->error != S_NoError) {
+                return value_stream_fail(range, slot->error);
+        }
+
+        range->type_tag = slot->type_tag;
+        range->element_size = slot->element_size;
+        range->start = slot->data;
+        range->cursor = slot->data;
+        range->end = slot->data + slot->size;
+
+        return range->error;
+}
+
+static enum StreamErrorCode refillVSR(void *source)
+{
+        struct ValueStreamRange *range = source;
+        return range->next(range);
+}
+
+enum StreamErrorCode prefetchVSR(struct PrefetchValueStream *stream,
+                                 struct ValueStreamRange *source,
+                                 size_t buffersCount, size_t bufferSize,
+                                 struct Allocator *allocator)
+{
+        if (bufferSize < source->element_size) {
+                bufferSize = source->element_size;
+        }
+
+        stream->ring = newRing(buffersCount, bufferSize, allocator);
+        if (!stream->ring) {
+                return value_stream_fail(&stream->range, S_IOError);
+        }
+
+        struct PrefetchRing *ring = stream->ring;
+        ring->source = source;
+        ring->refill = refillVSR;
+        ring->sourceCursor = &source->cursor;
+        ring->sourceEnd = &source->end;
+        ring->sourceError = &source->error;
+        ring->sourceTypeTag = &source->type_tag;
+        ring->sourceElementSize = &source->element_size;
+
+        if (!startRing(ring)) {
+                stream->ring = NULL;
+                return value_stream_fail(&stream->range, S_IOError);
+        }
+
+        stream->range.error = S_NoError;
+        stream->range.next = prefetchedVSRNext;
+
+        return stream->range.next(&stream->range);
+}
+
+void closePrefetchVSR(struct PrefetchValueStream *stream)
+{
+        closeRing(stream->ring);
+        stream->ring = NULL;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+/**
+ * @file
+ * Adapters overlapping the refills of a stream with its consumption.
+ *
+ * A background thread pulls from the source stream into a ring of
+ * buffersCount buffers of bufferSize bytes. Calling next() on the adapter
+ * hands over the next filled buffer, and only waits when the thread is
+ * late. The source is only touched by the background thread until the
+ * adapter is closed.
+ */
+
+#include "prefetch_stream_types.h"
+
+#include <stddef.h>
+
+struct Allocator;
+
+/// @return S_IOError when the ring or thread could not be created
+enum StreamErrorCode stream_prefetch(struct PrefetchStream *stream,
+                                     struct StreamRange *source,
+                                     size_t buffersCount, size_t bufferSize,
+                                     struct Allocator *allocator);
+
+/// stops the background thread and releases the buffers
+void stream_close_prefetch(struct PrefetchStream *stream);
+
+/// buffers only ever hold whole elements of the source
+enum StreamErrorCode prefetchVSR(struct PrefetchValueStream *stream,
+                                 struct ValueStreamRange *source,
+                                 size_t buffersCount, size_t bufferSize,
+                                 struct Allocator *allocator);
+
+void closePrefetchVSR(struct PrefetchValueStream *stream);
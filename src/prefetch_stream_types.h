@@ -0,0 +1,24 @@
+#pragma once
+
+#include "stream_types.h"
+#include "value_stream_types.h"
+
+struct PrefetchRing;
+
+/**
+ * Stream refilled ahead of the consumer by a background thread.
+ *
+ * see stream_prefetch()
+ */
+struct PrefetchStream
+{
+        struct StreamRange range;
+        struct PrefetchRing *ring;
+};
+
+/// see prefetchVSR()
+struct PrefetchValueStream
+{
+        struct ValueStreamRange range;
+        struct PrefetchRing *ring;
+};
@@ -0,0 +1,281 @@
+#include "profiling.h"
+#include "transducer_types.h"
+#include "transducers.h"
+
+#include "allocator.h"
+#include "allocator_type.h"
+
+#include <stdbool.h>
+#include <time.h>
+
+static uint64_t nowNanoseconds(void)
+{
+        struct timespec ts;
+        timespec_get(&ts, TIME_UTC);
+        return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/* counts the allocations of the profiled stage */
+struct ProfilingAllocator
+{
+        struct Allocator super;
+        struct Allocator *parent;
+        struct StageProfile *profile;
+};
+
+static void *profilingAlloc(struct Allocator *allocator, size_t size)
+{
+        struct ProfilingAllocator *self = (struct ProfilingAllocator *)allocator;
+        self->profile->allocations++;
+        return allocator_alloc(self->parent, size);
+}
+
+static void profilingFree(struct Allocator *allocator, void *ptr)
+{
+        struct ProfilingAllocator *self = (struct ProfilingAllocator *)allocator;
+        allocator_free(self->parent, ptr);
+}
+
+/*
+ * the profiled stage is surrounded by two reducers:
+ *
+ * entry -> stage reducer -> exit -> step
+ *
+ * the exit measures the time spent downstream so that the entry can
+ * subtract it.
+ */
+
+struct ProfilingExit
+{
+        struct ChainedReducer super;
+        struct StageProfile *profile;
+        struct ProfilingAllocator *allocator;
+        bool timing;
+        uint64_t downstreamNanoseconds;
+};
+
+struct ProfilingEntry
+{
+        struct ChainedReducer super;
+        struct StageProfile *profile;
+        struct ProfilingAllocator allocator;
+        struct ProfilingExit *exit;
+};
+
+static struct Value profilingExitApply(struct Reducer const *reducer,
+                                       struct Value input,
+                                       struct Value current,
+                                       struct Allocator *allocator)
+{
+        struct ProfilingExit *self = (struct ProfilingExit *)reducer;
+        self->profile->outputs++;
+
+        if (!self->timing) {
+                return reducer_apply(self->super.step, input, current,
+                                     self->allocator->parent);
+        }
+
+        uint64_t const start = nowNanoseconds();
+        struct Value const result = reducer_apply(
+            self->super.step, input, current, self->allocator->parent);
+        self->downstreamNanoseconds += nowNanoseconds() - start;
+
+        return result;
+}
+
+static struct Value profilingExitApplyBatch(struct Reducer const *reducer,
+                                            struct ValueSpan span,
+                                            struct Value current,
+                                            struct Allocator *allocator)
+{
+        struct ProfilingExit *self = (struct ProfilingExit *)reducer;
+        self->profile->outputs += valueSpanCount(&span);
+
+        if (!self->timing) {
+                return reducer_apply_batch(self->super.step, span, current,
+                                           self->allocator->parent);
+        }
+
+        uint64_t const start = nowNanoseconds();
+        struct Value const result = reducer_apply_batch(
+            self->super.step, span, current, self->allocator->parent);
+        self->downstreamNanoseconds += nowNanoseconds() - start;
+
+        return result;
+}
+
+/// true when this call is to be timed
+static bool profilingEntryBegin(struct ProfilingEntry *self,
+                                uint64_t const inputs,
+                                struct Allocator *allocator)
+{
+        struct StageProfile *profile = self->profile;
+        profile->calls++;
+        profile->inputs += inputs;
+        self->allocator.parent = allocator;
+
+        if (profile->samplingPeriod > 1 &&
+            profile->calls % profile->samplingPeriod != 0) {
+                return false;
+        }
+
+        self->exit->timing = true;
+        self->exit->downstreamNanoseconds = 0;
+        return true;
+}
+
+static void profilingEntryEnd(struct ProfilingEntry *self,
+                              uint64_t const start)
+{
+        uint64_t const elapsed = nowNanoseconds() - start;
+        uint64_t const downstream = self->exit->downstreamNanoseconds;
+
+        self->exit->timing = false;
+        self->profile->sampledCalls++;
+        self->profile->sampledNanoseconds +=
+            elapsed > downstream ? elapsed - downstream : 0;
+}
+
+static struct Value profilingEntryApply(struct Reducer const *reducer,
+                                        struct Value input,
+                                        struct Value current,
+                                        struct Allocator *allocator)
+{
+        struct ProfilingEntry *self = (struct ProfilingEntry *)reducer;
+
+        if (!profilingEntryBegin(self, 1, allocator)) {
+                return reducer_apply(self->super.step, input, current,
+                                     &self->allocator.super);
+        }
+
+        uint64_t const start = nowNanoseconds();
+        struct Value const result = reducer_apply(
+            self->super.step, input, current, &self->allocator.super);
+        profilingEntryEnd(self, start);
+
+        return result;
+}
+
+static struct Value profilingEntryApplyBatch(struct Reducer const *reducer,
+                                             struct ValueSpan span,
+                                             struct Value current,
+                                             struct Allocator *allocator)
+{
+        struct ProfilingEntry *self = (struct ProfilingEntry *)reducer;
+
+        if (!profilingEntryBegin(self, valueSpanCount(&span), allocator)) {
+                return reducer_apply_batch(self->super.step, span, current,
+                                           &self->allocator.super);
+        }
+
+        uint64_t const start = nowNanoseconds();
+        struct Value const result = reducer_apply_batch(
+            self->super.step, span, current, &self->allocator.super);
+        profilingEntryEnd(self, start);
+
+        return result;
+}
+
+struct ProfilingTransducer
+{
+        struct Transducer super;
+        struct Transducer *transducer;
+        struct StageProfile *profile;
+};
+
+static struct Reducer *profilingTransducerApply(struct Transducer *transducer,
+                                                struct Reducer const *step,
+                                                struct Allocator *allocator)
+{
+        struct ProfilingTransducer *self =
+            (struct ProfilingTransducer *)transducer;
+
+        struct ProfilingEntry *entry = allocator_alloc(allocator, sizeof *entry);
+        struct ProfilingExit *leaving =
+            allocator_alloc(allocator, sizeof *leaving);
+
+        leaving->super = chainedReducerMake(step, profilingExitApply);
+        leaving->super.super.apply_batch = profilingExitApplyBatch;
+        /* timing passes values through untouched */
+        leaving->super.super.properties = step->properties;
+        leaving->profile = self->profile;
+        leaving->allocator = &entry->allocator;
+        leaving->timing = false;
+        leaving->downstreamNanoseconds = 0;
+
+        entry->allocator = (struct ProfilingAllocator){
+            .super =
+                (struct Allocator){
+                    .alloc = profilingAlloc, .free = profilingFree,
+                },
+            .parent = allocator,
+            .profile = self->profile,
+        };
+        entry->profile = self->profile;
+        entry->exit = leaving;
+
+        struct Reducer *stage = transducer_apply(
+            self->transducer, &leaving->super.super, allocator);
+        entry->super = chainedReducerMake(stage, profilingEntryApply);
+        entry->super.super.apply_batch = profilingEntryApplyBatch;
+        entry->super.super.properties = stage->properties;
+
+        return &entry->super.super;
+}
+
+struct Transducer *profilingTransducer(struct Transducer *transducer,
+                                       struct StageProfile *profile,
+                                       struct Allocator *allocator)
+{
+        struct ProfilingTransducer *result =
+            allocator_alloc(allocator, sizeof *result);
+
+        *result = (struct ProfilingTransducer){
+            .super = (struct Transducer){.apply = profilingTransducerApply},
+            .transducer = transducer,
+            .profile = profile,
+        };
+
+        return &result->super;
+}
+
+struct Transducer *profilingComposingTransducer(struct Transducer **transducers,
+                                                size_t transducerCount,
+                                                struct StageProfile *profiles,
+                                                struct Allocator *allocator)
+{
+        struct Transducer **profiled =
+            allocator_alloc(allocator, transducerCount * sizeof *profiled);
+
+        for (size_t i = 0; i < transducerCount; i++) {
+                profiled[i] = profilingTransducer(transducers[i], &profiles[i],
+                                                  allocator);
+        }
+
+        return composingTransducer(profiled, transducerCount, allocator);
+}
+
+void stage_profile_reset(struct StageProfile *profile)
+{
+        *profile = (struct StageProfile){
+            .name = profile->name, .samplingPeriod = profile->samplingPeriod,
+        };
+}
+
+uint64_t stage_profile_dropped(struct StageProfile const *profile)
+{
+        return profile->inputs > profile->outputs
+                   ? profile->inputs - profile->outputs
+                   : 0;
+}
+
+uint64_t stage_profile_nanoseconds(struct StageProfile const *profile)
+{
+        if (profile->sampledCalls == 0) {
+                return 0;
+        }
+
+        return (uint64_t)((double)profile->sampledNanoseconds *
+                          (double)profile->calls /
+                          (double)profile->sampledCalls);
+}
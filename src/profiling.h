@@ -0,0 +1,43 @@
+#pragma once
+
+/**
+ * @file
+ * Per-stage instrumentation of pipelines.
+ */
+
+#include "profiling_types.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct Allocator;
+struct Transducer;
+
+/**
+ * behaves like transducer, recording its activity into profile.
+ *
+ * the profile must outlive the reducers created by the transducer.
+ */
+struct Transducer *profilingTransducer(struct Transducer *transducer,
+                                       struct StageProfile *profile,
+                                       struct Allocator *allocator);
+
+/**
+ * composition of transducers where each stage i is profiled into
+ * profiles[i].
+ *
+ * profiled stages are not fused together.
+ */
+struct Transducer *profilingComposingTransducer(struct Transducer **transducers,
+                                                size_t transducerCount,
+                                                struct StageProfile *profiles,
+                                                struct Allocator *allocator);
+
+/// clears the measurements, keeping name and samplingPeriod
+void stage_profile_reset(struct StageProfile *profile);
+
+/// elements the stage did not pass on
+uint64_t stage_profile_dropped(struct StageProfile const *profile);
+
+/// time spent in the stage, extrapolated from the timed calls
+uint64_t stage_profile_nanoseconds(struct StageProfile const *profile);
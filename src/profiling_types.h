@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Measurements of one stage of a pipeline, filled in by a
+ * profilingTransducer.
+ *
+ * Times and allocations are those of the stage alone: what happens in
+ * the steps after it is not included.
+ */
+struct StageProfile
+{
+        /// set by the user, for reports
+        char const *name;
+
+        /**
+         * set by the user: time one call in samplingPeriod. 0 or 1 times
+         * every call.
+         */
+        uint32_t samplingPeriod;
+
+        /// calls to apply or apply_batch
+        uint64_t calls;
+        /// elements received
+        uint64_t inputs;
+        /// elements sent to the next step
+        uint64_t outputs;
+        /// allocations made by the stage
+        uint64_t allocations;
+
+        /// calls that were timed
+        uint64_t sampledCalls;
+        /// time spent in the timed calls
+        uint64_t sampledNanoseconds;
+};
@@ -0,0 +1,103 @@
+#include "reduce.h"
+#include "reduce_types.h"
+#include "transducer_types.h"
+#include "transducers.h"
+#include "value_stream_types.h"
+
+#include <assert.h>
+
+struct Value reduceStream(struct ValueStreamRange *range,
+                          struct Reducer const *reducer,
+                          struct Allocator *allocator)
+{
+        struct Value result = reducer_identity(reducer, allocator);
+        while (!isReduced(&result) && range->error == S_NoError) {
+                if (range->cursor == range->end) {
+                        range->next(range);
+                        continue;
+                }
+
+                struct ValueSpan const span = {
+                    .type_tag = range->type_tag,
+                    .element_size = range->element_size,
+                    .start = range->cursor,
+                    .end = range->end,
+                };
+                range->cursor = range->end;
+                result = reducer_apply_batch(reducer, span, result, allocator);
+        }
+        return reducer_complete(reducer, unreduced(result), allocator);
+}
+
+struct Value transduceFloatArray(float const *values, size_t valuesCount,
+                                 struct Transducer *transducer,
+                                 struct Allocator *allocator)
+{
+        struct Reducer *reducer =
+            transducer_apply(transducer, idReducer(allocator), allocator);
+        struct ValueSpan const span = {
+            .type_tag = TTAG_FLOAT,
+            .element_size = sizeof values[0],
+            .start = (uint8_t const *)values,
+            .end = (uint8_t const *)(values + valuesCount),
+        };
+        struct Value result = reducer_identity(reducer, allocator);
+        result = reducer_apply_batch(reducer, span, result, allocator);
+
+        return reducer_complete(reducer, unreduced(result), allocator);
+}
+
+void reduction_start(struct ReductionSession *session,
+                     struct Reducer const *reducer,
+                     struct Allocator *allocator)
+{
+        *session = (struct ReductionSession){
+            .reducer = reducer,
+            .allocator = allocator,
+            .result = reducer_identity(reducer, allocator),
+        };
+}
+
+bool reduction_push_span(struct ReductionSession *session,
+                         struct ValueSpan span)
+{
+        assert(!session->completed);
+
+        if (isReduced(&session->result)) {
+                return false;
+        }
+        if (span.start < span.end) {
+                session->result = reducer_apply_batch(
+                    session->reducer, span, session->result,
+                    session->allocator);
+        }
+
+        return !isReduced(&session->result);
+}
+
+bool reduction_push(struct ReductionSession *session, struct Value value)
+{
+        assert(!session->completed);
+
+        if (isReduced(&session->result)) {
+                return false;
+        }
+        session->result = reducer_apply(session->reducer, value,
+                                        session->result, session->allocator);
+
+        return !isReduced(&session->result);
+}
+
+struct Value reduction_current(struct ReductionSession const *session)
+{
+        return unreduced(session->result);
+}
+
+struct Value reduction_complete(struct ReductionSession *session)
+{
+        assert(!session->completed);
+
+        session->completed = true;
+        return reducer_complete(session->reducer, unreduced(session->result),
+                                session->allocator);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+/**
+ * @file
+ * Drivers running a reducer over a whole input.
+ */
+
+struct Allocator;
+struct Reducer;
+struct ReductionSession;
+struct Transducer;
+struct ValueStreamRange;
+
+#include "reduce_types.h"
+#include "values.h"
+
+#include <stdbool.h>
+
+#include <stddef.h>
+
+/// reduces the values of range until it ends or the result is reduced
+struct Value reduceStream(struct ValueStreamRange *range,
+                          struct Reducer const *reducer,
+                          struct Allocator *allocator);
+
+/// transduces values with the id reducer as the last step
+struct Value transduceFloatArray(float const *values, size_t valuesCount,
+                                 struct Transducer *transducer,
+                                 struct Allocator *allocator);
+
+/**
+ * starts a reduction of the values pushed into session.
+ *
+ * reducer keeps its state between pushes, so it serves this session only
+ * until reduction_complete().
+ */
+void reduction_start(struct ReductionSession *session,
+                     struct Reducer const *reducer,
+                     struct Allocator *allocator);
+
+/**
+ * reduces the values of span right away.
+ *
+ * @return false once the reduction needs no more input, after which
+ * pushes are ignored
+ */
+bool reduction_push_span(struct ReductionSession *session,
+                         struct ValueSpan span);
+
+/// reduces a single value, like reduction_push_span()
+bool reduction_push(struct ReductionSession *session, struct Value value);
+
+/**
+ * result of the values pushed so far, owned by the session.
+ *
+ * stages holding values back until completion, such as windows, have not
+ * contributed them yet.
+ */
+struct Value reduction_current(struct ReductionSession const *session);
+
+/// completes the reduction and ends the session
+struct Value reduction_complete(struct ReductionSession *session);
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "values.h"
+
+#include <stdbool.h>
+
+struct Allocator;
+struct Reducer;
+
+/**
+ * Reduction fed one chunk at a time, as the input arrives.
+ *
+ * see reduction_start()
+ */
+struct ReductionSession
+{
+        struct Reducer const *reducer;
+        struct Allocator *allocator;
+        /// result so far, reduced once the chain needs no more input
+        struct Value result;
+        bool completed;
+};
@@ -0,0 +1,154 @@
+#pragma once
+
+/**
+ * transducers composed at compile time
+ *
+ * each stage is a `static inline` step function calling the next stage by
+ * name, so that the compiler sees the whole chain and may inline it into
+ * a single loop. a chain ends either in a static reducing function
+ * (XF_REDUCE) or in a runtime reducer (XF_SINK).
+ *
+ * stages are declared last to first:
+ *
+ *     XF_SINK(print)
+ *     XF_FILTER_FLOAT(positive, isPositive, print)
+ *     XF_MAP_FLOAT(negate, negateFloat, positive)
+ *     XF_REDUCER(negatePositives, negate)
+ *
+ * which defines `negatePositivesReducer(sink)`, a struct ChainedReducer
+ * usable wherever a struct Reducer is, and `negatePositivesSpan(...)`, a
+ * loop reducing a whole span through the chain.
+ */
+
+#include "transducer_types.h"
+#include "transducers.h"
+#include "values.h"
+
+#include <stdint.h>
+
+/// boxes a scalar into the matching immediate value
+#define xfBox(x)                                                               \
+        _Generic((x), float                                                    \
+                 : floatImmediate, int64_t                                     \
+                 : intImmediate, size_t                                        \
+                 : indexImmediate, struct Value                                \
+                 : xfIdentity)(x)
+
+static inline struct Value xfIdentity(struct Value value) { return value; }
+
+static inline float xfFloat(struct Value value)
+{
+        return *(float const *)valuePayload(&value);
+}
+
+/// signature of the step functions defined by the macros below
+#define XF_STEP(name)                                                          \
+        static inline struct Value name(                                       \
+            struct Value input, struct Value current,                          \
+            struct Reducer const *sink, struct Allocator *allocator)
+
+/// passes input on to the runtime reducer sink
+#define XF_SINK(name)                                                          \
+        XF_STEP(name)                                                          \
+        {                                                                      \
+                return reducer_apply(sink, input, current, allocator);         \
+        }
+
+/// ends the chain with `current = fn(current, input)`, fn taking and
+/// returning struct Value
+#define XF_REDUCE(name, fn)                                                    \
+        XF_STEP(name)                                                          \
+        {                                                                      \
+                (void)sink;                                                    \
+                (void)allocator;                                               \
+                return fn(current, input);                                     \
+        }
+
+/// passes on the values for which predicate(struct Value) holds
+#define XF_FILTER(name, predicate, next)                                       \
+        XF_STEP(name)                                                          \
+        {                                                                      \
+                if (!predicate(input)) {                                       \
+                        return current;                                        \
+                }                                                              \
+                return next(input, current, sink, allocator);                  \
+        }
+
+/// passes on fn(struct Value)
+#define XF_MAP(name, fn, next)                                                 \
+        XF_STEP(name)                                                          \
+        {                                                                      \
+                return next(fn(input), current, sink, allocator);              \
+        }
+
+/// like XF_FILTER, with predicate taking the unboxed float
+#define XF_FILTER_FLOAT(name, predicate, next)                                 \
+        XF_STEP(name)                                                          \
+        {                                                                      \
+                if (!predicate(xfFloat(input))) {                              \
+                        return current;                                        \
+                }                                                              \
+                return next(input, current, sink, allocator);                  \
+        }
+
+/// like XF_MAP, with fn taking the unboxed float and returning a float,
+/// int64_t, size_t or struct Value
+#define XF_MAP_FLOAT(name, fn, next)                                           \
+        XF_STEP(name)                                                          \
+        {                                                                      \
+                return next(xfBox(fn(xfFloat(input))), current, sink,          \
+                            allocator);                                        \
+        }
+
+/**
+ * defines, for the chain starting at step first:
+ *
+ * `struct Value name##Span(struct ValueSpan span, struct Value current,
+ *     struct Reducer const *sink, struct Allocator *allocator)`
+ *    reducing all elements of span, stopping on a reduced() result.
+ *
+ * `struct ChainedReducer name##Reducer(struct Reducer const *sink)`
+ *    the chain as a runtime reducer, starting, completing and combining
+ *    like sink since stages hold no state.
+ */
+#define XF_REDUCER(name, first)                                                \
+        static inline struct Value name##Span(                                 \
+            struct ValueSpan span, struct Value current,                       \
+            struct Reducer const *sink, struct Allocator *allocator)           \
+        {                                                                      \
+                for (uint8_t const *address = span.start;                      \
+                     address < span.end; address += span.element_size) {       \
+                        current =                                              \
+                            first(valueSpanElement(&span, address), current,   \
+                                  sink, allocator);                            \
+                        if (isReduced(&current)) {                             \
+                                break;                                         \
+                        }                                                      \
+                }                                                              \
+                return current;                                                \
+        }                                                                      \
+                                                                               \
+        static inline struct Value name##Apply(                                \
+            struct Reducer const *reducer, struct Value input,                 \
+            struct Value current, struct Allocator *allocator)                 \
+        {                                                                      \
+                struct ChainedReducer const *chained = (void const *)reducer;  \
+                return first(input, current, chained->step, allocator);        \
+        }                                                                      \
+                                                                               \
+        static inline struct Value name##ApplyBatch(                           \
+            struct Reducer const *reducer, struct ValueSpan span,              \
+            struct Value current, struct Allocator *allocator)                 \
+        {                                                                      \
+                struct ChainedReducer const *chained = (void const *)reducer;  \
+                return name##Span(span, current, chained->step, allocator);    \
+        }                                                                      \
+                                                                               \
+        static inline struct ChainedReducer name##Reducer(                     \
+            struct Reducer const *sink)                                        \
+        {                                                                      \
+                struct ChainedReducer reducer =                                \
+                    chainedReducerMake(sink, name##Apply);                     \
+                reducer.super.apply_batch = name##ApplyBatch;                  \
+                return reducer;                                                \
+        }
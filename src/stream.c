@@ -1,45 +1,308 @@
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include "stream_types.h"
 #include "stream.h"
 
-static enum StreamErrorCode next_zeros(struct StreamRange *range)
-{
-        static uint8_t const zeros[256] = {0};
+#include "allocator.h"
+#include "failed_streams.h"
 
-        range->start = zeros;
-        range->cursor = zeros;
-        range->end = zeros + sizeof(zeros);
+#include <stdbool.h>
 
-        return range->error;
-}
+#if defined(__unix__) || defined(__APPLE__)
+#define STREAM_HAS_POSIX_FILES
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
 
 void stream_of_zeros(struct StreamRange *range)
 {
-        range->next = next_zeros;
-        range->error = S_NoError;
+        stream_fail(range, S_NoError);
+}
 
-        range->next(range);
+static enum StreamErrorCode next_on_memory_buffer(struct StreamRange *range)
+{
+        return stream_fail(range, S_ReadPastEnd);
+}
+
+void stream_on_memory(struct StreamRange *range, uint8_t const *mem,
+                      size_t const size)
+{
+        range->start = mem;
+        range->cursor = mem;
+        range->end = range->start + size;
+        range->error = S_NoError;
+        range->next = next_on_memory_buffer;
 }
 
-static enum StreamErrorCode fail(struct StreamRange *range,
-                                 enum StreamErrorCode error)
+static enum StreamErrorCode next_discarding(struct OutputStreamRange *range)
 {
-        range->error = error;
-        range->next = next_zeros;
+        static uint8_t scratch[256];
 
-        return range->next(range);
+        range->start = scratch;
+        range->cursor = scratch;
+        range->end = scratch + sizeof(scratch);
+
+        return range->error;
 }
 
-static enum StreamErrorCode next_on_memory_buffer(struct StreamRange *range)
+static enum StreamErrorCode
+next_to_memory_buffer(struct OutputStreamRange *range)
 {
-        return fail(range, S_ReadPastEnd);
+        range->error = S_WritePastEnd;
+        range->next = next_discarding;
+
+        return range->next(range);
 }
 
-void stream_on_memory(struct StreamRange *range, uint8_t const *mem,
+void stream_to_memory(struct OutputStreamRange *range, uint8_t *mem,
                       size_t const size)
 {
         range->start = mem;
         range->cursor = mem;
-        range->end = range->start + size;
+        range->end = mem + size;
         range->error = S_NoError;
-        range->next = next_on_memory_buffer;
+        range->next = next_to_memory_buffer;
+}
+
+#if defined(STREAM_HAS_POSIX_FILES)
+
+static enum StreamErrorCode next_on_file_buffer(struct StreamRange *range)
+{
+        struct FileStream *stream = (struct FileStream *)range;
+
+        ssize_t readSize;
+        do {
+                readSize = read(stream->fd, stream->buffer, stream->bufferSize);
+        } while (readSize < 0 && errno == EINTR);
+
+        if (readSize < 0) {
+                return stream_fail(range, S_IOError);
+        }
+        if (readSize == 0) {
+                return stream_fail(range, S_ReadPastEnd);
+        }
+
+        range->start = stream->buffer;
+        range->cursor = stream->buffer;
+        range->end = stream->buffer + readSize;
+
+        return range->error;
+}
+
+static enum StreamErrorCode open_mapped(struct FileStream *stream)
+{
+        struct stat status;
+        if (fstat(stream->fd, &status) != 0) {
+                return S_IOError;
+        }
+
+        stream->bufferSize = (size_t)status.st_size;
+        if (stream->bufferSize == 0) {
+                static uint8_t const empty[1];
+                stream_on_memory(&stream->range, empty, 0);
+                return S_NoError;
+        }
+
+        void *map = mmap(NULL, stream->bufferSize, PROT_READ, MAP_PRIVATE,
+                         stream->fd, 0);
+        if (map == MAP_FAILED) {
+                return S_IOError;
+        }
+        posix_madvise(map, stream->bufferSize, POSIX_MADV_SEQUENTIAL);
+
+        stream->buffer = map;
+        stream_on_memory(&stream->range, stream->buffer, stream->bufferSize);
+
+        return S_NoError;
 }
+
+static enum StreamErrorCode open_buffered(struct FileStream *stream,
+                                          size_t const bufferSize)
+{
+        stream->bufferSize = bufferSize;
+        stream->buffer = allocator_alloc(stream->allocator, bufferSize);
+        if (!stream->buffer) {
+                return S_IOError;
+        }
+
+        stream->range.error = S_NoError;
+        stream->range.next = next_on_file_buffer;
+        stream->range.next(&stream->range);
+
+        return S_NoError;
+}
+
+enum StreamErrorCode stream_on_file(struct FileStream *stream,
+                                    char const *path,
+                                    enum FileStreamBackend backend,
+                                    size_t bufferSize,
+                                    struct Allocator *allocator)
+{
+        *stream = (struct FileStream){
+            .backend = backend, .allocator = allocator,
+        };
+
+        stream->fd = open(path, O_RDONLY);
+        if (stream->fd < 0) {
+                stream_fail(&stream->range, S_IOError);
+                return S_IOError;
+        }
+
+        enum StreamErrorCode const error =
+            backend == FSB_Mapped ? open_mapped(stream)
+                                  : open_buffered(stream, bufferSize);
+        if (error != S_NoError) {
+                stream_close_file(stream);
+                stream_fail(&stream->range, error);
+        }
+
+        return error;
+}
+
+void stream_close_file(struct FileStream *stream)
+{
+        if (stream->backend == FSB_Mapped && stream->buffer) {
+                munmap(stream->buffer, stream->bufferSize);
+        } else if (stream->backend == FSB_Buffered) {
+                allocator_free(stream->allocator, stream->buffer);
+        }
+        if (stream->fd >= 0) {
+                close(stream->fd);
+        }
+
+        stream->buffer = NULL;
+        stream->fd = -1;
+}
+
+static enum StreamErrorCode next_on_socket(struct StreamRange *range)
+{
+        struct SocketStream *stream = (struct SocketStream *)range;
+
+        size_t const handed = stream->nextBuffer * stream->bufferSize;
+        if (handed >= stream->received) {
+                /* the consumer is done with all buffers */
+                struct iovec vectors[SOCKET_STREAM_MAX_BUFFERS];
+                for (size_t i = 0; i < stream->buffersCount; i++) {
+                        vectors[i] = (struct iovec){
+                            .iov_base = stream->buffers[i],
+                            .iov_len = stream->bufferSize,
+                        };
+                }
+
+                ssize_t readSize;
+                for (;;) {
+                        readSize = readv(stream->fd, vectors,
+                                         (int)stream->buffersCount);
+                        if (readSize >= 0) {
+                                break;
+                        }
+                        if (errno == EINTR) {
+                                continue;
+                        }
+                        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                                break;
+                        }
+
+                        /* non-blocking sockets wait for bytes */
+                        struct pollfd ready = {.fd = stream->fd,
+                                               .events = POLLIN};
+                        if (poll(&ready, 1, -1) < 0 && errno != EINTR) {
+                                break;
+                        }
+                }
+                stream->receiveCalls++;
+
+                if (readSize < 0) {
+                        return stream_fail(range, S_IOError);
+                }
+                if (readSize == 0) {
+                        return stream_fail(range, S_ReadPastEnd);
+                }
+                stream->received = (size_t)readSize;
+                stream->nextBuffer = 0;
+        }
+
+        size_t const offset = stream->nextBuffer * stream->bufferSize;
+        size_t const left = stream->received - offset;
+        uint8_t const *buffer = stream->buffers[stream->nextBuffer++];
+        range->start = buffer;
+        range->cursor = buffer;
+        range->end =
+            buffer + (left < stream->bufferSize ? left : stream->bufferSize);
+
+        return range->error;
+}
+
+enum StreamErrorCode stream_on_socket(struct SocketStream *stream, int fd,
+                                      size_t buffersCount, size_t bufferSize,
+                                      struct Allocator *allocator)
+{
+        *stream = (struct SocketStream){
+            .range = {.error = S_NoError, .next = next_on_socket},
+            .fd = fd,
+            .buffersCount = buffersCount,
+            .bufferSize = bufferSize,
+            .allocator = allocator,
+        };
+
+        bool allocated = buffersCount > 0 && bufferSize > 0 &&
+                         buffersCount <= SOCKET_STREAM_MAX_BUFFERS;
+        for (size_t i = 0; allocated && i < buffersCount; i++) {
+                stream->buffers[i] = allocator_alloc(allocator, bufferSize);
+                allocated = stream->buffers[i] != NULL;
+        }
+        if (!allocated) {
+                stream_close_socket(stream);
+                stream_fail(&stream->range, S_IOError);
+                return S_IOError;
+        }
+
+        /* the first receive happens on the first refill, as the stream
+         * starts empty */
+        return S_NoError;
+}
+
+void stream_close_socket(struct SocketStream *stream)
+{
+        for (size_t i = 0;
+             i < stream->buffersCount && i < SOCKET_STREAM_MAX_BUFFERS; i++) {
+                allocator_free(stream->allocator, stream->buffers[i]);
+                stream->buffers[i] = NULL;
+        }
+        stream->buffersCount = 0;
+}
+
+#else
+
+enum StreamErrorCode stream_on_file(struct FileStream *stream,
+                                    char const *path,
+                                    enum FileStreamBackend backend,
+                                    size_t bufferSize,
+                                    struct Allocator *allocator)
+{
+        *stream = (struct FileStream){.fd = -1};
+        stream_fail(&stream->range, S_IOError);
+        return S_IOError;
+}
+
+void stream_close_file(struct FileStream *stream) {}
+
+enum StreamErrorCode stream_on_socket(struct SocketStream *stream, int fd,
+                                      size_t buffersCount, size_t bufferSize,
+                                      struct Allocator *allocator)
+{
+        *stream = (struct SocketStream){.fd = fd};
+        stream_fail(&stream->range, S_IOError);
+        return S_IOError;
+}
+
+void stream_close_socket(struct SocketStream *stream) {}
+
+#endif
@@ -1,10 +1,57 @@
 #pragma once
 
+#include "stream_types.h"
+
 #include <stddef.h>
 #include <stdint.h>
 
+struct Allocator;
+struct FileStream;
+struct OutputStreamRange;
+struct SocketStream;
 struct StreamRange;
 
 void stream_of_zeros(struct StreamRange *range);
 void stream_on_memory(struct StreamRange *range, uint8_t const *mem,
                       size_t size);
+
+/// single window over mem, failing with S_WritePastEnd once full
+void stream_to_memory(struct OutputStreamRange *range, uint8_t *mem,
+                      size_t size);
+
+/**
+ * opens a stream on the file at path.
+ *
+ * with FSB_Buffered, bufferSize bytes are obtained from allocator and
+ * refilled as the consumer advances; it is ignored with FSB_Mapped.
+ *
+ * @return S_IOError when the file cannot be opened, in which case the
+ * stream is in error and needs no closing.
+ */
+enum StreamErrorCode stream_on_file(struct FileStream *stream,
+                                    char const *path,
+                                    enum FileStreamBackend backend,
+                                    size_t bufferSize,
+                                    struct Allocator *allocator);
+
+/// releases the file and buffers of the stream
+void stream_close_file(struct FileStream *stream);
+
+/**
+ * opens a stream on the connected socket fd, received into buffersCount
+ * buffers of bufferSize bytes from allocator.
+ *
+ * each refill hands over the next buffer filled by the last receive, and
+ * once all are consumed, receives into all of them again with a single
+ * readv(). bytes are only received when the consumer asks for them.
+ *
+ * @return S_IOError when the buffers cannot be obtained, or buffersCount
+ * is 0 or above SOCKET_STREAM_MAX_BUFFERS, in which case the stream is in
+ * error and needs no closing.
+ */
+enum StreamErrorCode stream_on_socket(struct SocketStream *stream, int fd,
+                                      size_t buffersCount, size_t bufferSize,
+                                      struct Allocator *allocator);
+
+/// releases the buffers of the stream, leaving fd to the caller
+void stream_close_socket(struct SocketStream *stream);
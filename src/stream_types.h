@@ -5,8 +5,11 @@
  * Buffered stream I/O
  */
 
+#include <stddef.h>
 #include <stdint.h>
 
+struct Allocator;
+
 /**
  * state of a stream
  */
@@ -15,6 +18,10 @@ enum StreamErrorCode {
         S_NoError,
         /// the consumer attempted to read past the end
         S_ReadPastEnd,
+        /// the underlying file or device failed
+        S_IOError,
+        /// the producer attempted to write past the end
+        S_WritePastEnd,
 };
 
 /**
@@ -65,3 +72,76 @@ struct StreamRange
          */
         enum StreamErrorCode (*next)(struct StreamRange *);
 };
+
+/**
+ * Buffer-centric output, the producer side mirror of StreamRange.
+ *
+ * The producer writes at cursor and calls next() once the window is full,
+ * to hand it over and obtain the next one.
+ */
+struct OutputStreamRange
+{
+        uint8_t *start;
+        uint8_t *end;
+        /// start <= cursor <= end, the bytes before cursor are written
+        uint8_t *cursor;
+        enum StreamErrorCode error;
+
+        /**
+         * - pre-condition: cursor == end
+         * - post-condition: start == cursor < end
+         *
+         * in error, the window is a scratch buffer whose contents are lost
+         */
+        enum StreamErrorCode (*next)(struct OutputStreamRange *);
+};
+
+/// how a file stream gets to the file contents
+enum FileStreamBackend {
+        /// the whole file is mapped in memory and seen as a single range
+        FSB_Mapped,
+        /// a fixed buffer is refilled with read() on each call to next()
+        FSB_Buffered,
+};
+
+/**
+ * Stream over the contents of a file.
+ *
+ * see stream_on_file()
+ */
+struct FileStream
+{
+        struct StreamRange range;
+        enum FileStreamBackend backend;
+        int fd;
+        uint8_t *buffer;
+        size_t bufferSize;
+        struct Allocator *allocator;
+};
+
+enum {
+        /// buffers a socket stream receives into with a single call
+        SOCKET_STREAM_MAX_BUFFERS = 16,
+};
+
+/**
+ * Stream over the bytes received from a socket, handed to the consumer in
+ * the buffers they were received into.
+ *
+ * see stream_on_socket()
+ */
+struct SocketStream
+{
+        struct StreamRange range;
+        int fd;
+        uint8_t *buffers[SOCKET_STREAM_MAX_BUFFERS];
+        size_t buffersCount;
+        size_t bufferSize;
+        /// bytes received by the last call, from the first buffer on
+        size_t received;
+        /// position in buffers of the next buffer to hand over
+        size_t nextBuffer;
+        /// calls receiving bytes from the socket
+        size_t receiveCalls;
+        struct Allocator *allocator;
+};
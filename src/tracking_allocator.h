@@ -0,0 +1,18 @@
+#pragma once
+
+#include "tracking_allocator_type.h"
+
+/// initializes a tracker with all counters at zero, allocating from parent
+void tracking_init(struct TrackingAllocator *tracker,
+                   struct Allocator *parent);
+
+/// zeroes the counters but the live bytes, and brings the peak down to them
+void tracking_reset(struct TrackingAllocator *tracker);
+
+/**
+ * attributes the allocations made by the calling thread, through any
+ * tracker, to site until the next call. NULL for no attribution.
+ *
+ * @return the previous site
+ */
+struct AllocationSite *tracking_set_site(struct AllocationSite *site);
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "allocator_type.h"
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+/**
+ * @file
+ * Decorator recording the allocations going through it.
+ */
+
+/// buckets of the size histogram, the last one taking all larger sizes
+enum { TRACKING_HISTOGRAM_SIZE = 16 };
+
+/**
+ * Allocations attributed to a part of the program, see tracking_set_site()
+ */
+struct AllocationSite
+{
+        char const *name;
+        atomic_size_t allocations;
+        atomic_size_t bytes;
+        atomic_size_t liveBytes;
+};
+
+/**
+ * Tracking allocator.
+ *
+ * Every allocation gets a header in front of it, recording its size and
+ * site, so that frees are accounted for. Counters are atomic and the
+ * allocator is safe to use from several threads when parent is.
+ *
+ * histogram[i] counts the allocations of more than 2^(i-1) and at most
+ * 2^i bytes.
+ */
+struct TrackingAllocator
+{
+        struct Allocator super;
+        struct Allocator *parent;
+        atomic_size_t allocations;
+        atomic_size_t frees;
+        atomic_size_t bytes;
+        atomic_size_t liveBytes;
+        /// high-water mark of liveBytes
+        atomic_size_t peakBytes;
+        atomic_size_t histogram[TRACKING_HISTOGRAM_SIZE];
+};
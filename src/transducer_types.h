@@ -1,6 +1,15 @@
 #pragma once
 
 struct Allocator;
+struct ValueSpan;
+
+#include <stddef.h>
+
+enum ReducerProperties {
+        /// applying the sum of some inputs gives the result of applying
+        /// them in turn, so that inputs may be summed beforehand
+        RP_ADDITIVE = 1 << 0,
+};
 
 // reducer closure
 struct Reducer
@@ -15,6 +24,27 @@ struct Reducer
         struct Value (*apply)(struct Reducer const *reducer, struct Value input,
                               struct Value current,
                               struct Allocator *allocator);
+
+        /// optional, reduces a whole span at once (see reducer_apply_batch)
+        struct Value (*apply_batch)(struct Reducer const *reducer,
+                                    struct ValueSpan span, struct Value current,
+                                    struct Allocator *allocator);
+
+        /// optional, merges results of reductions over consecutive parts of
+        /// an input (see reducer_combine)
+        struct Value (*combine)(struct Reducer const *reducer,
+                                struct Value left, struct Value right,
+                                struct Allocator *allocator);
+
+        /// ReducerProperties
+        unsigned properties;
+};
+
+/// reducer sending its results to a next step, see chainedReducerMake
+struct ChainedReducer
+{
+        struct Reducer super;
+        struct Reducer const *step;
 };
 
 /* transducers */
@@ -24,4 +54,8 @@ struct Transducer
         struct Reducer *(*apply)(struct Transducer *transducer,
                                  struct Reducer const *step,
                                  struct Allocator *allocator);
+
+        /// optional, bytes of the reducers made by apply (see
+        /// transducer_size)
+        size_t (*size)(struct Transducer const *transducer);
 };
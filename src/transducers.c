@@ -1,7 +1,13 @@
 #include "transducer_types.h"
 #include "transducers.h"
 
+#include "alignment.h"
 #include "allocator.h"
+#include "allocator_type.h"
+
+#include <assert.h>
+
+#define CHAIN_ALIGNMENT (_Alignof(max_align_t))
 
 struct Value reducer_identity(struct Reducer const *reducer,
                               struct Allocator *allocator)
@@ -29,6 +35,149 @@ struct Value reducer_apply(struct Reducer const *reducer, struct Value input,
         return reducer->apply(reducer, input, current, allocator);
 }
 
+struct Value reducer_apply_batch(struct Reducer const *reducer,
+                                 struct ValueSpan span, struct Value current,
+                                 struct Allocator *allocator)
+{
+        if (reducer->apply_batch) {
+                return reducer->apply_batch(reducer, span, current, allocator);
+        }
+
+        for (uint8_t const *element = span.start;
+             element < span.end && !isReduced(&current);
+             element += span.element_size) {
+                current = reducer_apply(
+                    reducer, valueSpanElement(&span, element), current,
+                    allocator);
+        }
+
+        return current;
+}
+
+struct Value reducer_combine(struct Reducer const *reducer, struct Value left,
+                             struct Value right, struct Allocator *allocator)
+{
+        return reducer->combine(reducer, left, right, allocator);
+}
+
+static struct ValueSpan subSpan(struct ValueSpan const *span,
+                                uint8_t const *start, uint8_t const *end)
+{
+        return (struct ValueSpan){
+            .type_tag = span->type_tag,
+            .element_size = span->element_size,
+            .start = start,
+            .end = end,
+        };
+}
+
+/// forwards to step the runs of elements accepted by reducer, as sub-spans
+static struct Value forwardAcceptedRuns(
+    struct Reducer const *reducer,
+    bool (*accepts)(struct Reducer const *reducer, struct Value input),
+    struct Reducer const *step, struct ValueSpan const span,
+    struct Value current, struct Allocator *allocator)
+{
+        uint8_t const *run = span.start;
+        for (uint8_t const *element = span.start; element < span.end;
+             element += span.element_size) {
+                if (accepts(reducer, valueSpanElement(&span, element))) {
+                        continue;
+                }
+
+                if (run < element) {
+                        current = reducer_apply_batch(
+                            step, subSpan(&span, run, element), current,
+                            allocator);
+                        if (isReduced(&current)) {
+                                return current;
+                        }
+                }
+                run = element + span.element_size;
+        }
+
+        if (run < span.end) {
+                current = reducer_apply_batch(
+                    step, subSpan(&span, run, span.end), current, allocator);
+        }
+
+        return current;
+}
+
+/* values produced one by one, gathered back into spans */
+
+enum { GATHER_CAPACITY = 256 };
+
+struct GatherBuffer
+{
+        uint32_t type_tag;
+        size_t element_size;
+        size_t count;
+        _Alignas(max_align_t) uint8_t
+            elements[GATHER_CAPACITY * sizeof(union ValueImmediate)];
+};
+
+/// false when value is boxed, of another type or when the buffer is full
+static bool gatherPush(struct GatherBuffer *buffer, struct Value const *value)
+{
+        if (!isImmediate(value) || buffer->count == GATHER_CAPACITY ||
+            value->element_size > sizeof value->immediate) {
+                return false;
+        }
+
+        if (buffer->count == 0) {
+                buffer->type_tag = value->type_tag;
+                buffer->element_size = value->element_size;
+        } else if (value->type_tag != buffer->type_tag ||
+                   value->element_size != buffer->element_size) {
+                return false;
+        }
+
+        memcpy(buffer->elements + buffer->count * buffer->element_size,
+               &value->immediate, value->element_size);
+        buffer->count++;
+
+        return true;
+}
+
+static struct Value gatherFlush(struct GatherBuffer *buffer,
+                                struct Reducer const *step,
+                                struct Value current,
+                                struct Allocator *allocator)
+{
+        if (buffer->count == 0) {
+                return current;
+        }
+
+        struct ValueSpan const span = {
+            .type_tag = buffer->type_tag,
+            .element_size = buffer->element_size,
+            .start = buffer->elements,
+            .end = buffer->elements + buffer->count * buffer->element_size,
+        };
+        buffer->count = 0;
+
+        return reducer_apply_batch(step, span, current, allocator);
+}
+
+/// sends value to step, deferred in the buffer when possible
+static struct Value gatherApply(struct GatherBuffer *buffer,
+                                struct Reducer const *step, struct Value value,
+                                struct Value current,
+                                struct Allocator *allocator)
+{
+        if (gatherPush(buffer, &value)) {
+                return current;
+        }
+
+        current = gatherFlush(buffer, step, current, allocator);
+        if (isReduced(&current) || gatherPush(buffer, &value)) {
+                return current;
+        }
+
+        return reducer_apply(step, value, current, allocator);
+}
+
 static struct Value idReducerApply(struct Reducer const *reducer,
                                    struct Value input, struct Value current,
                                    struct Allocator *allocator)
@@ -36,17 +185,48 @@ static struct Value idReducerApply(struct Reducer const *reducer,
         return input;
 }
 
+static struct Value idReducerApplyBatch(struct Reducer const *reducer,
+                                        struct ValueSpan span,
+                                        struct Value current,
+                                        struct Allocator *allocator)
+{
+        if (span.start == span.end) {
+                return current;
+        }
+
+        return valueSpanElement(&span, span.end - span.element_size);
+}
+
+/* the last value of the right part, if there was one */
+static struct Value idReducerCombine(struct Reducer const *reducer,
+                                     struct Value left, struct Value right,
+                                     struct Allocator *allocator)
+{
+        return right.type_tag == TTAG_NULL ? left : right;
+}
+
 struct Reducer *idReducer(struct Allocator *allocator)
 {
         struct Reducer *result = allocator_alloc(allocator, sizeof *result);
 
         *result = (struct Reducer){
             .apply = idReducerApply,
+            .apply_batch = idReducerApplyBatch,
+            .combine = idReducerCombine,
         };
 
         return result;
 }
 
+size_t transducer_size(struct Transducer const *transducer)
+{
+        if (!transducer->size) {
+                return 0;
+        }
+
+        return transducer->size(transducer);
+}
+
 /* return new reducer from input reducer */
 struct Reducer *transducer_apply(struct Transducer *transducer,
                                  struct Reducer const *step,
@@ -55,12 +235,6 @@ struct Reducer *transducer_apply(struct Transducer *transducer,
         return transducer->apply(transducer, step, allocator);
 }
 
-struct ChainedReducer
-{
-        struct Reducer super;
-        struct Reducer const *step;
-};
-
 static struct Value chainedReducerIdentity(struct Reducer const *reducer,
                                            struct Allocator *allocator)
 {
@@ -76,7 +250,15 @@ static struct Value chainedReducerComplete(struct Reducer const *reducer,
         return reducer_complete(self->step, result, allocator);
 }
 
-static struct ChainedReducer chainedReducerMake(
+static struct Value chainedReducerCombine(struct Reducer const *reducer,
+                                          struct Value left, struct Value right,
+                                          struct Allocator *allocator)
+{
+        struct ChainedReducer *self = (struct ChainedReducer *)reducer;
+        return reducer_combine(self->step, left, right, allocator);
+}
+
+struct ChainedReducer chainedReducerMake(
     struct Reducer const *step,
     struct Value (*reducingFn)(struct Reducer const *, struct Value,
                                struct Value, struct Allocator *))
@@ -85,6 +267,10 @@ static struct ChainedReducer chainedReducerMake(
                                             .identity = chainedReducerIdentity,
                                             .complete = chainedReducerComplete,
                                             .apply = reducingFn,
+                                            .combine =
+                                                step->combine
+                                                    ? chainedReducerCombine
+                                                    : NULL,
                                         },
                                         .step = step};
 
@@ -119,6 +305,28 @@ static struct Value filteringReducerApply(struct Reducer const *reducer,
         return current;
 }
 
+static bool filteringReducerAccepts(struct Reducer const *reducer,
+                                    struct Value const input)
+{
+        struct FilteringReducer *self = (struct FilteringReducer *)reducer;
+        return self->predicate(input, self->predicateData);
+}
+
+static struct Value filteringReducerApplyBatch(struct Reducer const *reducer,
+                                               struct ValueSpan span,
+                                               struct Value current,
+                                               struct Allocator *allocator)
+{
+        struct FilteringReducer *self = (struct FilteringReducer *)reducer;
+        return forwardAcceptedRuns(reducer, filteringReducerAccepts,
+                                   self->super.step, span, current, allocator);
+}
+
+static size_t filteringTransducerSize(struct Transducer const *transducer)
+{
+        return alignUp(sizeof(struct FilteringReducer));
+}
+
 static struct Reducer *filteringTransducerApply(struct Transducer *transducer,
                                                 struct Reducer const *step,
                                                 struct Allocator *allocator)
@@ -131,6 +339,7 @@ static struct Reducer *filteringTransducerApply(struct Transducer *transducer,
         result->predicate = self->predicate;
         result->predicateData = self->predicateData;
         result->super = chainedReducerMake(step, filteringReducerApply);
+        result->super.super.apply_batch = filteringReducerApplyBatch;
 
         return &result->super.super;
 }
@@ -147,6 +356,7 @@ filteringTransducer(bool (*predicate)(struct Value value, void *data),
                                          .predicateData = predicateData,
                                          .super = (struct Transducer){
                                              .apply = filteringTransducerApply,
+                                             .size = filteringTransducerSize,
                                          }};
 
         return &transducer->super;
@@ -182,11 +392,69 @@ static struct Value mappingReducerApply(struct Reducer const *reducer,
 {
         struct MappingReducer *self = (struct MappingReducer *)reducer;
 
-        self->reducerResult =
+        struct Value const mapped =
             reducer_apply(self->reducer, input, self->reducerResult, allocator);
+        self->reducerResult = unreduced(mapped);
 
-        return reducer_apply(self->super.step, self->reducerResult, current,
-                             allocator);
+        struct Value const result = reducer_apply(
+            self->super.step, self->reducerResult, current, allocator);
+
+        return isReduced(&mapped) ? reduced(result) : result;
+}
+
+/* the inner reducer may have effects, so each of its results is sent
+ * down before the next input is reduced, unless the next step only keeps
+ * the last one and can be given the whole span reduced at once. */
+static struct Value mappingReducerApplyBatch(struct Reducer const *reducer,
+                                             struct ValueSpan span,
+                                             struct Value current,
+                                             struct Allocator *allocator)
+{
+        struct MappingReducer *self = (struct MappingReducer *)reducer;
+
+        if (self->reducer->apply_batch &&
+            self->super.step->apply == idReducerApply) {
+                if (span.start == span.end) {
+                        return current;
+                }
+
+                struct Value const mapped = reducer_apply_batch(
+                    self->reducer, span, self->reducerResult, allocator);
+                self->reducerResult = unreduced(mapped);
+
+                struct Value const result = reducer_apply(
+                    self->super.step, self->reducerResult, current, allocator);
+
+                return isReduced(&mapped) ? reduced(result) : result;
+        }
+
+        for (uint8_t const *element = span.start;
+             element < span.end && !isReduced(&current);
+             element += span.element_size) {
+                current = mappingReducerApply(
+                    reducer, valueSpanElement(&span, element), current,
+                    allocator);
+        }
+
+        return current;
+}
+
+/* only used when the next step keeps the last value: the results are
+ * then those of the inner reducer. */
+static struct Value mappingReducerCombine(struct Reducer const *reducer,
+                                          struct Value left, struct Value right,
+                                          struct Allocator *allocator)
+{
+        struct MappingReducer *self = (struct MappingReducer *)reducer;
+
+        if (left.type_tag == TTAG_NULL) {
+                return right;
+        }
+        if (right.type_tag == TTAG_NULL) {
+                return left;
+        }
+
+        return reducer_combine(self->reducer, left, right, allocator);
 }
 
 static struct Reducer *newMappingReducer(struct Reducer const *reducer,
@@ -203,10 +471,25 @@ static struct Reducer *newMappingReducer(struct Reducer const *reducer,
         };
 
         result->super.super.complete = mappingReducerComplete;
+        result->super.super.apply_batch = mappingReducerApplyBatch;
+        result->super.super.combine =
+            reducer->combine && step->apply == idReducerApply
+                ? mappingReducerCombine
+                : NULL;
+        /* the next step then only sees the results of the inner reducer */
+        if (step->apply == idReducerApply) {
+                result->super.super.properties =
+                    reducer->properties & RP_ADDITIVE;
+        }
 
         return &result->super.super;
 }
 
+static size_t mappingTransducerSize(struct Transducer const *transducer)
+{
+        return alignUp(sizeof(struct MappingReducer));
+}
+
 static struct Reducer *mappingTransducerApply(struct Transducer *transducer,
                                               struct Reducer const *step,
                                               struct Allocator *allocator)
@@ -223,7 +506,7 @@ struct Transducer *mappingTransducer(struct Reducer *reducer,
             allocator_alloc(allocator, sizeof *result);
 
         result->super = (struct Transducer){
-            mappingTransducerApply,
+            mappingTransducerApply, mappingTransducerSize,
         };
 
         result->reducer = reducer;
@@ -262,6 +545,37 @@ static struct Value mappingFnReducerApply(struct Reducer const *reducer,
             allocator);
 }
 
+/* mapped values are gathered into spans for the next step */
+static struct Value mappingFnReducerApplyBatch(struct Reducer const *reducer,
+                                               struct ValueSpan span,
+                                               struct Value current,
+                                               struct Allocator *allocator)
+{
+        struct MappingFnReducer *self = (struct MappingFnReducer *)reducer;
+        struct GatherBuffer buffer;
+        buffer.count = 0;
+
+        for (uint8_t const *element = span.start;
+             element < span.end && !isReduced(&current);
+             element += span.element_size) {
+                struct Value const mapped = self->input.mapperFn(
+                    valueSpanElement(&span, element), self->input.mapperData);
+                current = gatherApply(&buffer, self->super.step, mapped,
+                                      current, allocator);
+        }
+
+        if (isReduced(&current)) {
+                return current;
+        }
+
+        return gatherFlush(&buffer, self->super.step, current, allocator);
+}
+
+static size_t mappingFnTransducerSize(struct Transducer const *transducer)
+{
+        return alignUp(sizeof(struct MappingFnReducer));
+}
+
 static struct Reducer *mappingFnTransducerApply(struct Transducer *transducer,
                                                 struct Reducer const *step,
                                                 struct Allocator *allocator)
@@ -272,6 +586,7 @@ static struct Reducer *mappingFnTransducerApply(struct Transducer *transducer,
         struct MappingFnReducer *result =
             allocator_alloc(allocator, sizeof *result);
         result->super = chainedReducerMake(step, mappingFnReducerApply);
+        result->super.super.apply_batch = mappingFnReducerApplyBatch;
         result->input = self->input;
 
         return &result->super.super;
@@ -285,7 +600,7 @@ mappingFnTransducer(struct Value (*mapperFn)(struct Value, void *data),
             allocator_alloc(allocator, sizeof *result);
 
         result->super = (struct Transducer){
-            mappingFnTransducerApply,
+            mappingFnTransducerApply, mappingFnTransducerSize,
         };
 
         result->input = (struct MappingFnInput){
@@ -295,23 +610,1223 @@ mappingFnTransducer(struct Value (*mapperFn)(struct Value, void *data),
         return &result->super;
 }
 
-struct ComposingTransducer
+/* windows of values, sent down as spans over storage inside the reducer.
+ *
+ * sliding windows write each value twice, n slots apart, so that the last
+ * n values are always contiguous. */
+
+struct WindowingTransducer
 {
         struct Transducer super;
-        struct Transducer **transducers;
-        size_t transducersCount;
+        /// values in a full window
+        size_t size;
+        /// values between the starts of two windows
+        size_t step;
+        size_t elementSize;
+        bool sliding;
+        uint64_t period;
+        uint64_t (*timeOf)(struct Value value, void *data);
+        void *timeData;
 };
 
-static struct Reducer *composingTransducerApply(struct Transducer *transducer,
+struct WindowingReducer
+{
+        struct ChainedReducer super;
+        struct WindowingTransducer const *params;
+        uint32_t type_tag;
+        /// values in the storage, or went through for sliding windows
+        size_t count;
+        uint64_t windowStart;
+        max_align_t storage[];
+};
+
+static size_t windowingStorageSize(struct WindowingTransducer const *params)
+{
+        return (params->sliding ? 2 : 1) * params->size * params->elementSize;
+}
+
+static struct Value windowingReducerEmit(struct WindowingReducer const *self,
+                                         uint8_t const *start, size_t count,
+                                         struct Value current,
+                                         struct Allocator *allocator)
+{
+        struct ValueSpan const span = {
+            .type_tag = self->type_tag,
+            .element_size = self->params->elementSize,
+            .start = start,
+            .end = start + count * self->params->elementSize,
+        };
+
+        return reducer_apply(self->super.step, spanValue(&span), current,
+                             allocator);
+}
+
+static struct Value windowingReducerFlush(struct WindowingReducer *self,
+                                          struct Value current,
+                                          struct Allocator *allocator)
+{
+        size_t const count = self->count;
+        self->count = 0;
+
+        return windowingReducerEmit(self, (uint8_t const *)self->storage,
+                                    count, current, allocator);
+}
+
+static struct Value windowingReducerApply(struct Reducer const *reducer,
+                                          struct Value input,
+                                          struct Value current,
+                                          struct Allocator *allocator)
+{
+        struct WindowingReducer *self = (struct WindowingReducer *)reducer;
+        struct WindowingTransducer const *params = self->params;
+        uint8_t *storage = (uint8_t *)self->storage;
+        size_t const elementSize = params->elementSize;
+
+        /* a window only ever holds values of one size and type */
+        if (input.element_size != elementSize) {
+                return current;
+        }
+        if (self->count == 0) {
+                self->type_tag = input.type_tag;
+        } else if (input.type_tag != self->type_tag) {
+                return current;
+        }
+
+        if (params->sliding) {
+                size_t const slot = self->count % params->size;
+                void const *payload = valuePayload(&input);
+                memcpy(storage + slot * elementSize, payload, elementSize);
+                memcpy(storage + (slot + params->size) * elementSize, payload,
+                       elementSize);
+                self->count++;
+
+                if (self->count < params->size ||
+                    (self->count - params->size) % params->step != 0) {
+                        return current;
+                }
+
+                return windowingReducerEmit(
+                    self, storage + self->count % params->size * elementSize,
+                    params->size, current, allocator);
+        }
+
+        if (params->timeOf) {
+                uint64_t const time = params->timeOf(input, params->timeData);
+                uint64_t const windowStart = time - time % params->period;
+                if (self->count > 0 && windowStart != self->windowStart) {
+                        current = windowingReducerFlush(self, current,
+                                                        allocator);
+                        if (isReduced(&current)) {
+                                return current;
+                        }
+                }
+                self->windowStart = windowStart;
+        }
+
+        memcpy(storage + self->count * elementSize, valuePayload(&input),
+               elementSize);
+        self->count++;
+        if (self->count < params->size) {
+                return current;
+        }
+
+        return windowingReducerFlush(self, current, allocator);
+}
+
+/* partitions of n in the batch are sent down without being copied */
+static struct Value windowingReducerApplyBatch(struct Reducer const *reducer,
+                                               struct ValueSpan span,
+                                               struct Value current,
+                                               struct Allocator *allocator)
+{
+        struct WindowingReducer *self = (struct WindowingReducer *)reducer;
+        struct WindowingTransducer const *params = self->params;
+        size_t const partitionSize = params->size * params->elementSize;
+        bool const inPlace = !params->sliding && !params->timeOf &&
+                             span.element_size == params->elementSize;
+
+        uint8_t const *element = span.start;
+        while (element < span.end && !isReduced(&current)) {
+                if (inPlace && self->count == 0 &&
+                    (size_t)(span.end - element) >= partitionSize) {
+                        self->type_tag = span.type_tag;
+                        current = windowingReducerEmit(
+                            self, element, params->size, current, allocator);
+                        element += partitionSize;
+                        continue;
+                }
+
+                current = windowingReducerApply(
+                    reducer, valueSpanElement(&span, element), current,
+                    allocator);
+                element += span.element_size;
+        }
+
+        return current;
+}
+
+static struct Value windowingReducerComplete(struct Reducer const *reducer,
+                                             struct Value result,
+                                             struct Allocator *allocator)
+{
+        struct WindowingReducer *self = (struct WindowingReducer *)reducer;
+
+        if (!self->params->sliding && self->count > 0) {
+                result =
+                    unreduced(windowingReducerFlush(self, result, allocator));
+        }
+
+        return reducer_complete(self->super.step, result, allocator);
+}
+
+static size_t windowingTransducerSize(struct Transducer const *transducer)
+{
+        struct WindowingTransducer const *self =
+            (struct WindowingTransducer const *)transducer;
+
+        return alignUp(sizeof(struct WindowingReducer) +
+                            windowingStorageSize(self));
+}
+
+static struct Reducer *windowingTransducerApply(struct Transducer *transducer,
                                                 struct Reducer const *step,
                                                 struct Allocator *allocator)
 {
-        struct ComposingTransducer *self =
-            (struct ComposingTransducer *)transducer;
-        struct Reducer *x = (struct Reducer *)step;
-        for (size_t i = 0; i < self->transducersCount; i++) {
-                size_t idx = self->transducersCount - 1 - i;
-                x = transducer_apply(self->transducers[idx], x, allocator);
+        struct WindowingTransducer *self =
+            (struct WindowingTransducer *)transducer;
+        struct WindowingReducer *result = allocator_alloc(
+            allocator, sizeof *result + windowingStorageSize(self));
+
+        *result = (struct WindowingReducer){
+            .super = chainedReducerMake(step, windowingReducerApply),
+            .params = self,
+        };
+        result->super.super.complete = windowingReducerComplete;
+        result->super.super.apply_batch = windowingReducerApplyBatch;
+        /* windows may span the parts of a split input */
+        result->super.super.combine = NULL;
+
+        return &result->super.super;
+}
+
+static struct Transducer *
+newWindowingTransducer(struct WindowingTransducer const params,
+                       struct Allocator *allocator)
+{
+        struct WindowingTransducer *result =
+            allocator_alloc(allocator, sizeof *result);
+
+        *result = params;
+        result->super = (struct Transducer){
+            windowingTransducerApply, windowingTransducerSize,
+        };
+
+        return &result->super;
+}
+
+struct Transducer *partitioningTransducer(size_t n, size_t elementSize,
+                                          struct Allocator *allocator)
+{
+        assert(n > 0);
+        return newWindowingTransducer(
+            (struct WindowingTransducer){
+                .size = n, .step = n, .elementSize = elementSize,
+            },
+            allocator);
+}
+
+struct Transducer *slidingWindowTransducer(size_t n, size_t step,
+                                           size_t elementSize,
+                                           struct Allocator *allocator)
+{
+        assert(n > 0 && step > 0);
+        return newWindowingTransducer(
+            (struct WindowingTransducer){
+                .size = n,
+                .step = step,
+                .elementSize = elementSize,
+                .sliding = true,
+            },
+            allocator);
+}
+
+struct Transducer *
+timeWindowTransducer(uint64_t period,
+                     uint64_t (*timeOf)(struct Value value, void *data),
+                     void *timeData, size_t capacity, size_t elementSize,
+                     struct Allocator *allocator)
+{
+        assert(period > 0 && capacity > 0);
+        return newWindowingTransducer(
+            (struct WindowingTransducer){
+                .size = capacity,
+                .step = capacity,
+                .elementSize = elementSize,
+                .period = period,
+                .timeOf = timeOf,
+                .timeData = timeData,
+            },
+            allocator);
+}
+
+struct SpanReducingTransducer
+{
+        struct Transducer super;
+        struct Reducer const *reducer;
+};
+
+struct SpanReducingReducer
+{
+        struct ChainedReducer super;
+        struct Reducer const *reducer;
+};
+
+static struct Value spanReducingReducerApply(struct Reducer const *reducer,
+                                             struct Value input,
+                                             struct Value current,
+                                             struct Allocator *allocator)
+{
+        struct SpanReducingReducer *self =
+            (struct SpanReducingReducer *)reducer;
+
+        assert(input.type_tag == TTAG_SPAN);
+        struct Value result = reducer_identity(self->reducer, allocator);
+        result = reducer_apply_batch(self->reducer, valueSpan(&input), result,
+                                     allocator);
+        result = reducer_complete(self->reducer, unreduced(result), allocator);
+
+        return reducer_apply(self->super.step, result, current, allocator);
+}
+
+static size_t spanReducingTransducerSize(struct Transducer const *transducer)
+{
+        return alignUp(sizeof(struct SpanReducingReducer));
+}
+
+static struct Reducer *
+spanReducingTransducerApply(struct Transducer *transducer,
+                            struct Reducer const *step,
+                            struct Allocator *allocator)
+{
+        struct SpanReducingTransducer *self =
+            (struct SpanReducingTransducer *)transducer;
+        struct SpanReducingReducer *result =
+            allocator_alloc(allocator, sizeof *result);
+
+        *result = (struct SpanReducingReducer){
+            .super = chainedReducerMake(step, spanReducingReducerApply),
+            .reducer = self->reducer,
+        };
+
+        return &result->super.super;
+}
+
+struct Transducer *spanReducingTransducer(struct Reducer const *reducer,
+                                          struct Allocator *allocator)
+{
+        struct SpanReducingTransducer *result =
+            allocator_alloc(allocator, sizeof *result);
+
+        *result = (struct SpanReducingTransducer){
+            .super =
+                (struct Transducer){
+                    spanReducingTransducerApply, spanReducingTransducerSize,
+                },
+            .reducer = reducer,
+        };
+
+        return &result->super;
+}
+
+/* stages counting or remembering values, with their state in the reducer.
+ * positions matter to them, so they have no combine. */
+
+struct PositionalTransducer
+{
+        struct Transducer super;
+        size_t n;
+};
+
+struct PositionalReducer
+{
+        struct ChainedReducer super;
+        /// values still to take or drop
+        size_t left;
+};
+
+static size_t positionalTransducerSize(struct Transducer const *transducer)
+{
+        return alignUp(sizeof(struct PositionalReducer));
+}
+
+static struct Reducer *newPositionalReducer(
+    struct Transducer *transducer, struct Reducer const *step,
+    struct Value (*reducingFn)(struct Reducer const *, struct Value,
+                               struct Value, struct Allocator *),
+    struct Value (*batchFn)(struct Reducer const *, struct ValueSpan,
+                            struct Value, struct Allocator *),
+    struct Allocator *allocator)
+{
+        struct PositionalTransducer *self =
+            (struct PositionalTransducer *)transducer;
+        struct PositionalReducer *result =
+            allocator_alloc(allocator, sizeof *result);
+
+        *result = (struct PositionalReducer){
+            .super = chainedReducerMake(step, reducingFn), .left = self->n,
+        };
+        result->super.super.apply_batch = batchFn;
+        result->super.super.combine = NULL;
+
+        return &result->super.super;
+}
+
+static struct Transducer *newPositionalTransducer(
+    struct Reducer *(*apply)(struct Transducer *, struct Reducer const *,
+                             struct Allocator *),
+    size_t const n, struct Allocator *allocator)
+{
+        struct PositionalTransducer *result =
+            allocator_alloc(allocator, sizeof *result);
+
+        *result = (struct PositionalTransducer){
+            .super = (struct Transducer){apply, positionalTransducerSize},
+            .n = n,
+        };
+
+        return &result->super;
+}
+
+static struct Value takingReducerApply(struct Reducer const *reducer,
+                                       struct Value input, struct Value current,
+                                       struct Allocator *allocator)
+{
+        struct PositionalReducer *self =
+            (struct PositionalReducer *)reducer;
+        if (self->left == 0) {
+                return reduced(current);
+        }
+
+        current = reducer_apply(self->super.step, input, current, allocator);
+        return --self->left == 0 ? reduced(current) : current;
+}
+
+static struct Value takingReducerApplyBatch(struct Reducer const *reducer,
+                                            struct ValueSpan span,
+                                            struct Value current,
+                                            struct Allocator *allocator)
+{
+        struct PositionalReducer *self =
+            (struct PositionalReducer *)reducer;
+        if (self->left == 0) {
+                return reduced(current);
+        }
+
+        size_t const count = valueSpanCount(&span);
+        size_t const taken = count < self->left ? count : self->left;
+        self->left -= taken;
+        current = reducer_apply_batch(
+            self->super.step,
+            subSpan(&span, span.start,
+                    span.start + taken * span.element_size),
+            current, allocator);
+
+        return self->left == 0 ? reduced(current) : current;
+}
+
+static struct Reducer *takingTransducerApply(struct Transducer *transducer,
+                                             struct Reducer const *step,
+                                             struct Allocator *allocator)
+{
+        return newPositionalReducer(transducer, step, takingReducerApply,
+                                       takingReducerApplyBatch, allocator);
+}
+
+struct Transducer *takingTransducer(size_t n, struct Allocator *allocator)
+{
+        return newPositionalTransducer(takingTransducerApply, n, allocator);
+}
+
+static struct Value droppingReducerApply(struct Reducer const *reducer,
+                                         struct Value input,
+                                         struct Value current,
+                                         struct Allocator *allocator)
+{
+        struct PositionalReducer *self =
+            (struct PositionalReducer *)reducer;
+        if (self->left > 0) {
+                self->left--;
+                return current;
+        }
+
+        return reducer_apply(self->super.step, input, current, allocator);
+}
+
+static struct Value droppingReducerApplyBatch(struct Reducer const *reducer,
+                                              struct ValueSpan span,
+                                              struct Value current,
+                                              struct Allocator *allocator)
+{
+        struct PositionalReducer *self =
+            (struct PositionalReducer *)reducer;
+
+        size_t const count = valueSpanCount(&span);
+        size_t const dropped = count < self->left ? count : self->left;
+        self->left -= dropped;
+        if (dropped == count) {
+                return current;
+        }
+
+        return reducer_apply_batch(
+            self->super.step,
+            subSpan(&span, span.start + dropped * span.element_size,
+                    span.end),
+            current, allocator);
+}
+
+static struct Reducer *droppingTransducerApply(struct Transducer *transducer,
+                                               struct Reducer const *step,
+                                               struct Allocator *allocator)
+{
+        return newPositionalReducer(transducer, step, droppingReducerApply,
+                                       droppingReducerApplyBatch, allocator);
+}
+
+struct Transducer *droppingTransducer(size_t n, struct Allocator *allocator)
+{
+        return newPositionalTransducer(droppingTransducerApply, n, allocator);
+}
+
+/* take-while shares the filtering transducer and its predicate */
+
+static struct Value takingWhileReducerApply(struct Reducer const *reducer,
+                                            struct Value const input,
+                                            struct Value const current,
+                                            struct Allocator *allocator)
+{
+        struct FilteringReducer *self = (struct FilteringReducer *)reducer;
+        if (!self->predicate(input, self->predicateData)) {
+                return reduced(current);
+        }
+
+        return reducer_apply(self->super.step, input, current, allocator);
+}
+
+static struct Value takingWhileReducerApplyBatch(struct Reducer const *reducer,
+                                                 struct ValueSpan span,
+                                                 struct Value current,
+                                                 struct Allocator *allocator)
+{
+        struct FilteringReducer *self = (struct FilteringReducer *)reducer;
+
+        uint8_t const *element = span.start;
+        while (element < span.end &&
+               self->predicate(valueSpanElement(&span, element),
+                               self->predicateData)) {
+                element += span.element_size;
+        }
+
+        if (span.start < element) {
+                current = reducer_apply_batch(
+                    self->super.step, subSpan(&span, span.start, element),
+                    current, allocator);
+        }
+
+        return element < span.end ? reduced(current) : current;
+}
+
+static struct Reducer *
+takingWhileTransducerApply(struct Transducer *transducer,
+                           struct Reducer const *step,
+                           struct Allocator *allocator)
+{
+        struct Reducer *result =
+            filteringTransducerApply(transducer, step, allocator);
+        result->apply = takingWhileReducerApply;
+        result->apply_batch = takingWhileReducerApplyBatch;
+        result->combine = NULL;
+
+        return result;
+}
+
+struct Transducer *
+takingWhileTransducer(bool (*predicate)(struct Value value, void *data),
+                      void *predicateData, struct Allocator *allocator)
+{
+        struct Transducer *result =
+            filteringTransducer(predicate, predicateData, allocator);
+        result->apply = takingWhileTransducerApply;
+
+        return result;
+}
+
+struct DedupingTransducer
+{
+        struct Transducer super;
+        size_t elementSize;
+};
+
+struct DedupingReducer
+{
+        struct ChainedReducer super;
+        size_t storageSize;
+        bool hasLast;
+        uint32_t lastTypeTag;
+        size_t lastElementSize;
+        max_align_t last[];
+};
+
+/// false for repeats of the previous value, which becomes input
+static bool dedupingReducerAccepts(struct Reducer const *reducer,
+                                   struct Value const input)
+{
+        struct DedupingReducer *self = (struct DedupingReducer *)reducer;
+        void const *payload = valuePayload(&input);
+
+        bool const repeated =
+            self->hasLast && input.type_tag == self->lastTypeTag &&
+            input.element_size == self->lastElementSize &&
+            memcmp(payload, self->last, input.element_size) == 0;
+
+        if (input.element_size <= self->storageSize) {
+                memcpy(self->last, payload, input.element_size);
+                self->hasLast = true;
+        } else {
+                self->hasLast = false;
+        }
+        self->lastTypeTag = input.type_tag;
+        self->lastElementSize = input.element_size;
+
+        return !repeated;
+}
+
+static struct Value dedupingReducerApply(struct Reducer const *reducer,
+                                         struct Value const input,
+                                         struct Value const current,
+                                         struct Allocator *allocator)
+{
+        struct DedupingReducer *self = (struct DedupingReducer *)reducer;
+        if (!dedupingReducerAccepts(reducer, input)) {
+                return current;
+        }
+
+        return reducer_apply(self->super.step, input, current, allocator);
+}
+
+static struct Value dedupingReducerApplyBatch(struct Reducer const *reducer,
+                                              struct ValueSpan span,
+                                              struct Value current,
+                                              struct Allocator *allocator)
+{
+        struct DedupingReducer *self = (struct DedupingReducer *)reducer;
+        return forwardAcceptedRuns(reducer, dedupingReducerAccepts,
+                                   self->super.step, span, current, allocator);
+}
+
+static size_t dedupingTransducerSize(struct Transducer const *transducer)
+{
+        struct DedupingTransducer const *self =
+            (struct DedupingTransducer const *)transducer;
+
+        return alignUp(sizeof(struct DedupingReducer) + self->elementSize);
+}
+
+static struct Reducer *dedupingTransducerApply(struct Transducer *transducer,
+                                               struct Reducer const *step,
+                                               struct Allocator *allocator)
+{
+        struct DedupingTransducer *self =
+            (struct DedupingTransducer *)transducer;
+        struct DedupingReducer *result =
+            allocator_alloc(allocator, sizeof *result + self->elementSize);
+
+        *result = (struct DedupingReducer){
+            .super = chainedReducerMake(step, dedupingReducerApply),
+            .storageSize = self->elementSize,
+        };
+        result->super.super.apply_batch = dedupingReducerApplyBatch;
+        result->super.super.combine = NULL;
+
+        return &result->super.super;
+}
+
+struct Transducer *dedupingTransducer(size_t elementSize,
+                                      struct Allocator *allocator)
+{
+        struct DedupingTransducer *result =
+            allocator_alloc(allocator, sizeof *result);
+
+        *result = (struct DedupingTransducer){
+            .super =
+                (struct Transducer){
+                    dedupingTransducerApply, dedupingTransducerSize,
+                },
+            .elementSize = elementSize,
+        };
+
+        return &result->super;
+}
+
+/* columnar batches, see struct ValueBatch.
+ *
+ * side columns are built in storage of the reducers, GATHER_CAPACITY
+ * elements at a time. */
+
+static struct ValueBatch subBatch(struct ValueBatch const *batch,
+                                  size_t const start, size_t const end)
+{
+        size_t const elementSize = batch->values.element_size;
+        return (struct ValueBatch){
+            .values = subSpan(&batch->values,
+                              batch->values.start + start * elementSize,
+                              batch->values.start + end * elementSize),
+            .indices = batch->indices ? batch->indices + start : NULL,
+            .validity = batch->validity ? batch->validity + start : NULL,
+        };
+}
+
+struct IndexingReducer
+{
+        struct ChainedReducer super;
+        size_t next;
+        size_t indices[GATHER_CAPACITY];
+};
+
+static struct Value indexingReducerApplyBatch(struct Reducer const *reducer,
+                                              struct ValueSpan span,
+                                              struct Value current,
+                                              struct Allocator *allocator)
+{
+        struct IndexingReducer *self = (struct IndexingReducer *)reducer;
+
+        size_t const count = valueSpanCount(&span);
+        for (size_t start = 0; start < count && !isReduced(&current);
+             start += GATHER_CAPACITY) {
+                size_t const n = count - start < GATHER_CAPACITY
+                                     ? count - start
+                                     : GATHER_CAPACITY;
+                for (size_t i = 0; i < n; i++) {
+                        self->indices[i] = self->next++;
+                }
+
+                struct ValueBatch const batch = {
+                    .values = subSpan(
+                        &span, span.start + start * span.element_size,
+                        span.start + (start + n) * span.element_size),
+                    .indices = self->indices,
+                };
+                current = reducer_apply(self->super.step, batchValue(&batch),
+                                        current, allocator);
+        }
+
+        return current;
+}
+
+static struct Value indexingReducerApply(struct Reducer const *reducer,
+                                         struct Value input,
+                                         struct Value current,
+                                         struct Allocator *allocator)
+{
+        struct ValueSpan const span = {
+            .type_tag = input.type_tag,
+            .element_size = input.element_size,
+            .start = valuePayload(&input),
+            .end = (uint8_t const *)valuePayload(&input) + input.element_size,
+        };
+
+        return indexingReducerApplyBatch(reducer, span, current, allocator);
+}
+
+static size_t indexingTransducerSize(struct Transducer const *transducer)
+{
+        return alignUp(sizeof(struct IndexingReducer));
+}
+
+static struct Reducer *indexingTransducerApply(struct Transducer *transducer,
+                                               struct Reducer const *step,
+                                               struct Allocator *allocator)
+{
+        struct IndexingReducer *result =
+            allocator_alloc(allocator, sizeof *result);
+
+        result->super = chainedReducerMake(step, indexingReducerApply);
+        result->super.super.apply_batch = indexingReducerApplyBatch;
+        result->super.super.combine = NULL;
+        result->next = 0;
+
+        return &result->super.super;
+}
+
+struct Transducer *indexingTransducer(struct Allocator *allocator)
+{
+        struct Transducer *result = allocator_alloc(allocator, sizeof *result);
+
+        *result = (struct Transducer){
+            indexingTransducerApply, indexingTransducerSize,
+        };
+
+        return result;
+}
+
+struct IndexRangeTransducer
+{
+        struct Transducer super;
+        size_t start;
+        size_t end;
+};
+
+struct IndexRangeReducer
+{
+        struct ChainedReducer super;
+        size_t start;
+        size_t end;
+        uint8_t validity[GATHER_CAPACITY];
+};
+
+static struct Value indexRangeReducerApply(struct Reducer const *reducer,
+                                           struct Value input,
+                                           struct Value current,
+                                           struct Allocator *allocator)
+{
+        struct IndexRangeReducer *self = (struct IndexRangeReducer *)reducer;
+
+        assert(input.type_tag == TTAG_BATCH);
+        struct ValueBatch const batch = valueBatch(&input);
+        assert(batch.indices);
+
+        size_t const count = valueBatchCount(&batch);
+        bool done = false;
+        for (size_t start = 0; start < count && !done;
+             start += GATHER_CAPACITY) {
+                size_t const n = count - start < GATHER_CAPACITY
+                                     ? count - start
+                                     : GATHER_CAPACITY;
+                struct ValueBatch part = subBatch(&batch, start, start + n);
+                for (size_t i = 0; i < n; i++) {
+                        size_t const index = part.indices[i];
+                        bool const present =
+                            !part.validity || part.validity[i] != 0;
+                        self->validity[i] = present && index >= self->start &&
+                                            index < self->end;
+                        done |= index + 1 >= self->end;
+                }
+                part.validity = self->validity;
+
+                current = reducer_apply(self->super.step, batchValue(&part),
+                                        current, allocator);
+                if (isReduced(&current)) {
+                        return current;
+                }
+        }
+
+        return done ? reduced(current) : current;
+}
+
+static size_t indexRangeTransducerSize(struct Transducer const *transducer)
+{
+        return alignUp(sizeof(struct IndexRangeReducer));
+}
+
+static struct Reducer *indexRangeTransducerApply(struct Transducer *transducer,
+                                                 struct Reducer const *step,
+                                                 struct Allocator *allocator)
+{
+        struct IndexRangeTransducer *self =
+            (struct IndexRangeTransducer *)transducer;
+        struct IndexRangeReducer *result =
+            allocator_alloc(allocator, sizeof *result);
+
+        result->super = chainedReducerMake(step, indexRangeReducerApply);
+        result->super.super.combine = NULL;
+        result->start = self->start;
+        result->end = self->end;
+
+        return &result->super.super;
+}
+
+struct Transducer *indexRangeTransducer(size_t start, size_t end,
+                                        struct Allocator *allocator)
+{
+        struct IndexRangeTransducer *result =
+            allocator_alloc(allocator, sizeof *result);
+
+        *result = (struct IndexRangeTransducer){
+            .super =
+                (struct Transducer){
+                    indexRangeTransducerApply, indexRangeTransducerSize,
+                },
+            .start = start,
+            .end = end,
+        };
+
+        return &result->super;
+}
+
+static struct Value unwrappingReducerApply(struct Reducer const *reducer,
+                                           struct Value input,
+                                           struct Value current,
+                                           struct Allocator *allocator)
+{
+        struct ChainedReducer *self = (struct ChainedReducer *)reducer;
+
+        assert(input.type_tag == TTAG_BATCH);
+        struct ValueBatch const batch = valueBatch(&input);
+        if (!batch.validity) {
+                return reducer_apply_batch(self->step, batch.values, current,
+                                           allocator);
+        }
+
+        size_t const count = valueBatchCount(&batch);
+        size_t run = 0;
+        for (size_t i = 0; i <= count; i++) {
+                if (i < count && batch.validity[i] != 0) {
+                        continue;
+                }
+
+                if (run < i) {
+                        struct ValueBatch const present =
+                            subBatch(&batch, run, i);
+                        current = reducer_apply_batch(
+                            self->step, present.values, current, allocator);
+                        if (isReduced(&current)) {
+                                return current;
+                        }
+                }
+                run = i + 1;
+        }
+
+        return current;
+}
+
+static size_t unwrappingTransducerSize(struct Transducer const *transducer)
+{
+        return alignUp(sizeof(struct ChainedReducer));
+}
+
+static struct Reducer *unwrappingTransducerApply(struct Transducer *transducer,
+                                                 struct Reducer const *step,
+                                                 struct Allocator *allocator)
+{
+        struct ChainedReducer *result =
+            allocator_alloc(allocator, sizeof *result);
+
+        *result = chainedReducerMake(step, unwrappingReducerApply);
+
+        return &result->super;
+}
+
+struct Transducer *unwrappingTransducer(struct Allocator *allocator)
+{
+        struct Transducer *result = allocator_alloc(allocator, sizeof *result);
+
+        *result = (struct Transducer){
+            unwrappingTransducerApply, unwrappingTransducerSize,
+        };
+
+        return result;
+}
+
+/* fusion of adjacent mapping-fn and filtering stages into one reducer */
+
+struct FusedStage
+{
+        struct Value (*mapperFn)(struct Value, void *data);
+        bool (*predicate)(struct Value value, void *data);
+        void *data;
+};
+
+struct FusedReducer
+{
+        struct ChainedReducer super;
+        bool mapsValues;
+        size_t stagesCount;
+        struct FusedStage stages[];
+};
+
+static bool isFusable(struct Transducer const *transducer)
+{
+        return transducer->apply == filteringTransducerApply ||
+               transducer->apply == mappingFnTransducerApply;
+}
+
+static struct FusedStage fusedStageMake(struct Transducer *transducer)
+{
+        if (transducer->apply == filteringTransducerApply) {
+                struct FilteringTransducer *filtering =
+                    (struct FilteringTransducer *)transducer;
+                return (struct FusedStage){
+                    .predicate = filtering->predicate,
+                    .data = filtering->predicateData,
+                };
+        }
+
+        struct MappingFnTransducer *mapping =
+            (struct MappingFnTransducer *)transducer;
+        return (struct FusedStage){
+            .mapperFn = mapping->input.mapperFn,
+            .data = mapping->input.mapperData,
+        };
+}
+
+/// runs all stages on input, false when one of them dropped it
+static bool fusedReducerRun(struct FusedReducer const *self,
+                            struct Value *input)
+{
+        for (size_t i = 0; i < self->stagesCount; i++) {
+                struct FusedStage const *stage = &self->stages[i];
+                if (stage->mapperFn) {
+                        *input = stage->mapperFn(*input, stage->data);
+                } else if (!stage->predicate(*input, stage->data)) {
+                        return false;
+                }
+        }
+
+        return true;
+}
+
+static bool fusedReducerAccepts(struct Reducer const *reducer,
+                                struct Value input)
+{
+        return fusedReducerRun((struct FusedReducer const *)reducer, &input);
+}
+
+static struct Value fusedReducerApply(struct Reducer const *reducer,
+                                      struct Value input, struct Value current,
+                                      struct Allocator *allocator)
+{
+        struct FusedReducer *self = (struct FusedReducer *)reducer;
+        if (!fusedReducerRun(self, &input)) {
+                return current;
+        }
+
+        return reducer_apply(self->super.step, input, current, allocator);
+}
+
+static struct Value fusedReducerApplyBatch(struct Reducer const *reducer,
+                                           struct ValueSpan span,
+                                           struct Value current,
+                                           struct Allocator *allocator)
+{
+        struct FusedReducer *self = (struct FusedReducer *)reducer;
+        if (!self->mapsValues) {
+                return forwardAcceptedRuns(reducer, fusedReducerAccepts,
+                                           self->super.step, span, current,
+                                           allocator);
+        }
+
+        struct GatherBuffer buffer;
+        buffer.count = 0;
+
+        for (uint8_t const *element = span.start;
+             element < span.end && !isReduced(&current);
+             element += span.element_size) {
+                struct Value input = valueSpanElement(&span, element);
+                if (fusedReducerRun(self, &input)) {
+                        current = gatherApply(&buffer, self->super.step, input,
+                                              current, allocator);
+                }
+        }
+
+        if (isReduced(&current)) {
+                return current;
+        }
+
+        return gatherFlush(&buffer, self->super.step, current, allocator);
+}
+
+static size_t fusedReducerSize(size_t const transducersCount)
+{
+        return alignUp(sizeof(struct FusedReducer) +
+                            transducersCount * sizeof(struct FusedStage));
+}
+
+static struct Reducer *newFusedReducer(struct Transducer **transducers,
+                                       size_t const transducersCount,
+                                       struct Reducer const *step,
+                                       struct Allocator *allocator)
+{
+        struct FusedReducer *result = allocator_alloc(
+            allocator,
+            sizeof *result + transducersCount * sizeof result->stages[0]);
+
+        result->super = chainedReducerMake(step, fusedReducerApply);
+        result->super.super.apply_batch = fusedReducerApplyBatch;
+        result->mapsValues = false;
+        result->stagesCount = transducersCount;
+        for (size_t i = 0; i < transducersCount; i++) {
+                result->stages[i] = fusedStageMake(transducers[i]);
+                result->mapsValues |= result->stages[i].mapperFn != NULL;
+        }
+
+        return &result->super.super;
+}
+
+struct ComposingTransducer
+{
+        struct Transducer super;
+        struct Transducer **transducers;
+        size_t transducersCount;
+};
+
+/* the reducers of a composition live in one block, which starts with the
+ * allocator that hands out its windows. once the chain is built, the
+ * window is empty and allocations go to the parent. */
+
+struct ChainAllocator
+{
+        struct Allocator super;
+        struct Allocator *parent;
+        uint8_t *blockStart;
+        uint8_t *blockEnd;
+        uint8_t *cursor;
+        uint8_t *end;
+};
+
+static void *chainAllocAligned(struct Allocator *allocator, size_t size,
+                               size_t alignment)
+{
+        struct ChainAllocator *self = (struct ChainAllocator *)allocator;
+
+        size = alignUp(size ? size : 1);
+        size_t const padding =
+            (alignment - (uintptr_t)self->cursor % alignment) % alignment;
+        if (padding + size <= (size_t)(self->end - self->cursor)) {
+                void *result = self->cursor + padding;
+                self->cursor += padding + size;
+                return result;
+        }
+
+        return allocator_alloc_aligned(self->parent, size, alignment);
+}
+
+static void *chainAlloc(struct Allocator *allocator, size_t size)
+{
+        return chainAllocAligned(allocator, size, CHAIN_ALIGNMENT);
+}
+
+static void chainFree(struct Allocator *allocator, void *ptr)
+{
+        struct ChainAllocator *self = (struct ChainAllocator *)allocator;
+
+        uint8_t *bytes = ptr;
+        if (bytes >= self->blockStart && bytes < self->blockEnd) {
+                return;
+        }
+        allocator_free(self->parent, ptr);
+}
+
+/// first of the stages ending at end that make a single reducer
+static size_t composingGroupStart(struct ComposingTransducer const *self,
+                                  size_t const end)
+{
+        size_t start = end - 1;
+        while (start > 0 && isFusable(self->transducers[start]) &&
+               isFusable(self->transducers[start - 1])) {
+                start--;
+        }
+
+        return start;
+}
+
+static size_t composingGroupSize(struct ComposingTransducer const *self,
+                                 size_t const start, size_t const end)
+{
+        if (end - start > 1) {
+                return fusedReducerSize(end - start);
+        }
+
+        return transducer_size(self->transducers[start]);
+}
+
+/// bytes of the block, allocator and reducers
+static size_t composingBlockSize(struct ComposingTransducer const *self)
+{
+        size_t size = alignUp(sizeof(struct ChainAllocator));
+        for (size_t end = self->transducersCount; end > 0;) {
+                size_t const start = composingGroupStart(self, end);
+                size += composingGroupSize(self, start, end);
+                end = start;
+        }
+
+        return size;
+}
+
+/* also counts the padding needed to align the block inside an enclosing
+ * composition */
+static size_t composingTransducerSize(struct Transducer const *transducer)
+{
+        struct ComposingTransducer const *self =
+            (struct ComposingTransducer const *)transducer;
+
+        return composingBlockSize(self) + CACHE_LINE_SIZE - CHAIN_ALIGNMENT;
+}
+
+static struct ChainAllocator *newChainAllocator(size_t const size,
+                                                struct Allocator *parent)
+{
+        uint8_t *block = allocator_alloc_aligned(parent, size, CACHE_LINE_SIZE);
+        if (!block) {
+                block = allocator_alloc(parent, size);
+        }
+        if (!block) {
+                return NULL;
+        }
+
+        struct ChainAllocator *result = (struct ChainAllocator *)block;
+        *result = (struct ChainAllocator){
+            .super =
+                {
+                    .alloc = chainAlloc,
+                    .free = chainFree,
+                    .alloc_aligned = chainAllocAligned,
+                },
+            .parent = parent,
+            .blockStart = block,
+            .blockEnd = block + size,
+        };
+
+        return result;
+}
+
+static struct Reducer *composingTransducerApply(struct Transducer *transducer,
+                                                struct Reducer const *step,
+                                                struct Allocator *allocator)
+{
+        struct ComposingTransducer *self =
+            (struct ComposingTransducer *)transducer;
+
+        size_t const blockSize = composingBlockSize(self);
+        struct ChainAllocator *chain = newChainAllocator(blockSize, allocator);
+        if (chain) {
+                allocator = &chain->super;
+        }
+
+        /* built from the last stage, each placed at its offset in stage
+         * order */
+        uint8_t *stageEnd = chain ? chain->blockEnd : NULL;
+        struct Reducer *x = (struct Reducer *)step;
+        size_t end = self->transducersCount;
+        while (end > 0) {
+                size_t const start = composingGroupStart(self, end);
+                if (chain) {
+                        chain->end = stageEnd;
+                        chain->cursor =
+                            stageEnd - composingGroupSize(self, start, end);
+                        stageEnd = chain->cursor;
+                }
+
+                if (end - start > 1) {
+                        x = newFusedReducer(&self->transducers[start],
+                                            end - start, x, allocator);
+                } else {
+                        x = transducer_apply(self->transducers[start], x,
+                                             allocator);
+                }
+                end = start;
+        }
+
+        if (chain) {
+                chain->cursor = chain->end = chain->blockEnd;
         }
 
         return x;
@@ -325,7 +1840,7 @@ struct Transducer *composingTransducer(struct Transducer **transducers,
             allocator_alloc(allocator, sizeof *result);
 
         result->super = (struct Transducer){
-            composingTransducerApply,
+            composingTransducerApply, composingTransducerSize,
         };
 
         result->transducers = transducers;
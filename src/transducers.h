@@ -1,12 +1,14 @@
 #pragma once
 
 struct Allocator;
+struct ChainedReducer;
 struct Reducer;
 struct Transducer;
 
 #include "values.h"
 
 #include <stdbool.h>
+#include <stdint.h>
 
 /// establishes the initial reducing state
 struct Value reducer_identity(struct Reducer const *reducer,
@@ -17,15 +19,53 @@ struct Value reducer_complete(struct Reducer const *reducer,
                               struct Value result, struct Allocator *allocator);
 
 /// reduction function
+///
+/// returns a reduced() value when no further input should be processed,
+/// drivers must then stop and pass the unreduced() value to
+/// reducer_complete.
 struct Value reducer_apply(struct Reducer const *reducer, struct Value input,
                            struct Value current, struct Allocator *allocator);
 
+/// reduces all elements of span in order.
+///
+/// uses the reducer's apply_batch when it has one, and otherwise
+/// reducer_apply on each element until the result is reduced.
+///
+/// predicates and mapping functions are expected to be pure: in batch mode
+/// they may be evaluated on elements past the one that halted the reduction.
+struct Value reducer_apply_batch(struct Reducer const *reducer,
+                                 struct ValueSpan span, struct Value current,
+                                 struct Allocator *allocator);
+
+/// merges the result of reducing an input with the result of reducing the
+/// input that immediately follows it. the reducer must have a combine
+/// function.
+struct Value reducer_combine(struct Reducer const *reducer, struct Value left,
+                             struct Value right, struct Allocator *allocator);
+
 struct Reducer *idReducer(struct Allocator *allocator);
 
+/// reducer with reducingFn, completing and starting like step
+struct ChainedReducer chainedReducerMake(
+    struct Reducer const *step,
+    struct Value (*reducingFn)(struct Reducer const *, struct Value,
+                               struct Value, struct Allocator *));
+
+/// the reducers returned keep per-run state and serve one reduction at a
+/// time, see chain_builder.h to build one per run
 struct Reducer *transducer_apply(struct Transducer *transducer,
                                  struct Reducer const *step,
                                  struct Allocator *allocator);
 
+/**
+ * bytes of the reducers transducer_apply makes with this transducer, each
+ * rounded up to the alignment of max_align_t.
+ *
+ * 0 when unknown. values allocated while building, such as identities,
+ * are not counted.
+ */
+size_t transducer_size(struct Transducer const *transducer);
+
 struct Transducer *
 filteringTransducer(bool (*predicate)(struct Value value, void *data),
                     void *predicateData, struct Allocator *allocator);
@@ -33,6 +73,92 @@ filteringTransducer(bool (*predicate)(struct Value value, void *data),
 struct Transducer *mappingTransducer(struct Reducer *reducer,
                                      struct Allocator *allocator);
 
+/**
+ * partition_all: groups values by n, sent down as TTAG_SPAN values, the
+ * last group possibly shorter.
+ *
+ * values must hold elementSize bytes each. they are copied into storage
+ * made with the reducer, except when a batch holds whole groups, which are
+ * then sent down in place.
+ *
+ * like all windows, values of another size, or of another type than the
+ * first value of the window in progress, are dropped.
+ */
+struct Transducer *partitioningTransducer(size_t n, size_t elementSize,
+                                          struct Allocator *allocator);
+
+/**
+ * sliding window: once n values went through, sends down a TTAG_SPAN
+ * value of the last n every step values.
+ *
+ * on completion, the values that went through since the last window are
+ * not sent down, nor are the values of a reduction of fewer than n.
+ */
+struct Transducer *slidingWindowTransducer(size_t n, size_t step,
+                                           size_t elementSize,
+                                           struct Allocator *allocator);
+
+/**
+ * tumbling time window: groups the consecutive values whose timeOf falls
+ * in the same period, at most capacity of them per TTAG_SPAN value.
+ *
+ * the times must not decrease.
+ */
+struct Transducer *
+timeWindowTransducer(uint64_t period,
+                     uint64_t (*timeOf)(struct Value value, void *data),
+                     void *timeData, size_t capacity, size_t elementSize,
+                     struct Allocator *allocator);
+
+/// maps TTAG_SPAN values to their reduction by reducer, using its
+/// apply_batch when it has one
+struct Transducer *spanReducingTransducer(struct Reducer const *reducer,
+                                          struct Allocator *allocator);
+
+/// passes on the first n values, then halts the reduction
+struct Transducer *takingTransducer(size_t n, struct Allocator *allocator);
+
+/// drops the first n values, passes on the others
+struct Transducer *droppingTransducer(size_t n, struct Allocator *allocator);
+
+/// passes on values while predicate holds, then halts the reduction
+struct Transducer *
+takingWhileTransducer(bool (*predicate)(struct Value value, void *data),
+                      void *predicateData, struct Allocator *allocator);
+
+/**
+ * drops the values equal to the one before them.
+ *
+ * values are compared by type, size and payload, the last payload being
+ * kept in up to elementSize bytes of storage. larger values are never
+ * equal.
+ */
+struct Transducer *dedupingTransducer(size_t elementSize,
+                                      struct Allocator *allocator);
+
+/**
+ * numbers the values from 0, sending them down as TTAG_BATCH values with an
+ * indices column. batches of values get one column for up to 256 of them,
+ * rather than a wrapper per value.
+ */
+struct Transducer *indexingTransducer(struct Allocator *allocator);
+
+/**
+ * marks absent, through the validity column, the elements of TTAG_BATCH
+ * values whose index is outside [start, end), halting once the index
+ * end - 1 went through.
+ *
+ * indices must increase, as they do out of indexingTransducer.
+ */
+struct Transducer *indexRangeTransducer(size_t start, size_t end,
+                                        struct Allocator *allocator);
+
+/// sends down the elements present in TTAG_BATCH values, dropping the side
+/// columns, as spans
+struct Transducer *unwrappingTransducer(struct Allocator *allocator);
+
+/// the reducers of a composition are laid out in stage order in a single
+/// allocation, aligned to a cache line when the allocator supports it
 struct Transducer *composingTransducer(struct Transducer **transducers,
                                        size_t transducerCount,
                                        struct Allocator *allocator);
@@ -0,0 +1,320 @@
+#include "type_registry.h"
+#include "type_registry_types.h"
+
+#include "allocator.h"
+#include "float_kernels.h"
+#include "values.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+
+enum {
+        /// tags below are looked up by index
+        BUILTIN_TAGS_COUNT = TTAG_KEYED + 1,
+        /// power of two
+        REGISTERED_TYPES_CAPACITY = 64,
+};
+
+/* built-in types */
+
+static size_t formatNull(struct Value const *value, char *buffer, size_t size)
+{
+        return (size_t)snprintf(buffer, size, "null");
+}
+
+static size_t formatFloat(struct Value const *value, char *buffer,
+                          size_t size)
+{
+        return (size_t)snprintf(buffer, size, "%f",
+                                *(float const *)valuePayload(value));
+}
+
+static size_t formatInt(struct Value const *value, char *buffer, size_t size)
+{
+        return (size_t)snprintf(buffer, size, "%" PRId64,
+                                *(int64_t const *)valuePayload(value));
+}
+
+static size_t formatIndex(struct Value const *value, char *buffer,
+                          size_t size)
+{
+        return (size_t)snprintf(buffer, size, "%zu",
+                                *(size_t const *)valuePayload(value));
+}
+
+static size_t formatSpan(struct Value const *value, char *buffer, size_t size)
+{
+        struct ValueSpan const span = valueSpan(value);
+        return (size_t)snprintf(buffer, size, "span of %zu",
+                                valueSpanCount(&span));
+}
+
+static size_t formatBatch(struct Value const *value, char *buffer,
+                          size_t size)
+{
+        struct ValueBatch const batch = valueBatch(value);
+        return (size_t)snprintf(buffer, size, "batch of %zu",
+                                valueBatchCount(&batch));
+}
+
+static size_t formatKeyed(struct Value const *value, char *buffer,
+                          size_t size)
+{
+        struct KeyedValue const keyed = valueKeyed(value);
+        size_t const n =
+            (size_t)snprintf(buffer, size, "%" PRIu64 ": ", keyed.key);
+
+        return n + value_format(&keyed.value, n < size ? buffer + n : NULL,
+                                n < size ? size - n : 0);
+}
+
+static void floatSum(void *accumulator, void const *elements, size_t count)
+{
+        *(float *)accumulator += floatKernelSum(elements, count);
+}
+
+static void floatMin(void *accumulator, void const *elements, size_t count)
+{
+        float const m = floatKernelMin(elements, count);
+        float *result = accumulator;
+        *result = m < *result ? m : *result;
+}
+
+static void floatMax(void *accumulator, void const *elements, size_t count)
+{
+        float const m = floatKernelMax(elements, count);
+        float *result = accumulator;
+        *result = m > *result ? m : *result;
+}
+
+/* plain loops, the compiler vectorizes them well enough */
+#define INTEGER_KERNELS(prefix, type)                                          \
+        static void prefix##Sum(void *accumulator, void const *elements,       \
+                                size_t count)                                  \
+        {                                                                      \
+                type const *values = elements;                                 \
+                type sum = *(type *)accumulator;                               \
+                for (size_t i = 0; i < count; i++) {                           \
+                        sum += values[i];                                      \
+                }                                                              \
+                *(type *)accumulator = sum;                                    \
+        }                                                                      \
+                                                                               \
+        static void prefix##Min(void *accumulator, void const *elements,       \
+                                size_t count)                                  \
+        {                                                                      \
+                type const *values = elements;                                 \
+                type m = *(type *)accumulator;                                 \
+                for (size_t i = 0; i < count; i++) {                           \
+                        m = values[i] < m ? values[i] : m;                     \
+                }                                                              \
+                *(type *)accumulator = m;                                      \
+        }                                                                      \
+                                                                               \
+        static void prefix##Max(void *accumulator, void const *elements,       \
+                                size_t count)                                  \
+        {                                                                      \
+                type const *values = elements;                                 \
+                type m = *(type *)accumulator;                                 \
+                for (size_t i = 0; i < count; i++) {                           \
+                        m = values[i] > m ? values[i] : m;                     \
+                }                                                              \
+                *(type *)accumulator = m;                                      \
+        }
+
+INTEGER_KERNELS(int, int64_t)
+INTEGER_KERNELS(index, size_t)
+
+static float const floatHighest = INFINITY;
+static float const floatLowest = -INFINITY;
+static int64_t const intHighest = INT64_MAX;
+static int64_t const intLowest = INT64_MIN;
+static size_t const indexHighest = SIZE_MAX;
+static size_t const indexLowest = 0;
+
+static struct TypeDescriptor const builtinTypes[BUILTIN_TAGS_COUNT] = {
+    [TTAG_NULL] =
+        {
+            .type_tag = TTAG_NULL, .name = "null", .format = formatNull,
+        },
+    [TTAG_FLOAT] =
+        {
+            .type_tag = TTAG_FLOAT,
+            .name = "float",
+            .size = sizeof(float),
+            .alignment = _Alignof(float),
+            .format = formatFloat,
+            .kernels = {floatSum, floatMin, floatMax},
+            .highest = &floatHighest,
+            .lowest = &floatLowest,
+        },
+    [TTAG_INT] =
+        {
+            .type_tag = TTAG_INT,
+            .name = "int",
+            .size = sizeof(int64_t),
+            .alignment = _Alignof(int64_t),
+            .format = formatInt,
+            .kernels = {intSum, intMin, intMax},
+            .highest = &intHighest,
+            .lowest = &intLowest,
+        },
+    [TTAG_INDEX] =
+        {
+            .type_tag = TTAG_INDEX,
+            .name = "index",
+            .size = sizeof(size_t),
+            .alignment = _Alignof(size_t),
+            .format = formatIndex,
+            .kernels = {indexSum, indexMin, indexMax},
+            .highest = &indexHighest,
+            .lowest = &indexLowest,
+        },
+    [TTAG_SPAN] =
+        {
+            .type_tag = TTAG_SPAN,
+            .name = "span",
+            .size = sizeof(struct ValueSpan),
+            .alignment = _Alignof(struct ValueSpan),
+            .format = formatSpan,
+        },
+    [TTAG_BATCH] =
+        {
+            .type_tag = TTAG_BATCH,
+            .name = "batch",
+            .size = sizeof(struct ValueBatch),
+            .alignment = _Alignof(struct ValueBatch),
+            .format = formatBatch,
+        },
+    [TTAG_KEYED] =
+        {
+            .type_tag = TTAG_KEYED,
+            .name = "keyed",
+            .size = sizeof(struct KeyedValue),
+            .alignment = _Alignof(struct KeyedValue),
+            .format = formatKeyed,
+        },
+};
+
+/* registered types, by open addressing */
+
+static struct TypeDescriptor const
+    *registeredTypes[REGISTERED_TYPES_CAPACITY];
+
+static size_t registeredSlot(uint32_t const type_tag)
+{
+        /* tags are hashes already, or small integers */
+        return (type_tag * 2654435761u) % REGISTERED_TYPES_CAPACITY;
+}
+
+uint32_t typeTagOfName(char const *name)
+{
+        /* FNV-1a */
+        uint32_t hash = 2166136261u;
+        for (char const *c = name; *c; c++) {
+                hash = (hash ^ (uint8_t)*c) * 16777619u;
+        }
+
+        return hash < BUILTIN_TAGS_COUNT ? hash + BUILTIN_TAGS_COUNT : hash;
+}
+
+bool type_register(struct TypeDescriptor const *descriptor)
+{
+        if (descriptor->type_tag < BUILTIN_TAGS_COUNT) {
+                return false;
+        }
+
+        size_t slot = registeredSlot(descriptor->type_tag);
+        for (size_t i = 0; i < REGISTERED_TYPES_CAPACITY; i++) {
+                struct TypeDescriptor const *other = registeredTypes[slot];
+                if (!other) {
+                        registeredTypes[slot] = descriptor;
+                        return true;
+                }
+                if (other->type_tag == descriptor->type_tag) {
+                        return other == descriptor;
+                }
+                slot = (slot + 1) % REGISTERED_TYPES_CAPACITY;
+        }
+
+        return false;
+}
+
+struct TypeDescriptor const *type_descriptor(uint32_t const type_tag)
+{
+        if (type_tag < BUILTIN_TAGS_COUNT) {
+                return &builtinTypes[type_tag];
+        }
+
+        size_t slot = registeredSlot(type_tag);
+        for (size_t i = 0; i < REGISTERED_TYPES_CAPACITY; i++) {
+                struct TypeDescriptor const *descriptor =
+                    registeredTypes[slot];
+                if (!descriptor || descriptor->type_tag == type_tag) {
+                        return descriptor;
+                }
+                slot = (slot + 1) % REGISTERED_TYPES_CAPACITY;
+        }
+
+        return NULL;
+}
+
+/* generic operations */
+
+struct Value value_copy(struct Value const *value,
+                        struct Allocator *allocator)
+{
+        /* spans, batches and keyed values do not own what they refer to */
+        assert(value->type_tag != TTAG_SPAN && value->type_tag != TTAG_BATCH &&
+               value->type_tag != TTAG_KEYED);
+
+        struct TypeDescriptor const *descriptor =
+            type_descriptor(value->type_tag);
+        if (descriptor && descriptor->copy) {
+                return descriptor->copy(value, allocator);
+        }
+        if (isImmediate(value)) {
+                return *value;
+        }
+
+        size_t const alignment = descriptor && descriptor->alignment
+                                     ? descriptor->alignment
+                                     : _Alignof(max_align_t);
+        void *payload =
+            allocator_alloc_aligned(allocator, value->element_size, alignment);
+        memcpy(payload, value->address, value->element_size);
+
+        struct Value result = *value;
+        result.address = payload;
+        result.allocator = allocator;
+
+        return result;
+}
+
+void value_release(struct Value *value)
+{
+        struct TypeDescriptor const *descriptor =
+            type_descriptor(value->type_tag);
+        if (descriptor && descriptor->release) {
+                descriptor->release(value);
+                return;
+        }
+
+        freeValue(value);
+}
+
+size_t value_format(struct Value const *value, char *buffer, size_t size)
+{
+        struct TypeDescriptor const *descriptor =
+            type_descriptor(value->type_tag);
+        if (!descriptor) {
+                return (size_t)snprintf(buffer, size, "?");
+        }
+        if (!descriptor->format) {
+                return (size_t)snprintf(buffer, size, "%s", descriptor->name);
+        }
+
+        return descriptor->format(value, buffer, size);
+}
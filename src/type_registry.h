@@ -0,0 +1,48 @@
+#pragma once
+
+/**
+ * @file
+ * Registry mapping type tags to their descriptors.
+ *
+ * The built-in tags of values.h are always registered. Other types are
+ * registered once, before any reduction uses them: the registry is not
+ * safe to modify while other threads read it.
+ *
+ * Stages look descriptors up when they are built rather than for each
+ * value, and keep what they need of them.
+ */
+
+#include "type_registry_types.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct Allocator;
+struct Value;
+
+/// tag derived from a type name, past the range of the built-in tags
+uint32_t typeTagOfName(char const *name);
+
+/**
+ * registers descriptor, which must outlive the registry.
+ *
+ * @return false when the tag already has another descriptor or the
+ * registry is full
+ */
+bool type_register(struct TypeDescriptor const *descriptor);
+
+/// @return NULL for unregistered tags
+struct TypeDescriptor const *type_descriptor(uint32_t type_tag);
+
+/// copies value, or its element_size payload bytes when the type has no
+/// copy function. immediates are returned as they are.
+struct Value value_copy(struct Value const *value,
+                        struct Allocator *allocator);
+
+/// releases value, or frees its payload when the type has no release
+/// function, like freeValue()
+void value_release(struct Value *value);
+
+/// formats value, or its type name when the type has no format function
+size_t value_format(struct Value const *value, char *buffer, size_t size);
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct Allocator;
+struct Value;
+
+/// loops over arrays of elements of one type, folding them into the
+/// payload at accumulator
+struct TypeKernels
+{
+        void (*sum)(void *accumulator, void const *elements, size_t count);
+        void (*min)(void *accumulator, void const *elements, size_t count);
+        void (*max)(void *accumulator, void const *elements, size_t count);
+};
+
+/**
+ * What is known of the values of one type tag.
+ *
+ * all functions are optional, see type_registry.h for the defaults.
+ */
+struct TypeDescriptor
+{
+        uint32_t type_tag;
+        char const *name;
+        /// bytes of a payload, 0 when it varies
+        size_t size;
+        size_t alignment;
+
+        /// copy of value owning its payload
+        struct Value (*copy)(struct Value const *value,
+                             struct Allocator *allocator);
+        /// gives back the payload of value and what it owns
+        void (*release)(struct Value *value);
+        /// writes at most size bytes, snprintf-like
+        ///
+        /// @return length of the full representation
+        size_t (*format)(struct Value const *value, char *buffer,
+                         size_t size);
+
+        struct TypeKernels kernels;
+        /// payloads starting min and max reductions, when kernels has them
+        void const *highest;
+        void const *lowest;
+};
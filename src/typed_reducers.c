@@ -0,0 +1,147 @@
+#include "typed_reducers.h"
+#include "transducer_types.h"
+#include "type_registry.h"
+
+#include "allocator.h"
+#include "values.h"
+
+struct KernelReducer
+{
+        struct Reducer super;
+        uint32_t type_tag;
+        size_t size;
+        size_t alignment;
+        void (*kernel)(void *accumulator, void const *elements, size_t count);
+        /// payload of the identity, zeroes when NULL
+        void const *start;
+};
+
+static struct Value kernelReducerIdentity(struct Reducer const *reducer,
+                                          struct Allocator *allocator)
+{
+        struct KernelReducer const *self = (void const *)reducer;
+        struct Value result = {
+            .type_tag = self->type_tag,
+            .flags = VF_IMMEDIATE,
+            .element_size = self->size,
+        };
+        if (self->start) {
+                memcpy(&result.immediate, self->start, self->size);
+        }
+
+        return result;
+}
+
+static struct Value kernelReducerApply(struct Reducer const *reducer,
+                                       struct Value input, struct Value current,
+                                       struct Allocator *allocator)
+{
+        struct KernelReducer const *self = (void const *)reducer;
+        if (input.type_tag != self->type_tag ||
+            input.element_size != self->size) {
+                return current;
+        }
+
+        self->kernel(&current.immediate, valuePayload(&input), 1);
+
+        return current;
+}
+
+static struct Value kernelReducerApplyBatch(struct Reducer const *reducer,
+                                            struct ValueSpan span,
+                                            struct Value current,
+                                            struct Allocator *allocator)
+{
+        struct KernelReducer const *self = (void const *)reducer;
+        if (span.type_tag != self->type_tag ||
+            span.element_size != self->size) {
+                return current;
+        }
+
+        size_t const count = valueSpanCount(&span);
+        if ((uintptr_t)span.start % self->alignment == 0) {
+                self->kernel(&current.immediate, span.start, count);
+                return current;
+        }
+
+        void *elements = allocator_alloc_aligned(allocator, count * self->size,
+                                                 self->alignment);
+        if (elements) {
+                memcpy(elements, span.start, count * self->size);
+                self->kernel(&current.immediate, elements, count);
+                allocator_free(allocator, elements);
+                return current;
+        }
+
+        for (uint8_t const *element = span.start; element < span.end;
+             element += span.element_size) {
+                current = kernelReducerApply(
+                    reducer, valueSpanElement(&span, element), current,
+                    allocator);
+        }
+
+        return current;
+}
+
+static struct Reducer *
+newKernelReducer(struct TypeDescriptor const *descriptor,
+                 void (*kernel)(void *, void const *, size_t),
+                 void const *start, struct Allocator *allocator)
+{
+        if (!kernel || descriptor->size == 0 ||
+            descriptor->size > sizeof(union ValueImmediate)) {
+                return NULL;
+        }
+
+        struct KernelReducer *result =
+            allocator_alloc(allocator, sizeof *result);
+        *result = (struct KernelReducer){
+            .super =
+                {
+                    .identity = kernelReducerIdentity,
+                    .apply = kernelReducerApply,
+                    .apply_batch = kernelReducerApplyBatch,
+                    .combine = kernelReducerApply,
+                },
+            .type_tag = descriptor->type_tag,
+            .size = descriptor->size,
+            .alignment = descriptor->alignment ? descriptor->alignment : 1,
+            .kernel = kernel,
+            .start = start,
+        };
+
+        return &result->super;
+}
+
+struct Reducer *typedSumReducer(uint32_t type_tag, struct Allocator *allocator)
+{
+        struct TypeDescriptor const *descriptor = type_descriptor(type_tag);
+        if (!descriptor) {
+                return NULL;
+        }
+
+        return newKernelReducer(descriptor, descriptor->kernels.sum, NULL,
+                                allocator);
+}
+
+struct Reducer *typedMinReducer(uint32_t type_tag, struct Allocator *allocator)
+{
+        struct TypeDescriptor const *descriptor = type_descriptor(type_tag);
+        if (!descriptor || !descriptor->highest) {
+                return NULL;
+        }
+
+        return newKernelReducer(descriptor, descriptor->kernels.min,
+                                descriptor->highest, allocator);
+}
+
+struct Reducer *typedMaxReducer(uint32_t type_tag, struct Allocator *allocator)
+{
+        struct TypeDescriptor const *descriptor = type_descriptor(type_tag);
+        if (!descriptor || !descriptor->lowest) {
+                return NULL;
+        }
+
+        return newKernelReducer(descriptor, descriptor->kernels.max,
+                                descriptor->lowest, allocator);
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+/**
+ * @file
+ * Reductions of values of any registered type with kernels.
+ *
+ * The kernels are looked up in the type registry once, when the reducer
+ * is made, and spans of the type are then reduced by a single kernel call,
+ * misaligned ones after being copied with the allocator of the reduction.
+ * Inputs of other types or sizes are skipped.
+ */
+
+struct Allocator;
+struct Reducer;
+
+#include <stdint.h>
+
+/**
+ * sum, minimum or maximum of inputs of type type_tag, as immediates.
+ *
+ * @return NULL when the type has no such kernel or its payloads do not
+ * fit in an immediate
+ */
+struct Reducer *typedSumReducer(uint32_t type_tag, struct Allocator *allocator);
+struct Reducer *typedMinReducer(uint32_t type_tag, struct Allocator *allocator);
+struct Reducer *typedMaxReducer(uint32_t type_tag, struct Allocator *allocator);
@@ -14,3 +14,45 @@ struct ValueStreamRange
         enum StreamErrorCode error;
         enum StreamErrorCode (*next)(struct ValueStreamRange *);
 };
+
+/**
+ * Typed view over a byte stream.
+ *
+ * see byteStreamVSR()
+ */
+struct ByteValueStream
+{
+        struct ValueStreamRange range;
+        struct StreamRange *source;
+        size_t alignment;
+        /// bytes gathered so far of an element straddling two refills
+        size_t carryCount;
+        /// bytes that could not be aliased and went through carry
+        size_t copiedBytes;
+        union
+        {
+                max_align_t align;
+                uint8_t bytes[256];
+        } carry;
+};
+
+/// elements laid out contiguously at base
+struct ValueChunk
+{
+        void const *base;
+        size_t count;
+};
+
+/**
+ * Stream over a list of chunks, in order.
+ *
+ * see chunksVSR()
+ */
+struct ChunkedValueStream
+{
+        struct ValueStreamRange range;
+        struct ValueChunk const *chunks;
+        size_t chunksCount;
+        /// position in chunks of the chunk after the current one
+        size_t nextChunk;
+};
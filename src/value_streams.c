@@ -1,31 +1,16 @@
+#include "value_streams.h"
+#include "failed_streams.h"
 #include "stream_types.h"
 #include "value_stream_types.h"
 #include "values.h"
 
-static enum StreamErrorCode zerosVSRNext(struct ValueStreamRange *range)
-{
-        static uint8_t const zeros[256] = {0};
-
-        range->type_tag = 0;
-        range->element_size = 1;
-        range->start = zeros;
-        range->cursor = zeros;
-        range->end = zeros + sizeof(zeros);
-
-        return range->error;
-}
-
-static enum StreamErrorCode failVSR(struct ValueStreamRange *range,
-                                    enum StreamErrorCode error)
-{
-        range->error = error;
-        range->next = zerosVSRNext;
-        return range->next(range);
-}
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
 
 static enum StreamErrorCode floatArrayNext(struct ValueStreamRange *range)
 {
-        return failVSR(range, S_ReadPastEnd);
+        return value_stream_fail(range, S_ReadPastEnd);
 }
 
 void floatArrayVSR(struct ValueStreamRange *range, float const *values,
@@ -39,3 +24,131 @@ void floatArrayVSR(struct ValueStreamRange *range, float const *values,
         range->error = S_NoError;
         range->next = floatArrayNext;
 }
+
+static enum StreamErrorCode chunksNext(struct ValueStreamRange *range)
+{
+        struct ChunkedValueStream *stream = (struct ChunkedValueStream *)range;
+
+        while (stream->nextChunk < stream->chunksCount) {
+                struct ValueChunk const *chunk =
+                    &stream->chunks[stream->nextChunk++];
+                if (chunk->count == 0) {
+                        continue;
+                }
+                range->start = chunk->base;
+                range->cursor = chunk->base;
+                range->end = range->start + chunk->count * range->element_size;
+                return range->error;
+        }
+
+        return value_stream_fail(range, S_ReadPastEnd);
+}
+
+void chunksVSR(struct ChunkedValueStream *stream, int type_tag,
+               size_t element_size, struct ValueChunk const *chunks,
+               size_t chunksCount)
+{
+        *stream = (struct ChunkedValueStream){
+            .range =
+                {
+                    .type_tag = type_tag,
+                    .element_size = element_size,
+                    .error = S_NoError,
+                    .next = chunksNext,
+                },
+            .chunks = chunks,
+            .chunksCount = chunksCount,
+        };
+        chunksNext(&stream->range);
+}
+
+static enum StreamErrorCode byteStreamHandOut(struct ValueStreamRange *range,
+                                              uint8_t const *start,
+                                              uint8_t const *end)
+{
+        range->start = start;
+        range->cursor = start;
+        range->end = end;
+        return range->error;
+}
+
+static enum StreamErrorCode byteStreamNext(struct ValueStreamRange *range)
+{
+        struct ByteValueStream *stream = (struct ByteValueStream *)range;
+        struct StreamRange *source = stream->source;
+        uint8_t *carry = stream->carry.bytes;
+        size_t const size = range->element_size;
+
+        while (true) {
+                if (source->cursor == source->end) {
+                        if (source->next(source) != S_NoError) {
+                                return value_stream_fail(range, source->error);
+                        }
+                        continue;
+                }
+
+                size_t const available =
+                    (size_t)(source->end - source->cursor);
+                if (stream->carryCount > 0) {
+                        size_t const missing = size - stream->carryCount;
+                        size_t const n =
+                            missing < available ? missing : available;
+                        memcpy(carry + stream->carryCount, source->cursor, n);
+                        source->cursor += n;
+                        stream->carryCount += n;
+                        stream->copiedBytes += n;
+                        if (stream->carryCount < size) {
+                                continue;
+                        }
+                        stream->carryCount = 0;
+                        return byteStreamHandOut(range, carry, carry + size);
+                }
+
+                if (available < size) {
+                        memcpy(carry, source->cursor, available);
+                        source->cursor = source->end;
+                        stream->carryCount = available;
+                        stream->copiedBytes += available;
+                        continue;
+                }
+
+                if ((uintptr_t)source->cursor % stream->alignment != 0) {
+                        size_t const fits = available < sizeof stream->carry
+                                                ? available
+                                                : sizeof stream->carry;
+                        size_t const n = fits / size * size;
+                        memcpy(carry, source->cursor, n);
+                        source->cursor += n;
+                        stream->copiedBytes += n;
+                        return byteStreamHandOut(range, carry, carry + n);
+                }
+
+                uint8_t const *start = source->cursor;
+                source->cursor += available / size * size;
+                return byteStreamHandOut(range, start, source->cursor);
+        }
+}
+
+enum StreamErrorCode byteStreamVSR(struct ByteValueStream *stream,
+                                   struct StreamRange *source, int type_tag,
+                                   size_t element_size, size_t alignment)
+{
+        *stream = (struct ByteValueStream){
+            .source = source, .alignment = alignment ? alignment : 1,
+        };
+
+        struct ValueStreamRange *range = &stream->range;
+        range->type_tag = type_tag;
+        range->element_size = element_size;
+        range->start = stream->carry.bytes;
+        range->cursor = stream->carry.bytes;
+        range->end = stream->carry.bytes;
+        range->error = S_NoError;
+        range->next = byteStreamNext;
+
+        if (element_size == 0 || element_size > sizeof stream->carry) {
+                return value_stream_fail(range, S_IOError);
+        }
+
+        return S_NoError;
+}
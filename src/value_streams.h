@@ -1,8 +1,36 @@
 #pragma once
 
+struct ByteValueStream;
+struct ChunkedValueStream;
+struct ValueChunk;
+struct StreamRange;
 struct ValueStreamRange;
 
+#include "stream_types.h"
+
 #include <stddef.h>
 
 void floatArrayVSR(struct ValueStreamRange *range, float const *values,
                    size_t count);
+
+/**
+ * presents the elements of chunks as a single stream, moving to the next
+ * chunk on each refill. chunks must outlive the stream.
+ */
+void chunksVSR(struct ChunkedValueStream *stream, int type_tag,
+               size_t element_size, struct ValueChunk const *chunks,
+               size_t chunksCount);
+
+/**
+ * presents the bytes of source as elements of type_tag and element_size.
+ *
+ * the ranges alias the buffers of source whenever they are aligned to
+ * alignment, otherwise whole elements are copied into a carry buffer, as
+ * are elements straddling two refills of source. a trailing partial
+ * element is dropped.
+ *
+ * @return S_IOError when element_size does not fit the carry buffer
+ */
+enum StreamErrorCode byteStreamVSR(struct ByteValueStream *stream,
+                                   struct StreamRange *source, int type_tag,
+                                   size_t element_size, size_t alignment);
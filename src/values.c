@@ -4,7 +4,9 @@
 
 void freeValue(struct Value *value)
 {
-        allocator_free(value->allocator, (void *)value->address);
+        if (!isImmediate(value)) {
+                allocator_free(value->allocator, (void *)value->address);
+        }
         value->address = NULL;
         value->allocator = NULL;
 }
@@ -2,19 +2,52 @@
 
 struct Allocator;
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 
 enum TypeTags {
         TTAG_NULL,
         TTAG_FLOAT,
+        /// int64_t
+        TTAG_INT,
+        /// size_t, for positions and counts
+        TTAG_INDEX,
+        /// address is a struct ValueSpan, see spanValue()
+        TTAG_SPAN,
+        /// address is a struct ValueBatch, see batchValue()
+        TTAG_BATCH,
+        /// address is a struct KeyedValue, see keyedValue()
+        TTAG_KEYED,
+};
+
+enum ValueFlags {
+        /// the payload is stored inline in `immediate` rather than at
+        /// `address`
+        VF_IMMEDIATE = 1 << 0,
+        /// raised by a reducer to request that the reduction stops
+        VF_REDUCED = 1 << 1,
+};
+
+/// inline storage for small scalars
+union ValueImmediate
+{
+        float f;
+        int64_t i;
+        size_t index;
 };
 
 struct Value
 {
         uint32_t type_tag;
+        uint32_t flags;
         size_t element_size;
-        void const *address;
+        union
+        {
+                void const *address;
+                union ValueImmediate immediate;
+        };
         struct Allocator *allocator;
 };
 
@@ -23,4 +56,173 @@ static inline struct Value nullValue()
         return (struct Value){.type_tag = TTAG_NULL};
 }
 
+static inline struct Value floatImmediate(float const f)
+{
+        return (struct Value){.type_tag = TTAG_FLOAT,
+                              .flags = VF_IMMEDIATE,
+                              .element_size = sizeof f,
+                              .immediate = {.f = f}};
+}
+
+static inline struct Value intImmediate(int64_t const i)
+{
+        return (struct Value){.type_tag = TTAG_INT,
+                              .flags = VF_IMMEDIATE,
+                              .element_size = sizeof i,
+                              .immediate = {.i = i}};
+}
+
+static inline struct Value indexImmediate(size_t const index)
+{
+        return (struct Value){.type_tag = TTAG_INDEX,
+                              .flags = VF_IMMEDIATE,
+                              .element_size = sizeof index,
+                              .immediate = {.index = index}};
+}
+
+static inline bool isImmediate(struct Value const *value)
+{
+        return value->flags & VF_IMMEDIATE;
+}
+
+static inline bool isReduced(struct Value const *value)
+{
+        return value->flags & VF_REDUCED;
+}
+
+/// marks value as the final result of a reduction
+static inline struct Value reduced(struct Value value)
+{
+        value.flags |= VF_REDUCED;
+        return value;
+}
+
+static inline struct Value unreduced(struct Value value)
+{
+        value.flags &= ~(uint32_t)VF_REDUCED;
+        return value;
+}
+
+/// address of the payload, whether it is boxed or immediate
+static inline void const *valuePayload(struct Value const *value)
+{
+        return isImmediate(value) ? (void const *)&value->immediate
+                                  : value->address;
+}
+
+/**
+ * homogeneous elements laid out contiguously in [start, end)
+ *
+ * the elements are only valid for the duration of the call they are
+ * passed to.
+ */
+struct ValueSpan
+{
+        uint32_t type_tag;
+        size_t element_size;
+        uint8_t const *start;
+        uint8_t const *end;
+};
+
+static inline size_t valueSpanCount(struct ValueSpan const *span)
+{
+        return (size_t)(span->end - span->start) / span->element_size;
+}
+
+/**
+ * value of the element at address inside span.
+ *
+ * elements small enough are copied into an immediate so that the value
+ * can outlive the span.
+ */
+static inline struct Value valueSpanElement(struct ValueSpan const *span,
+                                            uint8_t const *address)
+{
+        struct Value value = {
+            .type_tag = span->type_tag, .element_size = span->element_size,
+        };
+
+        if (span->element_size <= sizeof value.immediate) {
+                value.flags = VF_IMMEDIATE;
+                memcpy(&value.immediate, address, span->element_size);
+        } else {
+                value.address = address;
+        }
+
+        return value;
+}
+
+/// value referring to span, valid no longer than span itself
+static inline struct Value spanValue(struct ValueSpan const *span)
+{
+        return (struct Value){
+            .type_tag = TTAG_SPAN,
+            .element_size = sizeof *span,
+            .address = span,
+        };
+}
+
+static inline struct ValueSpan valueSpan(struct Value const *value)
+{
+        return *(struct ValueSpan const *)value->address;
+}
+
+/**
+ * elements stored by columns: their payloads in values, and optional side
+ * columns with one entry per element.
+ *
+ * like spans, the columns are only valid for the duration of the call
+ * they are passed to.
+ */
+struct ValueBatch
+{
+        struct ValueSpan values;
+        /// optional, position of each element in its stream
+        size_t const *indices;
+        /// optional, elements whose byte is 0 are absent from the batch
+        uint8_t const *validity;
+};
+
+static inline size_t valueBatchCount(struct ValueBatch const *batch)
+{
+        return valueSpanCount(&batch->values);
+}
+
+/// value referring to batch, valid no longer than batch itself
+static inline struct Value batchValue(struct ValueBatch const *batch)
+{
+        return (struct Value){
+            .type_tag = TTAG_BATCH,
+            .element_size = sizeof *batch,
+            .address = batch,
+        };
+}
+
+static inline struct ValueBatch valueBatch(struct Value const *value)
+{
+        return *(struct ValueBatch const *)value->address;
+}
+
+/// value of one key of a grouping, see grouping.h
+struct KeyedValue
+{
+        uint64_t key;
+        struct Value value;
+};
+
+/// value referring to keyed, valid no longer than keyed itself
+static inline struct Value keyedValue(struct KeyedValue const *keyed)
+{
+        return (struct Value){
+            .type_tag = TTAG_KEYED,
+            .element_size = sizeof *keyed,
+            .address = keyed,
+        };
+}
+
+static inline struct KeyedValue valueKeyed(struct Value const *value)
+{
+        return *(struct KeyedValue const *)value->address;
+}
+
 void freeValue(struct Value *value);